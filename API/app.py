@@ -9,6 +9,8 @@ import time
 import subprocess
 import re
 import math # Thêm thư viện math
+import mmap
+import struct
 
 
 # ============================================================================
@@ -26,6 +28,10 @@ DB_FILE = os.path.join(PROJECT_ROOT, "Sensor.db")
 LOG_FILE = os.path.join(PROJECT_ROOT, 'gateway.log')
 SENSOR_MAP_FILE = os.path.join(PROJECT_ROOT, 'room_sensor.map')
 TYPE_MAP_FILE = os.path.join(PROJECT_ROOT, 'type.map')
+# Shared memory table published by the gateway data manager (see include/latest_table.h)
+LATEST_SHM_FILE = '/dev/shm/sensor_latest'
+# Per-sensor rings of recent readings kept by the gateway (see include/sensor_history.h)
+HISTORY_SHM_FILE = '/dev/shm/sensor_history'
 
 # Khởi tạo Flask App với đường dẫn đến thư mục 'web' đã được sửa đúng
 app = Flask(__name__, static_folder=WEB_DIR, static_url_path='')
@@ -133,6 +139,134 @@ def load_sensor_room_type_map():
         combined[sensor_id] = {'room_id': room_map[sensor_id], 'type': type_map[sensor_id]}
     return combined
 
+# --- Latest value table in shared memory (include/latest_table.h) ---
+LATEST_MAGIC = 0x5453414C
+LATEST_HEADER = struct.Struct('<IIIIIIII')
+LATEST_ENTRY = struct.Struct('<IHHddq')
+LATEST_ROOM = struct.Struct('<IHHq' + 'IIddd' * 3)
+SENSOR_TYPES = ('temperature', 'humidity', 'light')
+_latest_shm = None
+
+def latest_shm():
+    # map the segment once, afterwards every read is a plain memory access
+    global _latest_shm
+    if _latest_shm is None:
+        try:
+            with open(LATEST_SHM_FILE, 'rb') as f:
+                shm = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+        except (OSError, ValueError):
+            return None
+        magic, version, header_size, entry_size, capacity, room_offset, room_entry_size, room_capacity = LATEST_HEADER.unpack_from(shm, 0)
+        if magic != LATEST_MAGIC or entry_size != LATEST_ENTRY.size:
+            shm.close()
+            return None
+        if version < 2 or room_entry_size != LATEST_ROOM.size:
+            room_capacity = 0
+        _latest_shm = (shm, header_size, entry_size, capacity, room_offset, room_capacity)
+    return _latest_shm
+
+def read_latest(sensor_id):
+    # seqlock read: retry while the gateway is writing the entry (odd sequence) or wrote it during the copy
+    global _latest_shm
+    table = latest_shm()
+    if table is None or sensor_id >= table[3]:
+        return None
+    shm, header_size, entry_size = table[:3]
+    offset = header_size + sensor_id * entry_size
+    if struct.unpack_from('<I', shm, 0)[0] != LATEST_MAGIC:
+        # the gateway that created this segment stopped, map the new one on the next request
+        shm.close()
+        _latest_shm = None
+        return None
+    while True:
+        entry = LATEST_ENTRY.unpack_from(shm, offset)
+        if entry[0] & 1 or struct.unpack_from('<I', shm, offset)[0] != entry[0]:
+            continue
+        break
+    seq, _, room_id, value, running_avg, ts = entry
+    if seq == 0:
+        return None
+    return {"sensor_value": value, "timestamp": ts, "running_avg": running_avg, "room_id": room_id}
+
+def read_room_stats(room_id):
+    # same seqlock protocol as read_latest, one entry per room holds the aggregates of every sensor type
+    global _latest_shm
+    table = latest_shm()
+    if table is None or room_id >= table[5]:
+        return None
+    shm, room_offset = table[0], table[4]
+    offset = room_offset + room_id * LATEST_ROOM.size
+    if struct.unpack_from('<I', shm, 0)[0] != LATEST_MAGIC:
+        shm.close()
+        _latest_shm = None
+        return None
+    while True:
+        entry = LATEST_ROOM.unpack_from(shm, offset)
+        if entry[0] & 1 or struct.unpack_from('<I', shm, offset)[0] != entry[0]:
+            continue
+        break
+    if entry[0] == 0:
+        return None
+    stats = {}
+    for i, name in enumerate(SENSOR_TYPES):
+        count, _, mean, low, high = entry[4 + i * 5: 9 + i * 5]
+        if count:
+            stats[name] = {"count": count, "mean": mean, "min": low, "max": high}
+    return {"room_id": room_id, "timestamp": entry[3], "types": stats}
+
+# --- Recent readings in shared memory (include/sensor_history.h) ---
+HISTORY_MAGIC = 0x54534948
+HISTORY_HEADER = struct.Struct('<IIIIIIIII')
+HISTORY_RING = struct.Struct('<IHHQ')
+HISTORY_ENTRY = struct.Struct('<dq')
+# the index has a slab number for every sensor id
+HISTORY_INDEX_ENTRIES = 65536
+_history_shm = None
+
+def history_shm():
+    global _history_shm
+    if _history_shm is None:
+        try:
+            with open(HISTORY_SHM_FILE, 'rb') as f:
+                shm = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+        except (OSError, ValueError):
+            return None
+        header = HISTORY_HEADER.unpack_from(shm, 0)
+        if header[0] != HISTORY_MAGIC:
+            shm.close()
+            return None
+        _history_shm = (shm,) + header[3:6] + header[7:9]
+    return _history_shm
+
+def read_history(sensor_id, from_ts, to_ts):
+    # returns (readings in the window, timestamp of the oldest reading in memory) or None without a ring
+    global _history_shm
+    table = history_shm()
+    if table is None or not 0 <= sensor_id < HISTORY_INDEX_ENTRIES:
+        return None
+    shm, depth, slab_size, slab_count, index_offset, arena_offset = table
+    if struct.unpack_from('<I', shm, 0)[0] != HISTORY_MAGIC:
+        shm.close()
+        _history_shm = None
+        return None
+    slab = struct.unpack_from('<I', shm, index_offset + sensor_id * 4)[0]
+    if slab == 0 or slab > slab_count:
+        return None
+    ring = arena_offset + (slab - 1) * slab_size
+    entries = ring + HISTORY_RING.size
+    while True:
+        seq, _, _, count = HISTORY_RING.unpack_from(shm, ring)
+        if seq & 1:
+            continue
+        first = max(count - depth, 0)
+        readings = [HISTORY_ENTRY.unpack_from(shm, entries + (i % depth) * HISTORY_ENTRY.size) for i in range(first, count)]
+        if struct.unpack_from('<I', shm, ring)[0] == seq:
+            break
+    if not readings:
+        return None
+    oldest = readings[0][1]
+    return [r for r in readings if from_ts <= r[1] <= to_ts], oldest
+
 # --- C�c route API c?a b?n (d� th�m decorator) ---
 
 @app.route('/sensors')
@@ -148,6 +282,8 @@ def get_sensors():
 @app.route('/sensor/<int:sensor_id>/latest')
 @login_required
 def latest(sensor_id):
+    cached = read_latest(sensor_id)
+    if cached: return jsonify(cached)
     conn = sqlite3.connect(DB_FILE)
     cur = conn.cursor()
     cur.execute("SELECT sensor_value, timestamp FROM SensorData WHERE sensor_id = ? ORDER BY timestamp DESC LIMIT 1", (sensor_id,))
@@ -159,14 +295,46 @@ def latest(sensor_id):
 @app.route('/sensor/<int:sensor_id>/history')
 @login_required
 def history(sensor_id):
-    from_ts = request.args.get('from', 0)
-    to_ts = request.args.get('to', int(time.time()))
+    from_ts = int(request.args.get('from', 0))
+    to_ts = int(request.args.get('to', int(time.time())))
+    rows = []
+    disk_to = to_ts
+    recent = read_history(sensor_id, from_ts, to_ts)
+    if recent:
+        # readings newer than the oldest one in memory come from the ring, only older ones from disk
+        readings, oldest = recent
+        rows = [(value, ts) for value, ts in readings if ts > oldest]
+        disk_to = min(to_ts, oldest)
+    if from_ts <= disk_to:
+        conn = sqlite3.connect(DB_FILE)
+        cur = conn.cursor()
+        cur.execute("SELECT sensor_value AS value, timestamp FROM SensorData WHERE sensor_id = ? AND timestamp BETWEEN ? AND ? ORDER BY timestamp ASC", (sensor_id, from_ts, disk_to))
+        rows = cur.fetchall() + rows
+        conn.close()
+    rows.sort(key=lambda row: row[1])
+    return jsonify([{"value": row[0], "timestamp": row[1]} for row in rows])
+
+@app.route('/room/<int:room_id>/stats')
+@login_required
+def room_stats(room_id):
+    cached = read_room_stats(room_id)
+    if cached: return jsonify(cached)
+    # without a running gateway aggregate the latest stored value of every sensor in the room
+    members = {sid: info['type'] for sid, info in load_sensor_room_type_map().items() if info['room_id'] == room_id}
+    stats = {}
+    timestamp = 0
     conn = sqlite3.connect(DB_FILE)
     cur = conn.cursor()
-    cur.execute("SELECT sensor_value AS value, timestamp FROM SensorData WHERE sensor_id = ? AND timestamp BETWEEN ? AND ? ORDER BY timestamp ASC", (sensor_id, int(from_ts), int(to_ts)))
-    rows = cur.fetchall()
+    for sensor_id, sensor_type in members.items():
+        cur.execute("SELECT sensor_value, timestamp FROM SensorData WHERE sensor_id = ? ORDER BY timestamp DESC LIMIT 1", (sensor_id,))
+        row = cur.fetchone()
+        if not row: continue
+        stats.setdefault(sensor_type, []).append(row[0])
+        timestamp = max(timestamp, row[1])
     conn.close()
-    return jsonify([{"value": row[0], "timestamp": row[1]} for row in rows])
+    types = {name: {"count": len(values), "mean": sum(values) / len(values), "min": min(values), "max": max(values)}
+             for name, values in stats.items()}
+    return jsonify({"room_id": room_id, "timestamp": timestamp, "types": types})
 
 @app.route('/sensor/<int:sensor_id>/range')
 @login_required
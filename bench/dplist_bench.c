@@ -0,0 +1,133 @@
+#define _GNU_SOURCE
+
+/*
+ * Compares dplist_t with dparray_t (pointer and inline storage) on the operations the gateway uses:
+ * appending, indexed access, inserting and removing at a random index and a full scan.
+ * Usage: dplist_bench [size ...], the default sizes are 10, 1000 and 100000
+ * Building the dplist of 100000 elements is quadratic and takes about a minute on its own
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include "dplist.h"
+#include "dparray.h"
+
+// number of random accesses, inserts and removes that are timed per size
+#define BENCH_SAMPLES 1000
+
+typedef struct {
+    uint16_t id;
+    double value;
+    long ts;
+} bench_element_t;
+
+typedef struct {
+    const char* name;
+    void* (*create)();
+    void (*insert)(void* list, bench_element_t* element, int index);
+    void (*remove)(void* list, int index);
+    bench_element_t* (*get)(void* list, int index);
+    void (*destroy)(void* list);
+} bench_container_t;
+
+// dplist and dparray callbacks
+static void* element_copy(void* element){
+    bench_element_t* copy = malloc(sizeof(bench_element_t));
+    *copy = *(bench_element_t*) element;
+    return copy;
+}
+
+static void element_free(void** element){
+    free(*element);
+    *element = NULL;
+}
+
+static int element_compare(void* x, void* y){
+    uint16_t x_id = ((bench_element_t*) x)->id;
+    uint16_t y_id = ((bench_element_t*) y)->id;
+    return (x_id == y_id) ? 0 : ((x_id > y_id) ? 1 : -1);
+}
+
+// dplist_t
+static void* list_create(){ return dpl_create(element_copy, element_free, element_compare); }
+static void list_insert(void* list, bench_element_t* element, int index){ dpl_insert_at_index(list, element, index, true); }
+static void list_remove(void* list, int index){ dpl_remove_at_index(list, index, true); }
+static bench_element_t* list_get(void* list, int index){ return dpl_get_element_at_index(list, index); }
+static void list_destroy(void* list){ dpl_free((dplist_t**) &list, true); }
+
+// dparray_t with pointer storage
+static void* array_create(){ return dpa_create(element_copy, element_free, element_compare); }
+static void array_insert(void* list, bench_element_t* element, int index){ dpa_insert_at_index(list, element, index, true); }
+static void array_remove(void* list, int index){ dpa_remove_at_index(list, index, true); }
+static bench_element_t* array_get(void* list, int index){ return dpa_get_element_at_index(list, index); }
+static void array_destroy(void* list){ dpa_free((dparray_t**) &list, true); }
+
+// dparray_t with inline storage
+static void* inline_create(){ return dpa_create_inline(sizeof(bench_element_t), NULL, element_compare); }
+
+static const bench_container_t containers[] = {
+    {"dplist", list_create, list_insert, list_remove, list_get, list_destroy},
+    {"dparray", array_create, array_insert, array_remove, array_get, array_destroy},
+    {"dparray-inline", inline_create, array_insert, array_remove, array_get, array_destroy},
+};
+
+static double bench_now(){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1e9 + now.tv_nsec;
+}
+
+static void bench_run(const bench_container_t* container, int size){
+    void* list = container->create();
+    bench_element_t element = {0};
+    double checksum = 0;
+
+    // append 'size' elements
+    double start = bench_now();
+    for(int i = 0; i < size; i++){
+        element.id = (uint16_t) i;
+        element.value = i * 0.5;
+        element.ts = i;
+        container->insert(list, &element, size);
+    }
+    double append = (bench_now() - start) / size;
+
+    // random indexed access
+    srand(size);
+    start = bench_now();
+    for(int i = 0; i < BENCH_SAMPLES; i++) checksum += container->get(list, rand() % size)->value;
+    double get = (bench_now() - start) / BENCH_SAMPLES;
+
+    // insert and remove at a random index, the size stays the same
+    start = bench_now();
+    for(int i = 0; i < BENCH_SAMPLES; i++){
+        int index = rand() % size;
+        container->insert(list, &element, index);
+        container->remove(list, index);
+    }
+    double insert_remove = (bench_now() - start) / BENCH_SAMPLES;
+
+    // scan every element by index, capped so the list stays measurable at large sizes
+    int scan = size < 10 * BENCH_SAMPLES ? size : 10 * BENCH_SAMPLES;
+    start = bench_now();
+    for(int i = 0; i < scan; i++) checksum += container->get(list, i)->value;
+    double scan_ns = (bench_now() - start) / scan;
+
+    container->destroy(list);
+    printf("%-16s %8d %14.1f %14.1f %16.1f %14.1f   (%g)\n", container->name, size, append, get, insert_remove, scan_ns, checksum);
+}
+
+int main(int argc, char* argv[]){
+    int default_sizes[] = {10, 1000, 100000};
+    int count = argc > 1 ? argc - 1 : 3;
+
+    printf("%-16s %8s %14s %14s %16s %14s\n", "container", "size", "append ns/op", "get ns/op", "ins+rm ns/op", "scan ns/op");
+    for(int i = 0; i < count; i++){
+        int size = argc > 1 ? atoi(argv[i + 1]) : default_sizes[i];
+        if(size <= 0) continue;
+        for(int c = 0; c < (int) (sizeof(containers) / sizeof(containers[0])); c++) bench_run(&containers[c], size);
+    }
+    return 0;
+}
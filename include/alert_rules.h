@@ -0,0 +1,79 @@
+#ifndef _ALERT_RULES_H_
+#define _ALERT_RULES_H_
+
+#include <stdio.h>
+#include "config.h"
+#include "sensor_map.h"
+
+#define ALERT_RULES_FILE "alert.rules"
+
+#ifndef SET_MAX_TEMP
+#error SET_MAX_TEMP not set
+#endif
+
+#ifndef SET_MIN_TEMP
+#error SET_MIN_TEMP not set
+#endif
+
+#define ALERT_RULES_FAILURE -1
+#define ALERT_RULES_SUCCESS 0
+
+// seconds between two reminders while a sensor stays out of range, used by the default rule
+#ifndef ALERT_REPEAT_INTERVAL
+#define ALERT_REPEAT_INTERVAL 60
+#endif
+
+// the rule table holds at most this many rules, the default rule included
+#ifndef ALERT_RULES_MAX
+#define ALERT_RULES_MAX 4096
+#endif
+
+// alert state of a sensor, it only changes when the average crosses a threshold (minus the hysteresis)
+typedef enum {
+    ALERT_NORMAL = 0,
+    ALERT_HOT = 1,
+    ALERT_COLD = 2
+} alert_state_t;
+
+typedef struct {
+    sensor_value_t min;         /** < the running average is too cool below 'min' */
+    sensor_value_t max;         /** < the running average is too hot above 'max' */
+    sensor_value_t hysteresis;  /** < distance the average must move back inside the range to clear an alert */
+    int interval;               /** < seconds between reminders while the sensor stays out of range, 0 for none */
+} alert_rule_t;
+
+/**
+ * Reads the rule table, every line holds '<scope> <id> <min> <max> [hysteresis] [interval]'
+ * The scope is 'sensor', 'room', 'type' (the id is a type name of type.map) or 'default' (the id is ignored)
+ * The most specific rule wins: sensor, room, type, default. Without a default rule SET_MIN_TEMP and SET_MAX_TEMP are used
+ * \param fp_rules file pointer to the rule file, NULL to use the default rule only
+ * \return ALERT_RULES_SUCCESS on success and ALERT_RULES_FAILURE if an error occurred
+ */
+int alert_rules_init(FILE* fp_rules);
+
+/**
+ * Asks alert_rules_poll to reload the rule file, only sets a flag so it is safe to call from a signal handler
+ */
+void alert_rules_request_reload();
+
+/**
+ * Reloads ALERT_RULES_FILE if a reload was requested, the current rules stay if the file can not be read
+ * Only the datamgr thread may call this
+ */
+void alert_rules_poll();
+
+/**
+ * Finds the rule of a sensor in O(1)
+ * \param sensor_id the sensor id
+ * \param room_id the room of the sensor
+ * \param type the type of the sensor
+ * \return the most specific rule, never NULL after alert_rules_init
+ */
+const alert_rule_t* alert_rules_find(sensor_id_t sensor_id, room_id_t room_id, sensor_type_t type);
+
+/**
+ * Frees the rule table
+ */
+void alert_rules_free();
+
+#endif  //_ALERT_RULES_H_
@@ -11,6 +11,7 @@
 #include "dplist.h"
 #include "tcpsock.h"
 #include <stdbool.h>
+#include "notifier.h"
 
 
 #define OFF_CLR     "\033[0m"
@@ -46,35 +47,25 @@ typedef uint16_t sensor_id_t;
 typedef uint16_t room_id_t;
 typedef double sensor_value_t;
 typedef time_t sensor_ts_t;
+typedef int64_t sensor_time_t;      // microseconds since the epoch
 typedef struct pollfd pollfd_t;
 
-// structure to hold sensors
-typedef struct{
-    sensor_id_t sensor_id;
-    room_id_t room_id;
-    sensor_value_t running_avg;
-    sensor_ts_t last_modified;
-    sensor_value_t data_buffer[RUN_AVG_LENGTH]; //circular buffer to hold the variables
-    bool take_avg;
-    uint16_t buffer_position;
-}sensor_t; //element t in the dplist
+#define SENSOR_TIME_SECOND 1000000LL
 
 // structure to hold sensor_data
 typedef struct {
     sensor_id_t id;         /** < sensorkk id */
     sensor_value_t value;   /** < sensor value */
-    sensor_ts_t ts;         /** < sensor timestamp */
+    sensor_ts_t ts;         /** < sensor timestamp, the whole second of time */
+    sensor_time_t time;     /** < sensor timestamp with sub-second resolution, 0 if the sensor only sent ts */
 } sensor_data_t;
 
 // structure for multi-threading
 typedef struct {
-    pthread_cond_t* data_cond;
-    pthread_mutex_t* datamgr_lock;
-    int* data_mgr;
-
-    pthread_cond_t* db_cond;
-    pthread_mutex_t* db_lock;
-    int* data_sensor_db;
+    // readings the connmgr added to the buffer for every reader thread
+    notifier_t* datamgr_notify;
+    notifier_t* db_notify;
+    notifier_t* stream_notify;
 
     pthread_rwlock_t* connmgr_lock;
     bool* connmgr_working;
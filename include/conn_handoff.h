@@ -0,0 +1,83 @@
+#ifndef _CONN_HANDOFF_H_
+#define _CONN_HANDOFF_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include "config.h"
+#include "conn_table.h"
+
+#define CONN_HANDOFF_FAILURE -1
+#define CONN_HANDOFF_SUCCESS 0
+
+// the Unix socket a running gateway listens on for its successor, in the working directory
+#define CONN_HANDOFF_SOCKET "gateway.handoff"
+
+// how long (ms) one side waits for the next message of the other
+#ifndef CONN_HANDOFF_TIMEOUT_MS
+#define CONN_HANDOFF_TIMEOUT_MS 5000
+#endif
+
+#define CONN_HANDOFF_MAGIC 0x53474831u
+
+/*
+ * Hands the sockets of a running gateway to a new gateway process over a Unix socket (SOCK_SEQPACKET, SCM_RIGHTS).
+ * The old gateway sends a header with the listening socket, the UDP socket if it has one, then one message per sensor connection with its state,
+ * and waits for one byte from the new gateway before it lets go of the sockets. A connection is never shut down on
+ * the way, the sensor nodes do not notice the handoff.
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t count;                     /** < sensor connections that follow */
+    uint32_t udp;                       /** < 1 if the UDP socket follows first, in a copy of the header */
+} conn_handoff_header_t;
+
+typedef struct {
+    sensor_id_t sensor_id;              /** < 0 if the sensor did not send a complete reading yet */
+    uint8_t frame_len;
+    uint8_t frame[CONN_FRAME_SIZE];     /** < the start of a reading that was not complete yet */
+    uint32_t timeout;                   /** < the idle timeout of the connection in ms */
+    uint32_t idle;                      /** < ms since the last data of the connection */
+} conn_handoff_state_t;
+
+/**
+ * Creates the Unix socket a successor connects to, a socket file left behind by a gateway that is gone is replaced
+ * \param path the path of the socket
+ * \return the nonblocking listening descriptor, -1 if it can not be created
+ */
+int conn_handoff_listen(const char* path);
+
+/**
+ * Takes a successor that connected, without waiting
+ * \param listener the descriptor of conn_handoff_listen
+ * \return the channel to the successor, -1 if there is none
+ */
+int conn_handoff_accept(int listener);
+
+/**
+ * Connects to the gateway that listens on 'path'
+ * \param path the path of the socket
+ * \return the channel to the running gateway, -1 if no gateway listens
+ */
+int conn_handoff_connect(const char* path);
+
+/**
+ * Sends one message, optionally with a descriptor
+ * \param channel the channel
+ * \param fd the descriptor to pass, -1 for none
+ * \param data the message
+ * \param size the size of the message
+ * \return CONN_HANDOFF_SUCCESS, CONN_HANDOFF_FAILURE if the message could not be sent
+ */
+int conn_handoff_send(int channel, int fd, const void* data, size_t size);
+
+/**
+ * Receives one message of exactly 'size' bytes, waits at most CONN_HANDOFF_TIMEOUT_MS
+ * \param channel the channel
+ * \param fd set to the descriptor of the message, -1 if the message had none
+ * \param data filled out with the message
+ * \param size the size of the message
+ * \return CONN_HANDOFF_SUCCESS, CONN_HANDOFF_FAILURE on a timeout, a closed channel or a message of another size
+ */
+int conn_handoff_receive(int channel, int* fd, void* data, size_t size);
+
+#endif  //_CONN_HANDOFF_H_
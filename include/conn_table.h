@@ -0,0 +1,130 @@
+#ifndef _CONN_TABLE_H_
+#define _CONN_TABLE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <poll.h>
+#include "config.h"
+#include "tcpsock.h"
+#include "local_ring.h"
+#include "timer_wheel.h"
+
+#define CONN_TABLE_FAILURE -1
+#define CONN_TABLE_SUCCESS 0
+
+// connections are allocated in chunks of this many slots, a connection never moves once it is added
+#ifndef CONN_TABLE_CHUNK
+#define CONN_TABLE_CHUNK 256
+#endif
+
+// size of one reading on the wire: <sensor_id><temperature><timestamp>
+#define CONN_FRAME_SIZE (sizeof(sensor_id_t) + sizeof(sensor_value_t) + sizeof(sensor_ts_t))
+
+// a slot and the generation it had when the handle was taken, the handle goes stale when the slot is released
+typedef uint64_t conn_handle_t;
+
+typedef struct {
+    sensor_id_t sensor_id;
+    tcpsock_t* socket_id;
+    local_ring_t* local;        /** < the ring of a producer on this host, NULL for a sensor on a socket */
+    uint64_t last_active;       /** < local monotonic time (ms) of the last data, see timer_wheel_clock */
+    uint64_t timeout;           /** < the connection is closed after 'timeout' ms without data */
+    timer_entry_t idle_timer;   /** < fires at the earliest moment the connection can be idle for 'timeout' */
+    int slot;                   /** < the slot of the connection in the table */
+    uint8_t frame_len;          /** < bytes of an incomplete reading in 'frame' */
+    uint8_t frame[CONN_FRAME_SIZE];  /** < the start of a reading whose other bytes have not arrived yet */
+} conn_t;
+
+/*
+ * Connection slab of the connmgr. Slot i of 'pollfds' belongs to connection i, so the array is passed to poll() as is:
+ * free slots have fd -1 and are skipped by poll(). Released slots go on a free list and are reused first,
+ * which keeps the used slots packed at the front. 'slot_of_fd' finds the slot of a file descriptor in O(1).
+ */
+typedef struct {
+    int count;                  /** < used slots */
+    int high;                   /** < slots >= high are free, poll() only needs pollfds[0 .. high - 1] */
+    int capacity;               /** < allocated slots */
+    struct pollfd* pollfds;
+    conn_t** chunks;            /** < slot i is chunks[i / CONN_TABLE_CHUNK][i % CONN_TABLE_CHUNK] */
+    uint32_t* generation;       /** < incremented every time a slot is released */
+    int* next_free;             /** < next slot on the free list, -1 at the end */
+    int free_head;              /** < first free slot below 'capacity', -1 if the table is full */
+    int* slot_of_fd;            /** < slot + 1 of every file descriptor, 0 if the descriptor has no slot */
+    int fd_capacity;
+} conn_table_t;
+
+/**
+ * Allocates and initializes an empty connection table
+ * \param table a double pointer to the table that needs to be initialized
+ * \return CONN_TABLE_SUCCESS on success and CONN_TABLE_FAILURE if an error occurred
+ */
+int conn_table_init(conn_table_t** table);
+
+/**
+ * Takes a free slot for a connection, the table grows when it is full
+ * The connection is zeroed except for its socket and slot, poll() waits for 'events' on 'fd'
+ * \param table the connection table
+ * \param fd the file descriptor of the connection, it must not have a slot yet
+ * \param events the events to poll for
+ * \param socket the socket of the connection
+ * \return the new connection, NULL if the table could not grow
+ */
+conn_t* conn_table_add(conn_table_t* table, int fd, short events, tcpsock_t* socket);
+
+/**
+ * Releases the slot of a connection in O(1), the socket is not closed and every handle of the slot goes stale
+ * \param table the connection table
+ * \param slot the slot to release
+ */
+void conn_table_remove(conn_table_t* table, int slot);
+
+/**
+ * Returns the connection in a slot
+ * \param table the connection table
+ * \param slot a used slot
+ * \return the connection, it stays at the same address until its slot is released
+ */
+static inline conn_t* conn_table_get(conn_table_t* table, int slot){
+    return &(table->chunks[slot / CONN_TABLE_CHUNK][slot % CONN_TABLE_CHUNK]);
+}
+
+/**
+ * Finds the slot of a file descriptor in O(1)
+ * \param table the connection table
+ * \param fd the file descriptor
+ * \return the slot of the connection, -1 if the descriptor has no slot
+ */
+static inline int conn_table_find(conn_table_t* table, int fd){
+    if(fd < 0 || fd >= table->fd_capacity) return -1;
+    return table->slot_of_fd[fd] - 1;
+}
+
+/**
+ * Returns a handle to the current connection in a slot
+ * \param table the connection table
+ * \param slot a used slot
+ * \return the handle
+ */
+static inline conn_handle_t conn_table_handle(conn_table_t* table, int slot){
+    return ((conn_handle_t) table->generation[slot] << 32) | (uint32_t) slot;
+}
+
+/**
+ * Resolves a handle
+ * \param table the connection table
+ * \param handle the handle
+ * \return the connection, NULL if the slot was released after the handle was taken
+ */
+static inline conn_t* conn_table_lookup(conn_table_t* table, conn_handle_t handle){
+    int slot = (int) (uint32_t) handle;
+    if(slot >= table->capacity || table->generation[slot] != (uint32_t) (handle >> 32)) return NULL;
+    return conn_table_get(table, slot);
+}
+
+/**
+ * Frees the table, the sockets of the remaining connections are not closed
+ * \param table a double pointer to the table that needs to be freed
+ */
+void conn_table_free(conn_table_t** table);
+
+#endif  //_CONN_TABLE_H_
@@ -0,0 +1,133 @@
+#ifndef _CONN_URING_H_
+#define _CONN_URING_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define CONN_URING_FAILURE -1
+#define CONN_URING_SUCCESS 0
+
+// submission queue entries, the completion queue is four times as large because every multishot request keeps posting
+#ifndef CONN_URING_ENTRIES
+#define CONN_URING_ENTRIES 256
+#endif
+
+// received data is written by the kernel into one of these buffers (a power of 2)
+#ifndef CONN_URING_BUFFERS
+#define CONN_URING_BUFFERS 256
+#endif
+
+#ifndef CONN_URING_BUFFER_SIZE
+#define CONN_URING_BUFFER_SIZE 4096
+#endif
+
+// user_data of the multishot accept, and of requests whose completion is not interesting (e.g. a cancel)
+#define CONN_URING_ACCEPT UINT64_MAX
+#define CONN_URING_IGNORE (UINT64_MAX - 1)
+// user_data of the multishot poll of conn_uring_poll
+#define CONN_URING_POLL (UINT64_MAX - 3)
+
+/*
+ * io_uring for the connmgr, on the raw system calls.
+ * One multishot accept on the server and one multishot receive per connection stay armed for the lifetime of the
+ * connection: a reading costs no system call of its own, the connmgr only enters the kernel once per wakeup to wait.
+ * The kernel picks the buffer of a receive from a ring of provided buffers that is registered with the ring.
+ */
+typedef struct conn_uring conn_uring_t;
+
+typedef struct {
+    uint64_t user_data;         /** < CONN_URING_ACCEPT, CONN_URING_POLL, CONN_URING_IGNORE or the user_data of a receive */
+    int32_t res;                /** < the new descriptor (accept), the number of bytes (receive), the ready events (poll) or -errno */
+    uint32_t flags;             /** < IORING_CQE_F_* */
+    bool more;                  /** < the request stays armed, otherwise it has to be queued again */
+} conn_uring_event_t;
+
+/**
+ * Creates a ring and registers the receive buffers
+ * It fails when the kernel has no multishot accept and receive or no provided buffer rings (before Linux 6.0)
+ * \param ring a double pointer to the ring that needs to be created
+ * \return CONN_URING_SUCCESS on success and CONN_URING_FAILURE if io_uring can not be used
+ */
+int conn_uring_init(conn_uring_t** ring);
+
+/**
+ * Queues a multishot accept, every new connection posts an event with CONN_URING_ACCEPT
+ * \param ring the ring
+ * \param server_fd the listening socket
+ * \return CONN_URING_SUCCESS, CONN_URING_FAILURE if the submission queue is full
+ */
+int conn_uring_accept(conn_uring_t* ring, int server_fd);
+
+/**
+ * Queues a multishot receive, every chunk of data posts an event with 'user_data' and a buffer
+ * \param ring the ring
+ * \param fd the connected socket
+ * \param user_data returned in the events of this receive
+ * \return CONN_URING_SUCCESS, CONN_URING_FAILURE if the submission queue is full
+ */
+int conn_uring_recv(conn_uring_t* ring, int fd, uint64_t user_data);
+
+/**
+ * Queues a multishot poll for POLLIN, every wakeup of the socket posts an event with CONN_URING_POLL
+ * The data is not read: the caller reads it until the socket would block, a wakeup is only posted for new data
+ * \param ring the ring
+ * \param fd the socket
+ * \return CONN_URING_SUCCESS, CONN_URING_FAILURE if the submission queue is full
+ */
+int conn_uring_poll(conn_uring_t* ring, int fd);
+
+/**
+ * Queues a single poll for POLLIN, its event carries 'user_data' and the ready events in 'res' and is never followed by another
+ * \param ring the ring
+ * \param fd the socket
+ * \param user_data returned in the event of this poll
+ * \return CONN_URING_SUCCESS, CONN_URING_FAILURE if the submission queue is full
+ */
+int conn_uring_poll_once(conn_uring_t* ring, int fd, uint64_t user_data);
+
+/**
+ * Queues the cancellation of every request with 'user_data', queue it before the socket is closed
+ * \param ring the ring
+ * \param user_data the user_data of the requests
+ * \return CONN_URING_SUCCESS, CONN_URING_FAILURE if the submission queue is full
+ */
+int conn_uring_cancel(conn_uring_t* ring, uint64_t user_data);
+
+/**
+ * Submits the queued requests and waits until there is an event or 'timeout_ms' has passed
+ * \param ring the ring
+ * \param timeout_ms the maximum time to wait in milliseconds
+ * \return CONN_URING_SUCCESS, CONN_URING_FAILURE if the ring can not be entered
+ */
+int conn_uring_wait(conn_uring_t* ring, int timeout_ms);
+
+/**
+ * Takes the next event, the buffer of a receive event must be given back with conn_uring_release
+ * \param ring the ring
+ * \param event filled out with the event
+ * \return true if there was an event
+ */
+bool conn_uring_next(conn_uring_t* ring, conn_uring_event_t* event);
+
+/**
+ * Returns the received data of an event
+ * \param ring the ring
+ * \param event a receive event with res > 0
+ * \return the first of 'event->res' bytes, NULL if the event has no buffer
+ */
+const uint8_t* conn_uring_buffer(conn_uring_t* ring, const conn_uring_event_t* event);
+
+/**
+ * Gives the buffer of an event back to the kernel, events without a buffer are ignored
+ * \param ring the ring
+ * \param event the event
+ */
+void conn_uring_release(conn_uring_t* ring, const conn_uring_event_t* event);
+
+/**
+ * Closes the ring, every pending request is cancelled
+ * \param ring a double pointer to the ring that needs to be freed
+ */
+void conn_uring_free(conn_uring_t** ring);
+
+#endif  //_CONN_URING_H_
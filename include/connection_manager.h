@@ -5,10 +5,72 @@
 #include "config.h"
 #include "sensor_buffer.h"
 
+// default idle timeout of a connection in seconds, can be changed at runtime with connmgr_set_timeout
 #ifndef TIMEOUT
 #define TIMEOUT 5
 #endif
 
+// bytes read from a socket with one call, and the number of reads per socket in one poll iteration
+#ifndef CONNMGR_READ_SIZE
+#define CONNMGR_READ_SIZE 4096
+#endif
+
+#ifndef CONNMGR_READ_BUDGET
+#define CONNMGR_READ_BUDGET 4
+#endif
+
+// the number of pending connections accepted at once
+#ifndef CONNMGR_ACCEPT_BATCH
+#define CONNMGR_ACCEPT_BATCH 64
+#endif
+
+// I/O backend of the connmgr: io_uring when the kernel supports it (auto), only poll, or io_uring with a warning when it falls back
+#define CONNMGR_BACKEND_AUTO 0
+#define CONNMGR_BACKEND_POLL 1
+#define CONNMGR_BACKEND_URING 2
+
+#ifndef CONNMGR_BACKEND
+#define CONNMGR_BACKEND CONNMGR_BACKEND_AUTO
+#endif
+
+// optional file with an idle timeout per sensor, every line holds '<sensor id> <timeout in seconds>'
+#define TIMEOUT_MAP_FILE "timeout.map"
+
+// while handing the sockets over, the receives of io_uring get this many ticks to post their last completion
+#ifndef CONNMGR_HANDOFF_TICKS
+#define CONNMGR_HANDOFF_TICKS 10
+#endif
+
+// and the datamgr gets this long (ms) to take the readings that were added before the snapshot is written for the new gateway
+#ifndef CONNMGR_HANDOFF_DRAIN_MS
+#define CONNMGR_HANDOFF_DRAIN_MS 2000
+#endif
+
+// UDP ingest: a datagram holds <sequence number><reading>..., one to CONNMGR_UDP_READINGS readings of one sensor
+// the sequence number (uint32_t) counts the datagrams of a sensor, a gap is counted as lost datagrams
+#ifndef CONNMGR_UDP_READINGS
+#define CONNMGR_UDP_READINGS 64
+#endif
+
+// datagrams taken with one recvmmsg, and the number of recvmmsg calls per iteration
+#ifndef CONNMGR_UDP_BATCH
+#define CONNMGR_UDP_BATCH 64
+#endif
+
+#ifndef CONNMGR_UDP_BUDGET
+#define CONNMGR_UDP_BUDGET 4
+#endif
+
+// receive buffer of the UDP socket in bytes, datagrams that arrive while it is full are dropped by the kernel
+#ifndef CONNMGR_UDP_RCVBUF
+#define CONNMGR_UDP_RCVBUF (4 * 1024 * 1024)
+#endif
+
+// a sequence number this far behind the expected one, or 0 behind the remembered ones, means the sensor restarted and the count starts over
+#ifndef CONNMGR_UDP_RESTART
+#define CONNMGR_UDP_RESTART 1024
+#endif
+
 
 /**
  * Initialise the connmgr
@@ -16,6 +78,34 @@
  */
 void connmgr_init(config_thread_t* config_thread);
 
+/**
+ * Sets the default idle timeout, a sensor that sends no data for this long is disconnected
+ * The connmgr also stops when no sensor is connected for this long. Call it before connmgr_listen
+ * \param seconds the timeout in seconds, values <= 0 keep TIMEOUT
+ */
+void connmgr_set_timeout(int seconds);
+
+/**
+ * Selects the I/O backend, the connmgr falls back to poll when io_uring is not available. Call it before connmgr_listen
+ * \param name "auto", "uring" or "poll"
+ * \return 0 on success, -1 if the name is unknown
+ */
+int connmgr_set_backend(const char* name);
+
+/**
+ * Also receives readings as UDP datagrams on 'port', next to the TCP connections. Call it before connmgr_listen
+ * UDP sensors do not connect: they are not disconnected when idle, but their datagrams keep the connmgr running
+ * \param port the UDP port, 0 disables UDP (the default)
+ */
+void connmgr_set_udp_port(int port);
+
+/**
+ * Asks the connmgr to stop, only sets a flag so it is safe to call from a signal handler
+ * At its next tick the connmgr stops accepting, closes the sensors and closes the notifiers: the reader threads
+ * drain what is left in the buffer and return
+ */
+void connmgr_request_stop();
+
 /**
  * This method holds the core functionality of the connmgr. 
  * It starts listening on the given port and when when a sensor node connects it writes the data to a sensor_data_recv file.
@@ -25,6 +115,19 @@ void connmgr_init(config_thread_t* config_thread);
  */
 void connmgr_listen(int port_number, sbuffer_t** buffer);
 
+/**
+ * Waits until connmgr_listen opened the server, after it took the sockets over from a running gateway if there was one
+ * The running gateway wrote its snapshot before and does not write the shared state any more after a takeover
+ * \return true if the sockets were taken over, false if the server was opened
+ */
+bool connmgr_wait_started();
+
+/**
+ * Tells whether the sockets were handed over to a new gateway, the snapshot and the shared memory belong to it from then on
+ * \return true after a successful handoff, until the process exits
+ */
+bool connmgr_handed_over();
+
 /**
  * This method should be called to clean up the connmgr, and to free all used memory. 
  * After this no new connections will be accepted
@@ -11,6 +11,23 @@
 #define RUN_AVG_LENGTH 5
 #endif
 
+// a sensor that did not report for SENSOR_STALE_AGE seconds is logged as silent, checked every SENSOR_SWEEP_INTERVAL seconds
+#ifndef SENSOR_STALE_AGE
+#define SENSOR_STALE_AGE 60
+#endif
+
+#ifndef SENSOR_SWEEP_INTERVAL
+#define SENSOR_SWEEP_INTERVAL 10
+#endif
+
+// the sensor state is saved every SENSOR_CHECKPOINT_INTERVAL seconds and when the datamgr stops, and restored at startup
+// after a handoff only the new gateway saves it
+#ifndef SENSOR_CHECKPOINT_INTERVAL
+#define SENSOR_CHECKPOINT_INTERVAL 60
+#endif
+
+#define SENSOR_SNAPSHOT_FILE "sensor_state.snap"
+
 #ifndef SET_MAX_TEMP
 #error SET_MAX_TEMP not set
 #endif
@@ -26,12 +43,20 @@
 void datamgr_init(config_thread_t* config_thread);
 
 /**
- *  This method holds the core functionality of your datamgr. It takes in 2 file pointers to the sensor files and parses them.
- *  When the method finishes all data should be in the internal pointer list and all log messages should be printed to stderr.
- *  \param fp_sensor_map file pointer to the map file
- *  \param fp_sensor_data file pointer to the binary data file
+ *  This method holds the core functionality of your datamgr. It reads the sensor data from the buffer and processes it.
+ *  Sensors are taken from the shared sensor map, a sensor is added the first time it reports while it is in the map.
+ *  When the method finishes all data should be in the sensor table and all log messages should be printed to stderr.
+ *  \param sbuffer the shared buffer to read from
  */
-void datamgr_parse_sensor_files(FILE* fp_sensor_map, sbuffer_t** sbuffer);
+void datamgr_parse_sensor_files(sbuffer_t** sbuffer);
+
+/**
+ * Writes the snapshot a new gateway starts from, the connmgr calls it while it hands its sockets over and adds no readings
+ * It first waits until the datamgr took every reading that was added: the datamgr does not touch its table while none is pending
+ * \param timeout_ms how long to wait for the datamgr at most
+ * \return 0 on success, -1 if the datamgr did not catch up in time or the snapshot could not be written
+ */
+int datamgr_handoff_checkpoint(int timeout_ms);
 
 /**
  * This method should be called to clean up the datamgr, and to free all used memory.
@@ -63,6 +88,12 @@ sensor_value_t datamgr_get_avg(sensor_id_t sensor_id);
  */
 time_t datamgr_get_last_modified(sensor_id_t sensor_id);
 
+/**
+ *  Writes a summary and the state of every sensor, one linear pass over the sensor table
+ *  \param fp the stream to write to
+ */
+void datamgr_dump_stats(FILE* fp);
+
 /**
  *  Return the total amount of unique sensor ID's recorded by the datamgr
  *  \return the total amount of sensors
@@ -15,6 +15,16 @@
 #define TABLE_NAME SensorData
 #endif
 
+// the readings of one transaction
+#ifndef DB_BATCH_MAX
+#define DB_BATCH_MAX 256
+#endif
+
+// how long (ms) a write waits for another connection to the database, e.g. of the gateway that hands over
+#ifndef DB_BUSY_TIMEOUT_MS
+#define DB_BUSY_TIMEOUT_MS 5000
+#endif
+
 #define DBCONN sqlite3
 
 typedef int (*callback_t)(void*, int, char**, char**);
@@ -50,6 +60,15 @@ void disconnect(DBCONN* conn);
  */
 int insert_sensor(DBCONN* conn, sensor_id_t id, sensor_value_t value, sensor_ts_t ts);
 
+/**
+ * Inserts 'count' sensor measurements in one transaction, a measurement that can not be inserted is skipped
+ * \param conn pointer to the current connection
+ * \param batch the measurements
+ * \param count the number of measurements in 'batch'
+ * \return zero for success, and non-zero if a measurement was skipped or the transaction failed
+ */
+int insert_sensor_batch(DBCONN* conn, const sensor_data_t** batch, int count);
+
 /**
  * Write an INSERT query to insert all sensor measurements available in the file 'sensor_data'
  * \param conn pointer to the current connection
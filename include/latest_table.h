@@ -0,0 +1,134 @@
+#ifndef _LATEST_TABLE_H_
+#define _LATEST_TABLE_H_
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include "config.h"
+#include "sensor_map.h"
+
+#ifndef LATEST_SHM_NAME
+#define LATEST_SHM_NAME "/sensor_latest"
+#endif
+
+#define LATEST_MAGIC    0x5453414C  // "LAST" in little endian
+#define LATEST_VERSION  2
+
+#define LATEST_FAILURE -1
+#define LATEST_SUCCESS 0
+#define LATEST_NO_DATA 1
+
+// one entry for every possible sensor_id_t, the entry of a sensor is found at index sensor_id
+#define LATEST_CAPACITY 65536
+
+// rooms are found at index room_id as well, rooms with a higher id are not published
+#ifndef LATEST_ROOM_CAPACITY
+#define LATEST_ROOM_CAPACITY 4096
+#endif
+
+/*
+ * Layout of the shared memory segment (fixed size types only, other processes map it too):
+ *   latest_header_t                          (64 bytes)
+ *   latest_entry_t[LATEST_CAPACITY]          (32 bytes each)
+ *   latest_room_t[LATEST_ROOM_CAPACITY]      (112 bytes each, starting at 'room_offset')
+ *
+ * Every entry is protected by its own seqlock: 'seq' is odd while the data manager is writing,
+ * a reader copies the entry and retries if 'seq' was odd or changed during the copy.
+ * An entry with seq == 0 has never been written.
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t header_size;
+    uint32_t entry_size;
+    uint32_t capacity;
+    uint32_t room_offset;
+    uint32_t room_entry_size;
+    uint32_t room_capacity;
+    uint32_t reserved[8];
+} latest_header_t;
+
+typedef struct {
+    _Atomic uint32_t seq;       /** < seqlock sequence number */
+    uint16_t sensor_id;         /** < sensor id */
+    uint16_t room_id;           /** < room of the sensor */
+    double value;               /** < last received value */
+    double running_avg;         /** < running average computed by the datamgr */
+    int64_t ts;                 /** < timestamp of the last value */
+} latest_entry_t;
+
+// aggregate over the latest value of every sensor of one type in a room
+typedef struct {
+    uint32_t count;             /** < sensors of the type that reported */
+    uint32_t reserved;
+    double mean;
+    double min;
+    double max;
+} latest_room_stat_t;
+
+typedef struct {
+    _Atomic uint32_t seq;       /** < seqlock sequence number */
+    uint16_t room_id;           /** < room id */
+    uint16_t reserved;
+    int64_t ts;                 /** < timestamp of the reading that last changed the room */
+    latest_room_stat_t types[SENSOR_TYPE_NR];
+} latest_room_t;
+
+/**
+ * Creates the shared memory segment and maps it for writing (called once by the gateway)
+ * \param keep true to continue a valid segment of the gateway this one took over from, instead of resetting it
+ * \return LATEST_SUCCESS on success and LATEST_FAILURE if an error occurred
+ */
+int latest_table_init(bool keep);
+
+/**
+ * Maps an existing shared memory segment read-only (used by processes reading the table)
+ * \return LATEST_SUCCESS on success and LATEST_FAILURE if the segment does not exist or is invalid
+ */
+int latest_table_attach();
+
+/**
+ * Publishes the latest state of a sensor, only the datamgr thread may call this
+ * \param sensor_id the sensor id
+ * \param room_id the room of the sensor
+ * \param value the last received value
+ * \param running_avg the current running average
+ * \param ts the timestamp of the last value
+ */
+void latest_table_publish(sensor_id_t sensor_id, room_id_t room_id, sensor_value_t value,
+                          sensor_value_t running_avg, sensor_ts_t ts);
+
+/**
+ * Publishes the aggregates of a room, only the datamgr thread may call this
+ * \param room_id the room id
+ * \param stats the aggregate of every sensor type in the room
+ * \param ts the timestamp of the reading that changed the aggregates
+ */
+void latest_table_publish_room(room_id_t room_id, const latest_room_stat_t stats[SENSOR_TYPE_NR], sensor_ts_t ts);
+
+/**
+ * Copies a consistent snapshot of the entry of 'sensor_id' into 'entry', no system calls are made
+ * \param sensor_id the sensor id to look for
+ * \param entry pre-allocated space the entry is copied into
+ * \return LATEST_SUCCESS on success, LATEST_NO_DATA if the sensor never published and LATEST_FAILURE if the table is not mapped
+ */
+int latest_table_read(sensor_id_t sensor_id, latest_entry_t* entry);
+
+/**
+ * Copies a consistent snapshot of the aggregates of 'room_id' into 'room', no system calls are made
+ * \param room_id the room id to look for
+ * \param room pre-allocated space the aggregates are copied into
+ * \return LATEST_SUCCESS on success, LATEST_NO_DATA if the room never published and LATEST_FAILURE if the table is not mapped
+ */
+int latest_table_read_room(room_id_t room_id, latest_room_t* room);
+
+/**
+ * Leaves the segment to a new gateway: nothing is published any more and latest_table_free only unmaps it
+ */
+void latest_table_disown();
+
+/**
+ * Unmaps the table, the creator also removes the shared memory segment
+ */
+void latest_table_free();
+
+#endif  //_LATEST_TABLE_H_
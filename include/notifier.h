@@ -0,0 +1,89 @@
+#ifndef _NOTIFIER_H_
+#define _NOTIFIER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+// returned by notifier_wait when the notifier is closed and nothing is pending
+#define NOTIFIER_CLOSED -1
+
+// a consumer checks this many times for work before it parks on the futex
+#ifndef NOTIFIER_SPIN
+#define NOTIFIER_SPIN 200
+#endif
+
+// a parked consumer checks again at least this often (ms), notifier_close wakes it at once and the drain deadline
+// of a closed notifier (notifier_expired) is checked by the consumer between waits
+#ifndef NOTIFIER_PARK_MS
+#define NOTIFIER_PARK_MS 100
+#endif
+
+// a consumer keeps taking the pending items of a closed notifier for at most this long (ms)
+#ifndef NOTIFIER_DRAIN_MS
+#define NOTIFIER_DRAIN_MS 5000
+#endif
+
+/*
+ * Counts the readings a producer handed to one consumer thread.
+ * Posting is an atomic add: the futex is only woken when the consumer is parked, so a producer that keeps a busy
+ * consumer fed makes no system call and takes no lock.
+ */
+typedef struct {
+    atomic_int pending;                 /** < posted and not taken yet */
+    atomic_int sleepers;                /** < consumers that are parked or about to park */
+    atomic_uint futex;                  /** < the futex word, changed by every wakeup */
+    atomic_bool closed;
+    atomic_uint_fast64_t closed_at;     /** < CLOCK_MONOTONIC in ms, the start of the drain */
+    atomic_int drained;                 /** < items taken after the notifier was closed */
+    atomic_uint_fast64_t wakeups;       /** < number of futex wake calls, for the statistics */
+} notifier_t;
+
+/**
+ * Initializes an open notifier with nothing pending
+ * \param notifier the notifier
+ */
+void notifier_init(notifier_t* notifier);
+
+/**
+ * Adds 'count' pending items and wakes the consumer if it is parked
+ * \param notifier the notifier
+ * \param count the number of new items
+ */
+void notifier_post(notifier_t* notifier, int count);
+
+/**
+ * Waits until items are pending or the notifier is closed, it spins for a short while before it parks
+ * \param notifier the notifier
+ * \return the number of pending items, NOTIFIER_CLOSED if the notifier is closed and nothing is pending
+ */
+int notifier_wait(notifier_t* notifier);
+
+/**
+ * Returns the number of pending items without waiting
+ * \param notifier the notifier
+ * \return the number of pending items, NOTIFIER_CLOSED if the notifier is closed and nothing is pending
+ */
+int notifier_pending(notifier_t* notifier);
+
+/**
+ * Marks 'count' pending items as processed
+ * \param notifier the notifier
+ * \param count the number of processed items
+ */
+void notifier_take(notifier_t* notifier, int count);
+
+/**
+ * Closes the notifier and wakes every parked consumer, items that are still pending can be taken
+ * \param notifier the notifier
+ */
+void notifier_close(notifier_t* notifier);
+
+/**
+ * Tells a draining consumer to give up, the items that are still pending are dropped
+ * \param notifier the notifier
+ * \return true if the notifier was closed more than NOTIFIER_DRAIN_MS ago
+ */
+bool notifier_expired(notifier_t* notifier);
+
+#endif  //_NOTIFIER_H_
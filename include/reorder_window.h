@@ -0,0 +1,103 @@
+#ifndef _REORDER_WINDOW_H_
+#define _REORDER_WINDOW_H_
+
+#include <stdint.h>
+#include "config.h"
+
+#define REORDER_FAILURE -1
+#define REORDER_SUCCESS 0
+
+// a reading waits this long (ms) after it arrived, a reading of the same sensor with an earlier time can still overtake it
+#ifndef REORDER_DELAY_MS
+#define REORDER_DELAY_MS 100
+#endif
+
+// readings of one sensor that wait at most, a full window releases its oldest reading early
+#ifndef REORDER_WINDOW_SIZE
+#define REORDER_WINDOW_SIZE 8
+#endif
+
+// a timestamp further ahead of the local clock (ms) is replaced by the time of arrival
+#ifndef REORDER_MAX_AHEAD_MS
+#define REORDER_MAX_AHEAD_MS 2000
+#endif
+
+// and so is one older than this (s), a node keeps its readings for a while when the gateway is away
+#ifndef REORDER_MAX_AGE_S
+#define REORDER_MAX_AGE_S 86400
+#endif
+
+/*
+ * Puts the readings of every sensor back in the order of their timestamps before they are published.
+ * A timestamp the local clock does not trust is replaced first, a sensor with a skewed clock is ordered by arrival.
+ * Readings are held in a small window per sensor and released in time order once they waited REORDER_DELAY_MS,
+ * a reading that arrives after a later one of its sensor was released already is passed on at once and counted late.
+ */
+typedef struct reorder_window reorder_window_t;
+
+typedef struct {
+    uint64_t corrected;                 /** < timestamps replaced by the time of arrival */
+    uint64_t reordered;                 /** < readings that overtook a reading that arrived before them */
+    uint64_t late;                      /** < readings that arrived after the window of their sensor moved past them */
+} reorder_stats_t;
+
+// receives the readings in order, every reading that was added exactly once; it owns the reading from then on
+typedef void (*reorder_release_fn)(sensor_data_t* data, void* arg);
+
+/**
+ * Allocates and initializes an empty window
+ * \param window a double pointer to the window that needs to be initialized
+ * \param delay_ms how long a reading waits, 0 only validates the timestamps and passes every reading on at once
+ * \return REORDER_SUCCESS on success and REORDER_FAILURE if an error occurred
+ */
+int reorder_init(reorder_window_t** window, int delay_ms);
+
+/**
+ * Validates the timestamp of a reading and holds it in the window of its sensor
+ * 'time' is derived from 'ts' when it is 0 and 'ts' is derived from 'time' after the validation
+ * \param window the window
+ * \param data the reading, the window keeps the pointer while it waits (no copy is made)
+ * \param release called for every reading that leaves the window because of this one, possibly this reading itself
+ * \param arg passed to release
+ */
+void reorder_add(reorder_window_t* window, sensor_data_t* data, reorder_release_fn release, void* arg);
+
+/**
+ * Releases the readings that waited long enough
+ * \param window the window
+ * \param release called for every released reading
+ * \param arg passed to release
+ * \return the number of released readings
+ */
+int reorder_release(reorder_window_t* window, reorder_release_fn release, void* arg);
+
+/**
+ * Releases every reading that is held, in order per sensor
+ * \param window the window
+ * \param release called for every released reading
+ * \param arg passed to release
+ * \return the number of released readings
+ */
+int reorder_flush(reorder_window_t* window, reorder_release_fn release, void* arg);
+
+/**
+ * Returns how long the caller can wait before reorder_release has work
+ * \param window the window
+ * \return milliseconds, -1 if no reading is held
+ */
+int reorder_next_ms(reorder_window_t* window);
+
+/**
+ * Returns the counters of the window
+ * \param window the window
+ * \return the counters
+ */
+reorder_stats_t reorder_get_stats(reorder_window_t* window);
+
+/**
+ * Frees the window, readings that are still held are never released: call reorder_flush first
+ * \param window a double pointer to the window that needs to be freed
+ */
+void reorder_free(reorder_window_t** window);
+
+#endif  //_REORDER_WINDOW_H_
@@ -0,0 +1,51 @@
+#ifndef _ROOM_STATS_H_
+#define _ROOM_STATS_H_
+
+#include "config.h"
+#include "sensor_map.h"
+#include "latest_table.h"
+
+#define ROOM_STATS_FAILURE -1
+#define ROOM_STATS_SUCCESS 0
+#define ROOM_STATS_NO_DATA 1
+
+/**
+ * Builds the rooms and their members from the sensor map, all aggregates start empty
+ * \return ROOM_STATS_SUCCESS on success and ROOM_STATS_FAILURE if an error occurred
+ */
+int room_stats_init();
+
+/**
+ * Rebuilds the rooms and their members after the sensor map was reloaded
+ * The latest value of every sensor is kept, so the aggregates of all rooms are recomputed and published right away
+ * Only the datamgr thread may call this
+ * \param ts the timestamp the republished aggregates carry
+ * \return ROOM_STATS_SUCCESS on success and ROOM_STATS_FAILURE if an error occurred
+ */
+int room_stats_reload(sensor_ts_t ts);
+
+/**
+ * Updates the aggregates of the room and type of 'sensor_id' with a new reading and publishes them
+ * The mean and the count are updated in O(1), min and max only rescan the room when the old extreme moved inwards
+ * Only the datamgr thread may call this
+ * \param sensor_id the sensor id
+ * \param value the new value of the sensor
+ * \param ts the timestamp of the value
+ */
+void room_stats_update(sensor_id_t sensor_id, sensor_value_t value, sensor_ts_t ts);
+
+/**
+ * Gets the aggregate of one sensor type in a room in O(1)
+ * \param room_id the room id to look for
+ * \param type the sensor type
+ * \param stat pre-allocated space the aggregate is copied into
+ * \return ROOM_STATS_SUCCESS on success and ROOM_STATS_NO_DATA if no sensor of that type in the room reported
+ */
+int room_stats_get(room_id_t room_id, sensor_type_t type, latest_room_stat_t* stat);
+
+/**
+ * Frees all aggregates
+ */
+void room_stats_free();
+
+#endif  //_ROOM_STATS_H_
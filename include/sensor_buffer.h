@@ -8,11 +8,12 @@
 #define SBUFFER_SUCCESS 0
 #define SBUFFER_NO_DATA 1
 
-// enum to differentiate between the datamgr and db reader threads
-#define THREAD_NR 2
+// enum to differentiate between the datamgr, db and stream reader threads
+#define THREAD_NR 3
 typedef enum {
     DATAMGR_THREAD = 0,
-    DB_THREAD = 1
+    DB_THREAD = 1,
+    STREAM_THREAD = 2
 } READ_TH_ENUM;
 
 
@@ -41,6 +42,29 @@ int sbuffer_free(sbuffer_t** buffer);
  */
 int sbuffer_remove(sbuffer_t* buffer, sensor_data_t* data, READ_TH_ENUM check);
 
+/**
+ * Returns up to 'max' sensor data the 'thread' has not released yet, in order, by reference: nothing is copied
+ * The data stay valid, and are returned again by the next peek, until the thread releases them
+ * If 'buffer' is empty, the function doesn't block but returns SBUFFER_NO_DATA
+ * \param buffer a pointer to the buffer that is used
+ * \param data room for 'max' pointers, they point to the sensor data in the buffer
+ * \param max the maximum number of sensor data to return
+ * \param check the reader thread
+ * \param count the number of pointers written to 'data'
+ * \return SBUFFER_SUCCESS on success, SBUFFER_NO_DATA if there was nothing to read and SBUFFER_FAILURE if an error occurred
+ */
+int sbuffer_peek(sbuffer_t* buffer, const sensor_data_t** data, int max, READ_TH_ENUM check, int* count);
+
+/**
+ * Releases the first 'count' sensor data the 'thread' has not released yet, with a single lock acquisition
+ * The pointers returned by sbuffer_peek for them must not be used afterwards, the data is freed once every reader thread released it
+ * \param buffer a pointer to the buffer that is used
+ * \param count the number of sensor data to release
+ * \param check the reader thread
+ * \return SBUFFER_SUCCESS on success and SBUFFER_FAILURE if an error occurred
+ */
+int sbuffer_release(sbuffer_t* buffer, int count, READ_TH_ENUM check);
+
 /**
  * Inserts the sensor data in 'data' at the end of 'buffer' (at the 'tail')
  * \param buffer a pointer to the buffer that is used
@@ -49,4 +73,27 @@ int sbuffer_remove(sbuffer_t* buffer, sensor_data_t* data, READ_TH_ENUM check);
 */
 int sbuffer_insert(sbuffer_t* buffer, sensor_data_t* data);
 
+/**
+ * Takes a slot for new sensor data, the caller writes the data into it in place and then commits or cancels it
+ * The reader threads do not see the slot before it is committed
+ * \param buffer a pointer to the buffer that is used
+ * \return a pointer to the sensor data of the slot, NULL if an error occurred
+ */
+sensor_data_t* sbuffer_reserve(sbuffer_t* buffer);
+
+/**
+ * Inserts a reserved slot at the end of 'buffer' (at the 'tail'), the caller must not touch it afterwards
+ * \param buffer a pointer to the buffer that is used
+ * \param data the slot returned by sbuffer_reserve
+ * \return SBUFFER_SUCCESS on success and SBUFFER_FAILURE if an error occured
+ */
+int sbuffer_commit(sbuffer_t* buffer, sensor_data_t* data);
+
+/**
+ * Gives a reserved slot back without inserting it
+ * \param buffer a pointer to the buffer that is used
+ * \param data the slot returned by sbuffer_reserve
+ */
+void sbuffer_cancel(sbuffer_t* buffer, sensor_data_t* data);
+
 #endif  //_SBUFFER_H_
@@ -0,0 +1,111 @@
+#ifndef _SENSOR_HISTORY_H_
+#define _SENSOR_HISTORY_H_
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include "config.h"
+
+#ifndef HISTORY_SHM_NAME
+#define HISTORY_SHM_NAME "/sensor_history"
+#endif
+
+// number of recent readings kept in memory for every sensor
+#ifndef HISTORY_DEPTH
+#define HISTORY_DEPTH 1024
+#endif
+
+// number of rings in the arena, sensors that report after the arena is full have no in-memory history
+#ifndef HISTORY_SENSORS
+#define HISTORY_SENSORS 1024
+#endif
+
+#define HISTORY_MAGIC   0x54534948  // "HIST" in little endian
+#define HISTORY_VERSION 1
+
+#define HISTORY_FAILURE -1
+#define HISTORY_SUCCESS 0
+
+/*
+ * Layout of the shared memory segment (fixed size types only, other processes map it too):
+ *   history_header_t                          (64 bytes)
+ *   uint32_t index[65536]                     slab number + 1 of every sensor id, 0 if it has no ring
+ *   arena of 'slab_count' slabs of 'slab_size' bytes, every slab holds:
+ *       history_ring_t                        (16 bytes)
+ *       history_entry_t[depth]                (16 bytes each)
+ *
+ * Slabs are handed out from the arena to a sensor when its first reading arrives and are never returned.
+ * Every ring is protected by a seqlock like the entries of the latest table.
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t header_size;
+    uint32_t depth;                 /** < readings per ring */
+    uint32_t slab_size;             /** < bytes per slab */
+    uint32_t slab_count;            /** < slabs in the arena */
+    _Atomic uint32_t slabs_used;    /** < slabs handed out */
+    uint32_t index_offset;
+    uint32_t arena_offset;
+    uint32_t reserved[7];
+} history_header_t;
+
+typedef struct {
+    _Atomic uint32_t seq;   /** < seqlock sequence number */
+    uint16_t sensor_id;     /** < owner of the ring */
+    uint16_t reserved;
+    uint64_t count;         /** < readings ever written, the next one goes to count % depth */
+} history_ring_t;
+
+typedef struct {
+    double value;
+    int64_t ts;
+} history_entry_t;
+
+/**
+ * Creates the shared memory segment with an arena of 'sensors' rings of 'depth' readings (called once by the gateway)
+ * \param depth readings kept per sensor
+ * \param sensors number of rings in the arena
+ * \param keep true to continue a segment with the same layout of the gateway this one took over from, instead of resetting it
+ * \return HISTORY_SUCCESS on success and HISTORY_FAILURE if an error occurred
+ */
+int history_init(uint32_t depth, uint32_t sensors, bool keep);
+
+/**
+ * Maps an existing shared memory segment read-only (used by processes reading the history)
+ * \return HISTORY_SUCCESS on success and HISTORY_FAILURE if the segment does not exist or is invalid
+ */
+int history_attach();
+
+/**
+ * Appends a reading to the ring of 'sensor_id', a ring is taken from the arena on the first reading
+ * Only the datamgr thread may call this
+ * \param sensor_id the sensor id
+ * \param value the measured value
+ * \param ts the timestamp of the value
+ */
+void history_append(sensor_id_t sensor_id, sensor_value_t value, sensor_ts_t ts);
+
+/**
+ * Copies the readings of 'sensor_id' with from <= ts <= to into 'out', in arrival order
+ * Readings that are older than the ring are not returned, '*oldest' tells the caller which part has to come from the database
+ * \param sensor_id the sensor id to look for
+ * \param from the start of the window
+ * \param to the end of the window
+ * \param out pre-allocated space for at least 'max' entries
+ * \param max the size of 'out'
+ * \param oldest set to the timestamp of the oldest reading still in the ring, 0 if the sensor has no readings in memory
+ * \return the number of copied readings and HISTORY_FAILURE if the history is not mapped
+ */
+int history_query(sensor_id_t sensor_id, sensor_ts_t from, sensor_ts_t to, history_entry_t* out, int max, sensor_ts_t* oldest);
+
+/**
+ * Leaves the segment to a new gateway: nothing is appended any more and history_free only unmaps it
+ */
+void history_disown();
+
+/**
+ * Unmaps the history, the creator also removes the shared memory segment
+ */
+void history_free();
+
+#endif  //_SENSOR_HISTORY_H_
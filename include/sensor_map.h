@@ -0,0 +1,98 @@
+#ifndef _SENSOR_MAP_H_
+#define _SENSOR_MAP_H_
+
+#include <stdio.h>
+#include "config.h"
+
+#define SENSOR_MAP_FILE "room_sensor.map"
+#define TYPE_MAP_FILE "type.map"
+
+// how long the map files must be quiet before a change is applied (ms)
+#ifndef SENSOR_MAP_WATCH_INTERVAL
+#define SENSOR_MAP_WATCH_INTERVAL 200
+#endif
+
+#define SENSOR_MAP_FAILURE -1
+#define SENSOR_MAP_SUCCESS 0
+
+// sensor types of type.map, SENSOR_TYPE_NR is part of the shared memory layout of the latest table
+#define SENSOR_TYPE_NR 3
+typedef enum {
+    SENSOR_TEMPERATURE = 0,
+    SENSOR_HUMIDITY = 1,
+    SENSOR_LIGHT = 2,
+    SENSOR_UNKNOWN = SENSOR_TYPE_NR
+} sensor_type_t;
+
+/**
+ * Reads the sensor to room mapping and the sensor types
+ * Every line of the map file holds '<room_id> <sensor_id>', every line of the type file '<sensor_id> <type>'
+ * The mapping is shared by all threads, lookups never block and may run concurrently with a reload
+ * \param fp_sensor_map file pointer to the map file
+ * \param fp_type_map file pointer to the type file, NULL if the sensor types are not known
+ * \return SENSOR_MAP_SUCCESS on success and SENSOR_MAP_FAILURE if an error occurred
+ */
+int sensor_map_init(FILE* fp_sensor_map, FILE* fp_type_map);
+
+/**
+ * Parses both files into a new mapping and swaps it in atomically, readers keep using the old one until they are done
+ * The old mapping is freed after every lookup that could still see it has finished
+ * \param sensor_map_file path of the map file
+ * \param type_map_file path of the type file, the sensor types are unknown if it can not be read
+ * \return SENSOR_MAP_SUCCESS on success and SENSOR_MAP_FAILURE if the map file could not be read (the old mapping stays)
+ */
+int sensor_map_reload(const char* sensor_map_file, const char* type_map_file);
+
+/**
+ * Asks sensor_map_watch to reload the mapping, only sets a flag so it is safe to call from a signal handler
+ */
+void sensor_map_request_reload();
+
+/**
+ * Reloads SENSOR_MAP_FILE and TYPE_MAP_FILE in the working directory whenever they change (inotify)
+ * or when a reload was requested, until '*running' becomes false
+ * \param running flag that keeps the watcher alive
+ */
+void sensor_map_watch(bool* running);
+
+/**
+ * Returns the generation of the current mapping, it increases with every (re)load
+ * Threads that derive state from the mapping rebuild it when the generation changed
+ * \return the generation of the current mapping
+ */
+uint32_t sensor_map_generation();
+
+/**
+ * Gets the room ID for a certain sensor ID in O(1)
+ * \param sensor_id the sensor id to look for
+ * \return the corresponding room id, 0 if the sensor is not in the map
+ */
+room_id_t sensor_map_get_room(sensor_id_t sensor_id);
+
+/**
+ * Gets the type of a certain sensor ID in O(1)
+ * \param sensor_id the sensor id to look for
+ * \return the corresponding type, SENSOR_UNKNOWN if the sensor is not in the type file
+ */
+sensor_type_t sensor_map_get_type(sensor_id_t sensor_id);
+
+/**
+ * Returns the name of a sensor type as used in type.map
+ * \param type the sensor type
+ * \return the name of the type
+ */
+const char* sensor_type_name(sensor_type_t type);
+
+/**
+ * Returns the sensor type of a name as used in type.map
+ * \param name the name of the type
+ * \return the type, SENSOR_UNKNOWN if the name is not a known type
+ */
+sensor_type_t sensor_type_from_name(const char* name);
+
+/**
+ * Frees the mapping
+ */
+void sensor_map_free();
+
+#endif  //_SENSOR_MAP_H_
@@ -0,0 +1,97 @@
+#ifndef _SENSOR_TABLE_H_
+#define _SENSOR_TABLE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "config.h"
+
+#define SENSOR_TABLE_FAILURE -1
+#define SENSOR_TABLE_SUCCESS 0
+
+// initial number of slots, the table doubles when it is full
+#ifndef SENSOR_TABLE_CAPACITY
+#define SENSOR_TABLE_CAPACITY 64
+#endif
+
+/*
+ * State of every sensor of the datamgr as a structure of arrays: slot i of every array belongs to the same sensor.
+ * Slots are dense (0 .. count - 1) and never move, so a sweep over one field reads a single contiguous array.
+ * The hot fields each have their own array, the averaging windows (cold) are one block of RUN_AVG_LENGTH values per slot.
+ */
+typedef struct {
+    int count;                          /** < used slots */
+    int capacity;                       /** < allocated slots */
+    sensor_id_t* ids;
+    room_id_t* rooms;
+    sensor_value_t* running_avg;
+    sensor_ts_t* last_modified;
+    uint16_t* buffer_position;
+    bool* take_avg;
+    bool* stale;                        /** < the sensor was reported as silent by the last sweep */
+    uint8_t* alert_state;               /** < alert_state_t of the sensor */
+    sensor_ts_t* alert_last;            /** < when the last alert of the sensor was logged */
+    sensor_value_t* windows;            /** < window of slot i starts at windows[i * RUN_AVG_LENGTH] */
+    uint32_t* slot_of;                  /** < slot + 1 of every sensor id, 0 if the sensor has no slot */
+} sensor_table_t;
+
+/**
+ * Allocates and initializes the sensor table
+ * \param table a double pointer to the table that needs to be initialized
+ * \return SENSOR_TABLE_SUCCESS on success and SENSOR_TABLE_FAILURE if an error occurred
+ */
+int sensor_table_init(sensor_table_t** table);
+
+/**
+ * Finds the slot of a sensor in O(1)
+ * \param table the sensor table
+ * \param sensor_id the sensor id to look for
+ * \return the slot of the sensor, -1 if the sensor has no slot
+ */
+static inline int sensor_table_find(sensor_table_t* table, sensor_id_t sensor_id){
+    return (int) table->slot_of[sensor_id] - 1;
+}
+
+/**
+ * Adds a sensor with an empty window, the arrays grow when the table is full
+ * \param table the sensor table
+ * \param sensor_id the id of the new sensor, it must not have a slot yet
+ * \param room_id the room of the new sensor
+ * \return the slot of the sensor, -1 if the table could not grow
+ */
+int sensor_table_add(sensor_table_t* table, sensor_id_t sensor_id, room_id_t room_id);
+
+/**
+ * Adds a value to the window of a slot, the running average itself is computed by the caller (see window_kernel.h)
+ * \param table the sensor table
+ * \param slot the slot of the sensor
+ * \param value the new value
+ * \param ts the timestamp of the value
+ * \return true if the window is full and the running average has to be updated
+ */
+bool sensor_table_store(sensor_table_t* table, int slot, sensor_value_t value, sensor_ts_t ts);
+
+/**
+ * Writes the sensors of the table to a snapshot file, the arrays are written as they are in memory
+ * The snapshot is written next to 'path' and renamed over it, a crash never leaves a half written snapshot behind
+ * \param table the sensor table
+ * \param path the snapshot file
+ * \return SENSOR_TABLE_SUCCESS on success and SENSOR_TABLE_FAILURE if the snapshot could not be written
+ */
+int sensor_table_save(sensor_table_t* table, const char* path);
+
+/**
+ * Fills an empty table from a snapshot file written by sensor_table_save, the file is mapped and copied array by array
+ * A snapshot of a build with another RUN_AVG_LENGTH or other types is rejected
+ * \param table the sensor table, it must be empty
+ * \param path the snapshot file
+ * \return SENSOR_TABLE_SUCCESS on success and SENSOR_TABLE_FAILURE if the snapshot is missing or invalid (the table stays empty)
+ */
+int sensor_table_load(sensor_table_t* table, const char* path);
+
+/**
+ * Frees all the memory of the sensor table
+ * \param table a double pointer to the table that needs to be freed
+ */
+void sensor_table_free(sensor_table_t** table);
+
+#endif  //_SENSOR_TABLE_H_
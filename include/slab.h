@@ -0,0 +1,88 @@
+#ifndef _SLAB_H_
+#define _SLAB_H_
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#define SLAB_FAILURE -1
+#define SLAB_SUCCESS 0
+
+// memory is taken from the system in blocks of this many bytes, a block is cut into objects of one size
+#ifndef SLAB_BLOCK_SIZE
+#define SLAB_BLOCK_SIZE (64 * 1024)
+#endif
+
+// every thread keeps at most this many free objects per cache, half of them go back to the shared depot when it is full
+#ifndef SLAB_MAGAZINE
+#define SLAB_MAGAZINE 128
+#endif
+
+// the number of caches that can be created during the lifetime of the program
+#define SLAB_CACHES_MAX 16
+
+/*
+ * Fixed-size object allocator for the hot path of the gateway.
+ * slab_alloc and slab_free work on a cache of the calling thread and take no lock.
+ * Only a thread whose cache is empty (or full) locks the shared depot of the slab, which is how objects freed
+ * by one thread (e.g. the datamgr freeing buffer nodes) flow back to the thread that allocates them (the connmgr).
+ */
+typedef struct slab_cache slab_cache_t;
+
+typedef struct {
+    const char* name;
+    size_t object_size;
+    uint64_t allocs;            /** < number of slab_alloc calls that returned an object */
+    uint64_t frees;             /** < number of slab_free calls */
+    uint64_t blocks;            /** < blocks taken from the system */
+    uint64_t depot_trips;       /** < times a thread cache had to lock the depot */
+} slab_stats_t;
+
+/**
+ * Creates a cache for objects of one size
+ * \param name the name used in the statistics, it is not copied
+ * \param object_size the size of one object
+ * \return the cache, NULL if it could not be created
+ */
+slab_cache_t* slab_cache_create(const char* name, size_t object_size);
+
+/**
+ * Returns an object of the cache, the content is undefined
+ * \param cache the cache
+ * \return the object, NULL if the system is out of memory
+ */
+void* slab_alloc(slab_cache_t* cache);
+
+/**
+ * Returns an object to the cache, any thread may free an object of any other thread
+ * \param cache the cache the object was allocated from
+ * \param object the object, NULL is ignored
+ */
+void slab_free(slab_cache_t* cache, void* object);
+
+/**
+ * Moves the free objects cached by the calling thread back to the depots, call it before a thread exits
+ */
+void slab_thread_flush();
+
+/**
+ * Reads the statistics of a cache
+ * \param index 0 .. the number of caches - 1
+ * \param stats filled out with the statistics
+ * \return SLAB_SUCCESS, SLAB_FAILURE if there is no cache with this index
+ */
+int slab_get_stats(int index, slab_stats_t* stats);
+
+/**
+ * Writes the statistics of every cache
+ * \param fp the file to write to
+ */
+void slab_dump_stats(FILE* fp);
+
+/**
+ * Frees the cache and all its blocks, no thread may use its objects afterwards
+ * \param cache a double pointer to the cache that needs to be freed
+ */
+void slab_cache_destroy(slab_cache_t** cache);
+
+#endif  //_SLAB_H_
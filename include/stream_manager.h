@@ -0,0 +1,44 @@
+#ifndef _STREAMMGR_H_
+#define _STREAMMGR_H_
+
+#include "config.h"
+#include "sensor_buffer.h"
+
+// default port of the local HTTP listener serving the live readings
+#ifndef STREAM_PORT
+#define STREAM_PORT 8081
+#endif
+
+// readings queued per subscriber, readings for a full queue are dropped
+#ifndef STREAM_QUEUE_LENGTH
+#define STREAM_QUEUE_LENGTH 256
+#endif
+
+#ifndef STREAM_MAX_SUBSCRIBERS
+#define STREAM_MAX_SUBSCRIBERS 1024
+#endif
+
+// sensors and rooms a single subscriber can filter on
+#define STREAM_MAX_FILTERS 32
+
+/**
+ * Initialise the streammgr
+ * \param config_thread takes a thread
+ */
+void streammgr_init(config_thread_t* config_thread);
+
+/**
+ * This method holds the core functionality of the streammgr.
+ * It consumes every reading in the shared buffer and pushes it to the subscribers as Server-Sent Events.
+ * Subscribers connect with 'GET /stream?sensor=<id>,<id>&room=<id>' on 'port_number', without filters all readings are sent.
+ * \param port_number port number of the HTTP listener
+ * \param buffer the shared buffer to read from
+ */
+void streammgr_listen(int port_number, sbuffer_t** buffer);
+
+/**
+ * This method should be called to clean up the streammgr, all subscribers are disconnected
+ */
+void streammgr_free();
+
+#endif  //_STREAMMGR_H_
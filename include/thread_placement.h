@@ -0,0 +1,34 @@
+#ifndef _THREAD_PLACEMENT_H_
+#define _THREAD_PLACEMENT_H_
+
+#include <stdio.h>
+
+#define PLACEMENT_FAILURE -1
+#define PLACEMENT_SUCCESS 0
+
+// optional file with the placement of the gateway threads, see placement_load
+#define PLACEMENT_MAP_FILE "placement.map"
+
+// the number of threads that can be placed
+#define PLACEMENT_MAX_ROLES 8
+
+/**
+ * Reads the thread placement, every line holds '<thread> <cpus> [fifo <priority>] [node <numa node>]'
+ * 'thread' is the role passed to placement_apply (connmgr, db, datamgr, streammgr, mapwatch),
+ * 'cpus' a list like 2 or 2,3 or 4-7, or * to leave the affinity alone
+ * 'fifo' runs the thread with SCHED_FIFO at 'priority', 'node' prefers that NUMA node for the memory the thread allocates
+ * Invalid lines are logged and skipped. Call it before the threads are started
+ * \param fp_placement the placement file, NULL keeps the default placement of every thread
+ * \return the number of threads with a placement
+ */
+int placement_load(FILE* fp_placement);
+
+/**
+ * Applies the placement of 'role' to the calling thread, a thread without a placement is left alone
+ * The memory policy applies to what the thread allocates from now on, so call it before the thread allocates its buffers
+ * \param role the name of the thread in the placement file
+ * \return PLACEMENT_SUCCESS, PLACEMENT_FAILURE if a part of the placement could not be applied (it is logged)
+ */
+int placement_apply(const char* role);
+
+#endif  //_THREAD_PLACEMENT_H_
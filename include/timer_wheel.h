@@ -0,0 +1,84 @@
+#ifndef _TIMER_WHEEL_H_
+#define _TIMER_WHEEL_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define TIMER_WHEEL_FAILURE -1
+#define TIMER_WHEEL_SUCCESS 0
+
+// resolution of the wheel in milliseconds, timers expire at most one tick late
+#ifndef TIMER_WHEEL_TICK
+#define TIMER_WHEEL_TICK 100
+#endif
+
+// every level has 2^TIMER_WHEEL_BITS slots, a slot of level l spans 2^(l * TIMER_WHEEL_BITS) ticks
+#define TIMER_WHEEL_BITS 6
+#define TIMER_WHEEL_SLOTS (1 << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_LEVELS 4
+
+/*
+ * A timer is embedded in the structure it belongs to, the wheel never allocates.
+ * The expiry callback gets the timer back and finds its owner with offsetof.
+ */
+typedef struct timer_entry {
+    struct timer_entry* next;
+    struct timer_entry* prev;
+    uint64_t expires;                   /** < tick at which the timer fires */
+    bool pending;                       /** < the timer is in the wheel */
+} timer_entry_t;
+
+typedef void (*timer_expire_fn)(timer_entry_t* timer, void* arg);
+
+typedef struct {
+    uint64_t now;                       /** < the last tick that was processed */
+    timer_entry_t slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];  /** < sentinels of circular lists */
+} timer_wheel_t;
+
+/**
+ * Returns the local monotonic time, it does not jump when the wall clock is set
+ * \return milliseconds since an arbitrary point in the past
+ */
+uint64_t timer_wheel_clock();
+
+/**
+ * Allocates and initializes an empty wheel
+ * \param wheel a double pointer to the wheel that needs to be initialized
+ * \param now_ms the current time (see timer_wheel_clock)
+ * \return TIMER_WHEEL_SUCCESS on success and TIMER_WHEEL_FAILURE if an error occurred
+ */
+int timer_wheel_init(timer_wheel_t** wheel, uint64_t now_ms);
+
+/**
+ * (Re)schedules a timer in O(1), a pending timer is moved
+ * Timers further away than the range of the wheel (about 19 days) fire at the end of the range
+ * \param wheel the wheel
+ * \param timer the timer
+ * \param expires_ms when the timer has to fire, a time in the past fires on the next tick
+ */
+void timer_wheel_schedule(timer_wheel_t* wheel, timer_entry_t* timer, uint64_t expires_ms);
+
+/**
+ * Removes a timer from the wheel in O(1), nothing happens if it is not pending
+ * \param timer the timer
+ */
+void timer_wheel_cancel(timer_entry_t* timer);
+
+/**
+ * Processes every tick up to now_ms and calls 'expire' for every timer that fires
+ * The callback may reschedule or cancel any timer and may free the owner of the fired timer
+ * \param wheel the wheel
+ * \param now_ms the current time
+ * \param expire the callback
+ * \param arg passed to the callback
+ * \return the number of timers that fired
+ */
+int timer_wheel_advance(timer_wheel_t* wheel, uint64_t now_ms, timer_expire_fn expire, void* arg);
+
+/**
+ * Frees the wheel, the pending timers are only detached
+ * \param wheel a double pointer to the wheel that needs to be freed
+ */
+void timer_wheel_free(timer_wheel_t** wheel);
+
+#endif  //_TIMER_WHEEL_H_
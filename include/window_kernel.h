@@ -0,0 +1,41 @@
+#ifndef _WINDOW_KERNEL_H_
+#define _WINDOW_KERNEL_H_
+
+#include <stdint.h>
+#include "config.h"
+
+// the number of windows evaluated in one call, one bit per window in the threshold masks
+#define WINDOW_KERNEL_BATCH 64
+
+/*
+ * The windows of a batch are passed transposed: windows[k][i] is value k of the window of sensor i,
+ * so every step of the kernel adds one contiguous row of the batch.
+ * The averages are bit-for-bit the same for every implementation (same summation order, true division).
+ */
+typedef sensor_value_t window_batch_t[RUN_AVG_LENGTH][WINDOW_KERNEL_BATCH];
+
+/**
+ * Selects the fastest implementation the CPU supports (AVX2, SSE2 or scalar)
+ */
+void window_kernel_init();
+
+/**
+ * Returns the name of the selected implementation
+ * \return "avx2", "sse2" or "scalar"
+ */
+const char* window_kernel_name();
+
+/**
+ * Computes the average of every window in the batch and compares it with the thresholds
+ * \param windows the transposed windows of the batch
+ * \param count the number of windows in the batch, at most WINDOW_KERNEL_BATCH
+ * \param min the lower threshold of every window
+ * \param max the upper threshold of every window
+ * \param avg pre-allocated space for the 'count' averages
+ * \param hot bit i is set if the average of window i is above max[i]
+ * \param cold bit i is set if the average of window i is below min[i]
+ */
+void window_kernel_eval(window_batch_t windows, int count, const sensor_value_t* min, const sensor_value_t* max,
+                        sensor_value_t* avg, uint64_t* hot, uint64_t* cold);
+
+#endif  //_WINDOW_KERNEL_H_
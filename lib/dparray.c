@@ -0,0 +1,205 @@
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include "dparray.h"
+
+
+/*
+ * definition of error codes
+ */
+#define DPARRAY_NO_ERROR 0
+#define DPARRAY_MEMORY_ERROR 1 // error due to mem alloc failure
+#define DPARRAY_INVALID_ERROR 2 //error due to a list operation applied on a NULL list
+
+// first allocation of the element array
+#define DPARRAY_INITIAL_CAPACITY 16
+
+#ifdef DEBUG
+#define DEBUG_PRINTF(...) 									                                        \
+        do {											                                            \
+            fprintf(stderr,"\nIn %s - function %s at line %d: ", __FILE__, __func__, __LINE__);	    \
+            fprintf(stderr,__VA_ARGS__);								                            \
+            fflush(stderr);                                                                         \
+                } while(0)
+#else
+#define DEBUG_PRINTF(...) (void)0
+#endif
+
+
+#define DPARRAY_ERR_HANDLER(condition, err_code)                        \
+    do {                                                                \
+            if ((condition)) DEBUG_PRINTF(#condition " failed\n");      \
+            assert(!(condition));                                       \
+        } while(0)
+
+
+/*
+ * The real definition of struct dparray
+ * Element i is stored at data + i * stride: an element pointer (pointer storage) or the element itself (inline storage)
+ */
+struct dparray {
+    char *data;
+    int size;
+    int capacity;
+    size_t stride;
+    bool inline_storage;
+    void *(*element_copy)(void *src_element);
+    void (*element_free)(void **element);
+    void (*element_release)(void *element);
+    int (*element_compare)(void *x, void *y);
+};
+
+// helper methods
+static void *dpa_slot(dparray_t *list, int index);
+static void *dpa_element_of_slot(dparray_t *list, void *slot);
+static void dpa_free_slot(dparray_t *list, void *slot);
+
+
+dparray_t *dpa_create(// callback functions
+        void *(*element_copy)(void *src_element),
+        void (*element_free)(void **element),
+        int (*element_compare)(void *x, void *y)
+) {
+    dparray_t *list = calloc(1, sizeof(struct dparray));
+    DPARRAY_ERR_HANDLER(list == NULL, DPARRAY_MEMORY_ERROR);
+    list->stride = sizeof(void *);
+    list->inline_storage = false;
+    list->element_copy = element_copy;
+    list->element_free = element_free;
+    list->element_compare = element_compare;
+    return list;
+}
+
+dparray_t *dpa_create_inline(
+        size_t element_size,
+        void (*element_release)(void *element),
+        int (*element_compare)(void *x, void *y)
+) {
+    assert(element_size > 0);
+    dparray_t *list = calloc(1, sizeof(struct dparray));
+    DPARRAY_ERR_HANDLER(list == NULL, DPARRAY_MEMORY_ERROR);
+    list->stride = element_size;
+    list->inline_storage = true;
+    list->element_release = element_release;
+    list->element_compare = element_compare;
+    return list;
+}
+
+void dpa_free(dparray_t **list, bool free_element) {
+    if(*list == NULL) return;
+
+    if(free_element)
+        for(int i = 0; i < (*list)->size; i++) dpa_free_slot(*list, dpa_slot(*list, i));
+
+    //The list itself also needs to be deleted. (free all memory)
+    free((*list)->data);
+    free(*list);
+    *list = NULL;
+}
+
+int dpa_size(dparray_t *list) {
+    if(list == NULL) return -1;
+    return list->size;
+}
+
+dparray_t *dpa_reserve(dparray_t *list, int capacity) {
+    if(list == NULL) return NULL;
+    if(capacity <= list->capacity) return list;
+
+    char *data = realloc(list->data, (size_t) capacity * list->stride);
+    DPARRAY_ERR_HANDLER(data == NULL, DPARRAY_MEMORY_ERROR);
+    list->data = data;
+    list->capacity = capacity;
+    return list;
+}
+
+dparray_t *dpa_insert_at_index(dparray_t *list, void *element, int index, bool insert_copy) {
+    if(list == NULL) return NULL;
+
+    // the array doubles when it is full, so appending is O(1) amortized
+    if(list->size == list->capacity)
+        dpa_reserve(list, list->capacity == 0 ? DPARRAY_INITIAL_CAPACITY : list->capacity * 2);
+
+    if(index < 0) index = 0;
+    if(index > list->size) index = list->size;
+
+    // move the elements behind 'index' one place up
+    char *slot = dpa_slot(list, index);
+    memmove(slot + list->stride, slot, (size_t) (list->size - index) * list->stride);
+
+    if(list->inline_storage) memcpy(slot, element, list->stride);
+    else{
+        void *stored = insert_copy ? list->element_copy(element) : element;
+        memcpy(slot, &stored, sizeof(void *));
+    }
+    list->size++;
+    return list;
+}
+
+dparray_t *dpa_remove_at_index(dparray_t *list, int index, bool free_element) {
+    if(list == NULL) return NULL;
+
+    //If the list is empty, return the unmodified list.
+    if(list->size == 0) return list;
+
+    if(index < 0) index = 0;
+    if(index >= list->size) index = list->size - 1;
+
+    char *slot = dpa_slot(list, index);
+    if(free_element) dpa_free_slot(list, slot);
+
+    // move the elements behind 'index' one place down
+    memmove(slot, slot + list->stride, (size_t) (list->size - index - 1) * list->stride);
+    list->size--;
+    return list;
+}
+
+void *dpa_get_element_at_index(dparray_t *list, int index) {
+    //If 'list' is NULL or the list is empty, NULL is returned.
+    if(list == NULL || list->size == 0) return NULL;
+
+    if(index < 0) index = 0;
+    if(index >= list->size) index = list->size - 1;
+    return dpa_element_of_slot(list, dpa_slot(list, index));
+}
+
+int dpa_get_index_of_element(dparray_t *list, void *element) {
+    //If 'list' is NULL, -1 is returned.
+    if(list == NULL) return -1;
+
+    //find the element in the list, a linear scan over contiguous memory
+    for(int i = 0; i < list->size; i++)
+        if(list->element_compare(dpa_element_of_slot(list, dpa_slot(list, i)), element) == 0) return i;
+
+    //If 'element' is not found in the list, -1 is returned.
+    return -1;
+}
+
+dparray_t *dpa_remove_element(dparray_t *list, void *element, bool free_element) {
+    int index = dpa_get_index_of_element(list, element);
+    if(index == -1) return list;
+    return dpa_remove_at_index(list, index, free_element);
+}
+
+static void *dpa_slot(dparray_t *list, int index) {
+    return list->data + (size_t) index * list->stride;
+}
+
+static void *dpa_element_of_slot(dparray_t *list, void *slot) {
+    if(list->inline_storage) return slot;
+    void *element;
+    memcpy(&element, slot, sizeof(void *));
+    return element;
+}
+
+static void dpa_free_slot(dparray_t *list, void *slot) {
+    if(list->inline_storage){
+        if(list->element_release != NULL) list->element_release(slot);
+        return;
+    }
+    void *element = dpa_element_of_slot(list, slot);
+    if(list->element_free != NULL) list->element_free(&element);
+}
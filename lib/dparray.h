@@ -0,0 +1,130 @@
+#ifndef _DPARRAY_H_
+#define _DPARRAY_H_
+
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ * dparray_t is a list with the dplist_t interface, backed by one growable contiguous array.
+ * Index access is O(1) and appending is O(1) amortized, inserting or removing in the middle moves the elements behind it.
+ * There are no list nodes: an index takes the place of a dplist_node_t reference.
+ *
+ * Two storage modes:
+ * - pointer storage (dpa_create): the array holds element pointers, exactly like dplist_t
+ * - inline storage (dpa_create_inline): the array holds the elements themselves, inserting copies the bytes
+ *   of the element into the array and never allocates per element.
+ *   A pointer returned by dpa_get_element_at_index is only valid until the next insert or remove.
+ */
+typedef struct dparray dparray_t;
+
+/* General remark on error handling
+ * All functions below will:
+ * - use assert() to check if memory allocation was successfully.
+ */
+
+/** Create and allocate memory for a new list with pointer storage
+ * \param element_copy callback function to duplicate 'element'; If needed allocated new memory for the duplicated element.
+ * \param element_free callback function to free memory allocated to element
+ * \param element_compare callback function to compare two element elements; returns -1 if x<y, 0 if x==y, or 1 if x>y
+ * \return a pointer to a newly-allocated and initialized list.
+ */
+dparray_t *dpa_create(
+        void* (*element_copy)(void *element),
+        void (*element_free)(void **element),
+        int (*element_compare)(void *x, void *y)
+);
+
+/** Create and allocate memory for a new list with inline storage
+ * \param element_size the size of one element in bytes
+ * \param element_release callback function to free the memory owned by an element (not the element itself), may be NULL
+ * \param element_compare callback function to compare two element elements; returns -1 if x<y, 0 if x==y, or 1 if x>y
+ * \return a pointer to a newly-allocated and initialized list.
+ */
+dparray_t *dpa_create_inline(
+        size_t element_size,
+        void (*element_release)(void *element),
+        int (*element_compare)(void *x, void *y)
+);
+
+/** Deletes all elements in the list
+ * - The list itself also needs to be deleted. (free all memory)
+ * - '*list' must be set to NULL.
+ * \param list a double pointer to the list
+ * \param free_element if true call element_free() (element_release() for inline storage) on every element
+ */
+void dpa_free(dparray_t **list, bool free_element);
+
+/** Returns the number of elements in the list in O(1).
+ * - If 'list' is is NULL, -1 is returned.
+ * \param list a pointer to the list
+ * \return the size of the list
+ */
+int dpa_size(dparray_t *list);
+
+/** Makes room for at least 'capacity' elements, so that many inserts do not reallocate
+ * - If 'list' is is NULL, NULL is returned.
+ * \param list a pointer to the list
+ * \param capacity the number of elements
+ * \return a pointer to the list or NULL
+ */
+dparray_t *dpa_reserve(dparray_t *list, int capacity);
+
+/** Inserts 'element' in the list at position 'index'
+ * - the first element has index 0.
+ * - If 'index' is 0 or negative, the element is inserted at the start of 'list'.
+ * - If 'index' is bigger than the number of elements in the list, the element is inserted at the end of the list.
+ * - If 'list' is is NULL, NULL is returned.
+ * \param list a pointer to the list
+ * \param element a pointer to the data that needs to be inserted
+ * \param index the position at which the element should be inserted in the list
+ * \param insert_copy pointer storage: if true use element_copy() to make a copy of 'element', otherwise the given element pointer is added to the list
+ *                    inline storage: ignored, the bytes of 'element' are always copied
+ * \return a pointer to the list or NULL
+ */
+dparray_t *dpa_insert_at_index(dparray_t *list, void *element, int index, bool insert_copy);
+
+/** Removes the element at index 'index' from the list.
+ * - If 'index' is 0 or negative, the first element is removed.
+ * - If 'index' is bigger than the number of elements in the list, the last element is removed.
+ * - If the list is empty, return the unmodified list.
+ * - If 'list' is is NULL, NULL is returned.
+ * \param list a pointer to the list
+ * \param index the position of the element to remove
+ * \param free_element if true, call element_free() (element_release() for inline storage) on the removed element
+ * \return a pointer to the list or NULL
+ */
+dparray_t *dpa_remove_at_index(dparray_t *list, int index, bool free_element);
+
+/** Returns the element with index 'index' in the list in O(1).
+ * - return is not returning a copy of the element with index 'index', i.e. 'element_copy()' is not used.
+ * - If 'index' is 0 or negative, the first element is returned.
+ * - If 'index' is bigger than the number of elements in the list, the last element is returned.
+ * - If the list is empty, NULL is returned.
+ * - If 'list' is NULL, NULL is returned.
+ * \param list a pointer to the list
+ * \param index the position of the element
+ * \return a pointer to the element at the given index or NULL
+ */
+void *dpa_get_element_at_index(dparray_t *list, int index);
+
+/** Returns the index of the first element in the list that matches 'element'.
+ * - Use 'element_compare()' to search 'element' in the list, a match is found when 'element_compare()' returns 0.
+ * - If 'element' is not found in the list, -1 is returned.
+ * - If 'list' is NULL, -1 is returned.
+ * \param list a pointer to the list
+ * \param element the element to look for
+ * \return the index of the element that matches 'element'
+ */
+int dpa_get_index_of_element(dparray_t *list, void *element);
+
+/** Finds the first element in the list that matches 'element' and removes it from 'list'.
+ * - If 'element' is not found in 'list', the unmodified 'list' is returned.
+ * - If 'list' is is NULL, NULL is returned.
+ * \param list a pointer to the list
+ * \param element a pointer to an element
+ * \param free_element if true call element_free() (element_release() for inline storage) on the removed element
+ * \return a pointer to the list or NULL
+ */
+dparray_t *dpa_remove_element(dparray_t *list, void *element, bool free_element);
+
+#endif  // _DPARRAY_H_
@@ -0,0 +1,293 @@
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include "local_ring.h"
+
+// the shared memory: the producer only writes 'head' and the slots, the gateway only writes 'tail'
+typedef struct {
+    uint32_t magic;
+    uint32_t capacity;
+    _Alignas(64) atomic_uint_fast64_t head;     /** < readings stored since the ring was created */
+    _Alignas(64) atomic_uint_fast64_t tail;     /** < readings taken since the ring was created */
+    atomic_uint waiting;                        /** < 1 if the gateway sleeps, the producer rings and clears it */
+    _Alignas(64) sensor_data_t slots[];
+} local_ring_shared_t;
+
+// the registration, the memfd of the ring comes with it
+typedef struct {
+    uint32_t magic;
+    uint32_t capacity;
+} local_ring_hello_t;
+
+struct local_ring {
+    int fd;                     /** < the connection, -1 if the ring is not registered */
+    int memfd;
+    local_ring_shared_t* shared;    /** < MAP_FAILED while the gateway waits for the registration */
+    size_t size;
+    uint32_t mask;
+};
+
+// helper methods
+static local_ring_t* local_ring_new(int fd);
+static int local_ring_map(local_ring_t* ring, int memfd, uint32_t capacity);
+static int local_ring_address(const char* path, struct sockaddr_un* addr);
+static void local_ring_set_timeout(int fd, int timeout_ms);
+
+int local_ring_create(local_ring_t** ring, uint32_t capacity){
+    *ring = NULL;
+    if(capacity == 0 || (capacity & (capacity - 1)) != 0) return LOCAL_RING_FAILURE;
+    int memfd = memfd_create("sensor_ring", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if(memfd == -1) return LOCAL_RING_FAILURE;
+    // the gateway only maps a ring that can not shrink under it
+    if(ftruncate(memfd, sizeof(local_ring_shared_t) + (size_t) capacity * sizeof(sensor_data_t)) != 0
+       || fcntl(memfd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_SEAL) != 0){
+        close(memfd);
+        return LOCAL_RING_FAILURE;
+    }
+    *ring = local_ring_new(-1);
+    if(*ring == NULL){
+        close(memfd);
+        return LOCAL_RING_FAILURE;
+    }
+    // the ring owns the memfd from here on
+    if(local_ring_map(*ring, memfd, capacity) != LOCAL_RING_SUCCESS){
+        local_ring_close(ring);
+        return LOCAL_RING_FAILURE;
+    }
+    // the pages are zero: both positions start at 0
+    (*ring)->shared->magic = LOCAL_RING_MAGIC;
+    (*ring)->shared->capacity = capacity;
+    return LOCAL_RING_SUCCESS;
+}
+
+int local_ring_register(local_ring_t* ring, const char* path){
+    if(ring->fd != -1) close(ring->fd);
+    ring->fd = -1;
+
+    struct sockaddr_un addr;
+    if(local_ring_address(path, &addr) != LOCAL_RING_SUCCESS) return LOCAL_RING_FAILURE;
+    int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if(fd == -1) return LOCAL_RING_FAILURE;
+    local_ring_set_timeout(fd, LOCAL_RING_REGISTER_MS);
+
+    local_ring_hello_t hello = {.magic = LOCAL_RING_MAGIC, .capacity = ring->shared->capacity};
+    struct iovec iov = {.iov_base = &hello, .iov_len = sizeof(hello)};
+    union {
+        struct cmsghdr header;
+        char buffer[CMSG_SPACE(sizeof(int))];
+    } control;
+    memset(&control, 0, sizeof(control));
+    struct msghdr msg = {.msg_iov = &iov, .msg_iovlen = 1, .msg_control = control.buffer, .msg_controllen = sizeof(control.buffer)};
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &(ring->memfd), sizeof(int));
+
+    // the gateway answers with one byte once it mapped the ring
+    uint8_t ack;
+    if(connect(fd, (struct sockaddr*) &addr, sizeof(addr)) != 0 || sendmsg(fd, &msg, MSG_NOSIGNAL) != (ssize_t) sizeof(hello)
+       || recv(fd, &ack, sizeof(ack), 0) != (ssize_t) sizeof(ack)){
+        close(fd);
+        return LOCAL_RING_FAILURE;
+    }
+    ring->fd = fd;
+    return LOCAL_RING_SUCCESS;
+}
+
+int local_ring_check(local_ring_t* ring){
+    if(ring->fd == -1) return LOCAL_RING_FAILURE;
+    // the gateway never writes after the acknowledgement, a readable end is the end of the connection
+    uint8_t byte;
+    if(recv(ring->fd, &byte, sizeof(byte), MSG_PEEK | MSG_DONTWAIT) == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        return LOCAL_RING_SUCCESS;
+    return LOCAL_RING_FAILURE;
+}
+
+int local_ring_push(local_ring_t* ring, const sensor_data_t* data){
+    local_ring_shared_t* shared = ring->shared;
+    uint64_t head = atomic_load_explicit(&(shared->head), memory_order_relaxed);
+    if(head - atomic_load_explicit(&(shared->tail), memory_order_acquire) >= shared->capacity) return LOCAL_RING_FULL;
+    shared->slots[head & ring->mask] = *data;
+    atomic_store(&(shared->head), head + 1);
+
+    // the store of 'head' comes before this load and the store of 'waiting' before the gateway's load of 'head':
+    // either the gateway sees the reading before it sleeps or the producer sees that it sleeps
+    if(atomic_load(&(shared->waiting)) && atomic_exchange(&(shared->waiting), 0) && ring->fd != -1){
+        // a full socket already holds a doorbell, a gateway that left is noticed by local_ring_check
+        uint8_t doorbell = 1;
+        send(ring->fd, &doorbell, sizeof(doorbell), MSG_DONTWAIT | MSG_NOSIGNAL);
+    }
+    return LOCAL_RING_SUCCESS;
+}
+
+int local_ring_listen(const char* path){
+    struct sockaddr_un addr;
+    if(local_ring_address(path, &addr) != LOCAL_RING_SUCCESS) return -1;
+    int listener = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if(listener == -1) return -1;
+
+    // a new gateway binds the path while the old one still runs, the producers register with the new one from then on
+    unlink(path);
+    if(bind(listener, (struct sockaddr*) &addr, sizeof(addr)) != 0 || listen(listener, SOMAXCONN) != 0){
+        close(listener);
+        return -1;
+    }
+    return listener;
+}
+
+int local_ring_accept(int listener, local_ring_t** ring){
+    *ring = NULL;
+    int fd = accept4(listener, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if(fd == -1) return LOCAL_RING_NONE;
+    // the registration is read by local_ring_hello once it arrived
+    *ring = local_ring_new(fd);
+    if(*ring == NULL){
+        close(fd);
+        return LOCAL_RING_FAILURE;
+    }
+    return LOCAL_RING_SUCCESS;
+}
+
+int local_ring_hello(local_ring_t* ring){
+    local_ring_hello_t hello;
+    struct iovec iov = {.iov_base = &hello, .iov_len = sizeof(hello)};
+    union {
+        struct cmsghdr header;
+        char buffer[CMSG_SPACE(sizeof(int))];
+    } control;
+    struct msghdr msg = {.msg_iov = &iov, .msg_iovlen = 1, .msg_control = control.buffer, .msg_controllen = sizeof(control.buffer)};
+    ssize_t received = recvmsg(ring->fd, &msg, MSG_DONTWAIT | MSG_CMSG_CLOEXEC);
+    if(received == -1 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) return LOCAL_RING_NONE;
+
+    int memfd = -1;
+    for(struct cmsghdr* cmsg = (received > 0) ? CMSG_FIRSTHDR(&msg) : NULL; cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg))
+        if(cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) memcpy(&memfd, CMSG_DATA(cmsg), sizeof(int));
+
+    // the ring must have the size the producer claims, and a producer that shrinks it would crash the gateway
+    struct stat info;
+    int seals = (memfd != -1) ? fcntl(memfd, F_GET_SEALS) : -1;
+    bool valid = received == (ssize_t) sizeof(hello) && !(msg.msg_flags & (MSG_TRUNC | MSG_CTRUNC)) && memfd != -1
+                 && hello.magic == LOCAL_RING_MAGIC && hello.capacity > 0 && (hello.capacity & (hello.capacity - 1)) == 0
+                 && fstat(memfd, &info) == 0 && seals != -1 && (seals & F_SEAL_SHRINK)
+                 && (size_t) info.st_size == sizeof(local_ring_shared_t) + (size_t) hello.capacity * sizeof(sensor_data_t);
+    if(!valid){
+        if(memfd != -1) close(memfd);
+        return LOCAL_RING_FAILURE;
+    }
+
+    // the ring owns the memfd from here on, the capacity is checked again against the shared header
+    // nothing was sent on the connection yet, the one byte acknowledgement always fits
+    uint8_t ack = 1;
+    if(local_ring_map(ring, memfd, hello.capacity) != LOCAL_RING_SUCCESS || ring->shared->magic != LOCAL_RING_MAGIC
+       || ring->shared->capacity != hello.capacity || send(ring->fd, &ack, sizeof(ack), MSG_DONTWAIT | MSG_NOSIGNAL) != (ssize_t) sizeof(ack)){
+        // the ring stays unregistered, local_ring_close closes the memfd
+        if(ring->shared != MAP_FAILED) munmap(ring->shared, ring->size);
+        ring->shared = MAP_FAILED;
+        return LOCAL_RING_FAILURE;
+    }
+    return LOCAL_RING_SUCCESS;
+}
+
+bool local_ring_registered(const local_ring_t* ring){
+    return ring->shared != MAP_FAILED;
+}
+
+int local_ring_fd(const local_ring_t* ring){
+    return ring->fd;
+}
+
+int local_ring_doorbells(local_ring_t* ring){
+    uint8_t doorbells[64];
+    for(;;){
+        ssize_t received = recv(ring->fd, doorbells, sizeof(doorbells), MSG_DONTWAIT);
+        if(received > 0) continue;
+        if(received == -1 && errno == EINTR) continue;
+        return (received == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) ? LOCAL_RING_SUCCESS : LOCAL_RING_FAILURE;
+    }
+}
+
+int local_ring_available(local_ring_t* ring){
+    local_ring_shared_t* shared = ring->shared;
+    uint64_t available = atomic_load_explicit(&(shared->head), memory_order_acquire)
+                         - atomic_load_explicit(&(shared->tail), memory_order_relaxed);
+    // the producer is not trusted with the memory of the gateway
+    return (available <= ring->mask + 1) ? (int) available : LOCAL_RING_FAILURE;
+}
+
+const sensor_data_t* local_ring_peek(local_ring_t* ring, int index){
+    uint64_t tail = atomic_load_explicit(&(ring->shared->tail), memory_order_relaxed);
+    return &(ring->shared->slots[(tail + (uint64_t) index) & ring->mask]);
+}
+
+void local_ring_consume(local_ring_t* ring, int count){
+    uint64_t tail = atomic_load_explicit(&(ring->shared->tail), memory_order_relaxed);
+    atomic_store_explicit(&(ring->shared->tail), tail + (uint64_t) count, memory_order_release);
+}
+
+int local_ring_sleep(local_ring_t* ring){
+    local_ring_shared_t* shared = ring->shared;
+    atomic_store(&(shared->waiting), 1);
+    // the acquire load of 'head' in local_ring_available is not part of the total order of the producer's stores and loads,
+    // without the fence both sides can miss the other's store and the reading waits for the next push
+    atomic_thread_fence(memory_order_seq_cst);
+    int available = local_ring_available(ring);
+    if(available == 0) return 0;
+    // the producer cleared the flag: its doorbell is on the way
+    if(!atomic_exchange(&(shared->waiting), 0)) return 0;
+    return (available > 0) ? available : 1;
+}
+
+void local_ring_close(local_ring_t** ring){
+    if(ring == NULL || *ring == NULL) return;
+    local_ring_t* r = *ring;
+    if(r->fd != -1) close(r->fd);
+    if(r->shared != MAP_FAILED) munmap(r->shared, r->size);
+    if(r->memfd != -1) close(r->memfd);
+    free(r);
+    *ring = NULL;
+}
+
+static local_ring_t* local_ring_new(int fd){
+    local_ring_t* r = malloc(sizeof(local_ring_t));
+    if(r == NULL) return NULL;
+    r->fd = fd;
+    r->memfd = -1;
+    r->shared = MAP_FAILED;
+    r->size = 0;
+    r->mask = 0;
+    return r;
+}
+
+static int local_ring_map(local_ring_t* ring, int memfd, uint32_t capacity){
+    ring->memfd = memfd;
+    ring->size = sizeof(local_ring_shared_t) + (size_t) capacity * sizeof(sensor_data_t);
+    ring->mask = capacity - 1;
+    ring->shared = mmap(NULL, ring->size, PROT_READ | PROT_WRITE, MAP_SHARED, memfd, 0);
+    return (ring->shared == MAP_FAILED) ? LOCAL_RING_FAILURE : LOCAL_RING_SUCCESS;
+}
+
+static int local_ring_address(const char* path, struct sockaddr_un* addr){
+    memset(addr, 0, sizeof(struct sockaddr_un));
+    addr->sun_family = AF_UNIX;
+    if(strlen(path) >= sizeof(addr->sun_path)) return LOCAL_RING_FAILURE;
+    strcpy(addr->sun_path, path);
+    return LOCAL_RING_SUCCESS;
+}
+
+static void local_ring_set_timeout(int fd, int timeout_ms){
+    struct timeval timeout = {timeout_ms / 1000, (timeout_ms % 1000) * 1000};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+}
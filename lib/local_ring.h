@@ -0,0 +1,149 @@
+#ifndef _LOCAL_RING_H_
+#define _LOCAL_RING_H_
+
+#include <stdint.h>
+#include "config.h"
+
+#define LOCAL_RING_FAILURE -1
+#define LOCAL_RING_SUCCESS 0
+#define LOCAL_RING_FULL 1           // no free slot, the reading was not stored
+#define LOCAL_RING_NONE 2           // no producer is waiting to connect, or its registration did not arrive yet
+
+// the Unix socket producers register their ring on, in the working directory of the gateway
+#define LOCAL_RING_SOCKET "gateway.local"
+
+#define LOCAL_RING_MAGIC 0x53474c32u
+
+// readings in a ring of a producer (a power of 2)
+#ifndef LOCAL_RING_CAPACITY
+#define LOCAL_RING_CAPACITY 4096
+#endif
+
+// how long (ms) a producer waits for the gateway to take its ring, and the gateway for the registration of a producer
+#ifndef LOCAL_RING_REGISTER_MS
+#define LOCAL_RING_REGISTER_MS 1000
+#endif
+
+/*
+ * Ingest channel for producers on the gateway host: a single producer single consumer ring of readings in shared memory.
+ * The producer creates the ring (a memfd) and registers it over a Unix socket (SOCK_SEQPACKET, SCM_RIGHTS) that stays
+ * connected: it carries a one byte doorbell when the consumer sleeps, and its end tells either side the other is gone.
+ * The positions of both sides live in the ring, a producer whose gateway left registers the same ring with the next
+ * gateway and no reading that was stored in it is lost.
+ */
+typedef struct local_ring local_ring_t;
+
+/**
+ * Creates the ring of a producer, it is not registered yet
+ * \param ring a double pointer to the ring that needs to be created
+ * \param capacity the number of readings, a power of 2
+ * \return LOCAL_RING_SUCCESS, LOCAL_RING_FAILURE if the shared memory can not be created
+ */
+int local_ring_create(local_ring_t** ring, uint32_t capacity);
+
+/**
+ * Registers the ring of a producer with the gateway listening on 'path', a previous registration is dropped first
+ * It waits at most LOCAL_RING_REGISTER_MS for the gateway to take the ring
+ * \param ring the ring of the producer
+ * \param path the socket of the gateway
+ * \return LOCAL_RING_SUCCESS, LOCAL_RING_FAILURE if no gateway took the ring
+ */
+int local_ring_register(local_ring_t* ring, const char* path);
+
+/**
+ * Tells the producer whether its gateway is still there, without waiting
+ * \param ring the ring of the producer
+ * \return LOCAL_RING_SUCCESS, LOCAL_RING_FAILURE if the ring is not registered or the gateway left
+ */
+int local_ring_check(local_ring_t* ring);
+
+/**
+ * Stores a reading, the gateway is woken if it sleeps. A ring that is not registered keeps the readings it has room for
+ * \param ring the ring of the producer
+ * \param data the reading
+ * \return LOCAL_RING_SUCCESS, LOCAL_RING_FULL if the gateway did not take enough readings yet
+ */
+int local_ring_push(local_ring_t* ring, const sensor_data_t* data);
+
+/**
+ * Creates the Unix socket producers register on, a socket file left behind is replaced
+ * \param path the path of the socket
+ * \return the nonblocking listening descriptor, -1 if it can not be created
+ */
+int local_ring_listen(const char* path);
+
+/**
+ * Takes the connection of a producer, without waiting for a connection or for its registration
+ * The ring is not mapped yet: the gateway polls the connection and calls local_ring_hello when it is readable
+ * \param listener the descriptor of local_ring_listen
+ * \param ring a double pointer, filled out with the ring of the producer
+ * \return LOCAL_RING_SUCCESS, LOCAL_RING_NONE if no producer connected, LOCAL_RING_FAILURE if there is no memory
+ */
+int local_ring_accept(int listener, local_ring_t** ring);
+
+/**
+ * Reads the registration of a producer without waiting, maps its ring and acknowledges it
+ * \param ring a ring of local_ring_accept that is not registered yet
+ * \return LOCAL_RING_SUCCESS, LOCAL_RING_NONE if the registration did not arrive yet,
+ *         LOCAL_RING_FAILURE if the producer left or its ring was refused: then the ring can only be closed
+ */
+int local_ring_hello(local_ring_t* ring);
+
+/**
+ * Tells the gateway whether the registration of a ring was taken
+ * \param ring a ring of local_ring_accept
+ * \return true once local_ring_hello succeeded, only then the readings of the ring can be taken
+ */
+bool local_ring_registered(const local_ring_t* ring);
+
+/**
+ * Returns the connection of a ring, the gateway polls it for the registration, the doorbell and the end of the producer
+ * \param ring the ring
+ * \return the descriptor of the connection, -1 if the ring of a producer is not registered
+ */
+int local_ring_fd(const local_ring_t* ring);
+
+/**
+ * Empties the doorbell of the gateway's end of the connection, without waiting
+ * \param ring the ring of the gateway
+ * \return LOCAL_RING_SUCCESS, LOCAL_RING_FAILURE if the producer closed the connection
+ */
+int local_ring_doorbells(local_ring_t* ring);
+
+/**
+ * Returns the number of readings that are stored and not taken yet, on either side
+ * \param ring the ring
+ * \return the number of readings, LOCAL_RING_FAILURE if the producer wrote a position that is not valid
+ */
+int local_ring_available(local_ring_t* ring);
+
+/**
+ * Returns a reading the gateway did not take yet, it stays valid until local_ring_consume
+ * \param ring the ring of the gateway
+ * \param index 0 for the oldest reading, less than local_ring_available
+ * \return the reading
+ */
+const sensor_data_t* local_ring_peek(local_ring_t* ring, int index);
+
+/**
+ * Gives the slots of the oldest 'count' readings back to the producer
+ * \param ring the ring of the gateway
+ * \param count the number of readings that were taken
+ */
+void local_ring_consume(local_ring_t* ring, int count);
+
+/**
+ * Asks for the doorbell: the next reading the producer stores wakes the gateway
+ * A reading that arrived while asking does not ring, the gateway has to take it without a wakeup
+ * \param ring the ring of the gateway
+ * \return the number of readings that do not ring, 0 if the gateway can wait for the doorbell
+ */
+int local_ring_sleep(local_ring_t* ring);
+
+/**
+ * Closes the connection and unmaps the ring, on either side. The producer's readings stay in its ring until it is closed there
+ * \param ring a double pointer to the ring that needs to be closed
+ */
+void local_ring_close(local_ring_t** ring);
+
+#endif  //_LOCAL_RING_H_
@@ -8,6 +8,8 @@
 #include <string.h>
 #include <unistd.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <sys/uio.h>
 
 #include "tcpsock.h"
 
@@ -53,10 +55,24 @@ struct tcpsock {
     int sd;             /**< socket descriptor */
     char *ip_addr;      /**< socket IP address */
     int port;           /**< socket port number */
+    char ip_buffer[CHAR_IP_ADDR_LENGTH];    /**< storage of ip_addr, so a socket is a single allocation */
 };
 
 static tcpsock_t *tcp_sock_create();
 
+// allocator of the tcpsock_t structures, see tcp_set_allocator
+static void *(*sock_alloc)(size_t size) = malloc;
+static void (*sock_release)(void *ptr) = free;
+
+void tcp_set_allocator(void *(*alloc)(size_t size), void (*release)(void *ptr)) {
+    sock_alloc = (alloc != NULL) ? alloc : malloc;
+    sock_release = (release != NULL) ? release : free;
+}
+
+size_t tcp_sock_size() {
+    return sizeof(tcpsock_t);
+}
+
 int tcp_passive_open(tcpsock_t **sock, int port) {
     int result;
     struct sockaddr_in addr;
@@ -65,7 +81,7 @@ int tcp_passive_open(tcpsock_t **sock, int port) {
     TCP_ERR_HANDLER(s == NULL, return TCP_MEMORY_ERROR);
     s->sd = socket(PROTOCOLFAMILY, TYPE, PROTOCOL);
     TCP_DEBUG_PRINTF(s->sd < 0, "Socket() failed with errno = %d [%s]", errno, strerror(errno));
-    TCP_ERR_HANDLER(s->sd < 0, free(s);return TCP_SOCKOP_ERROR);
+    TCP_ERR_HANDLER(s->sd < 0, sock_release(s);return TCP_SOCKOP_ERROR);
     // Construct the server address structure
     memset(&addr, 0, sizeof(struct sockaddr_in));
     addr.sin_family = PROTOCOLFAMILY;
@@ -73,10 +89,10 @@ int tcp_passive_open(tcpsock_t **sock, int port) {
     addr.sin_port = htons(port);
     result = bind(s->sd, (struct sockaddr *) &addr, sizeof(addr));
     TCP_DEBUG_PRINTF(result == -1, "Bind() failed with errno = %d [%s]", errno, strerror(errno));
-    TCP_ERR_HANDLER(result != 0, free(s);return TCP_SOCKOP_ERROR);
+    TCP_ERR_HANDLER(result != 0, sock_release(s);return TCP_SOCKOP_ERROR);
     result = listen(s->sd, MAX_PENDING);
     TCP_DEBUG_PRINTF(result == -1, "Listen() failed with errno = %d [%s]", errno, strerror(errno));
-    TCP_ERR_HANDLER(result != 0, free(s);return TCP_SOCKOP_ERROR);
+    TCP_ERR_HANDLER(result != 0, sock_release(s);return TCP_SOCKOP_ERROR);
     s->ip_addr = NULL; // address set to INADDR_ANY - not a specific IP address
     s->port = port;
     s->cookie = MAGIC_COOKIE;
@@ -95,24 +111,23 @@ int tcp_active_open(tcpsock_t **sock, int remote_port, char *remote_ip) {
     TCP_ERR_HANDLER(client == NULL, return TCP_MEMORY_ERROR);
     client->sd = socket(PROTOCOLFAMILY, TYPE, PROTOCOL);
     TCP_DEBUG_PRINTF(client->sd < 0, "Socket() failed with errno = %d [%s]", errno, strerror(errno));
-    TCP_ERR_HANDLER(client->sd < 0, free(client);return TCP_SOCKOP_ERROR);
+    TCP_ERR_HANDLER(client->sd < 0, sock_release(client);return TCP_SOCKOP_ERROR);
     /* Construct the server address structure */
     memset(&addr, 0, sizeof(struct sockaddr_in));
     addr.sin_family = PROTOCOLFAMILY;
     result = inet_aton(remote_ip, (struct in_addr *) &addr.sin_addr.s_addr);
-    TCP_ERR_HANDLER(result == 0, free(client);return TCP_ADDRESS_ERROR);
+    TCP_ERR_HANDLER(result == 0, sock_release(client);return TCP_ADDRESS_ERROR);
     addr.sin_port = htons(remote_port);
     result = connect(client->sd, (struct sockaddr *) &addr, sizeof(addr));
     TCP_DEBUG_PRINTF(result == -1, "Connect() failed with errno = %d [%s]", errno, strerror(errno));
-    TCP_ERR_HANDLER(result != 0, free(client);return TCP_SOCKOP_ERROR);
+    TCP_ERR_HANDLER(result != 0, sock_release(client);return TCP_SOCKOP_ERROR);
     memset(&addr, 0, sizeof(struct sockaddr_in));
     length = sizeof(addr);
     result = getsockname(client->sd, (struct sockaddr *) &addr, (socklen_t *) &length);
     TCP_DEBUG_PRINTF(result == -1, "getsockname() failed with errno = %d [%s]", errno, strerror(errno));
-    TCP_ERR_HANDLER(result != 0, free(client);return TCP_SOCKOP_ERROR);
+    TCP_ERR_HANDLER(result != 0, sock_release(client);return TCP_SOCKOP_ERROR);
     p = inet_ntoa(addr.sin_addr);  //returns addr to statically allocated buffer
-    client->ip_addr = (char *) malloc(sizeof(char) * CHAR_IP_ADDR_LENGTH);
-    TCP_ERR_HANDLER(client->ip_addr == NULL, free(client);return TCP_MEMORY_ERROR);
+    client->ip_addr = client->ip_buffer;
     client->ip_addr = strncpy(client->ip_addr, p, CHAR_IP_ADDR_LENGTH);
     client->port = ntohs(addr.sin_port);
     client->cookie = MAGIC_COOKIE;
@@ -134,10 +149,7 @@ int tcp_close(tcpsock_t **socket) {
     }
 
     // N?u socket h?p l? ? dng k?t n?i v gi?i phng
-    if ((*socket)->ip_addr != NULL) {
-        free((*socket)->ip_addr);
-        (*socket)->ip_addr = NULL;
-    }
+    (*socket)->ip_addr = NULL;
 
     if ((*socket)->sd >= 0) {
         result = shutdown((*socket)->sd, SHUT_RDWR);
@@ -153,7 +165,7 @@ int tcp_close(tcpsock_t **socket) {
     (*socket)->cookie = 0;
     (*socket)->port = -1;
 
-    free(*socket);
+    sock_release(*socket);
     *socket = NULL;
 
     return TCP_NO_ERROR;
@@ -171,10 +183,9 @@ int tcp_wait_for_connection(tcpsock_t *socket, tcpsock_t **new_socket) {
     TCP_ERR_HANDLER(s == NULL, return TCP_MEMORY_ERROR);
     s->sd = accept(socket->sd, (struct sockaddr *) &addr, &length);
     TCP_DEBUG_PRINTF(s->sd == -1, "Accept() failed with errno = %d [%s]", errno, strerror(errno));
-    TCP_ERR_HANDLER(s->sd == -1, free(s);return TCP_SOCKOP_ERROR);
+    TCP_ERR_HANDLER(s->sd == -1, sock_release(s);return TCP_SOCKOP_ERROR);
     p = inet_ntoa(addr.sin_addr);  //returns addr to statically allocated buffer
-    s->ip_addr = (char *) malloc(sizeof(char) * CHAR_IP_ADDR_LENGTH);
-    TCP_ERR_HANDLER(s->ip_addr == NULL, free(s);return TCP_MEMORY_ERROR);
+    s->ip_addr = s->ip_buffer;
     s->ip_addr = strncpy(s->ip_addr, p, CHAR_IP_ADDR_LENGTH);
     s->port = ntohs(addr.sin_port);
     s->cookie = MAGIC_COOKIE;
@@ -243,8 +254,136 @@ int tcp_get_sd(tcpsock_t *socket, int *sd) {
     return TCP_NO_ERROR;
 }
 
+int tcp_set_nonblocking(tcpsock_t *socket, int nonblocking) {
+    TCP_ERR_HANDLER(socket == NULL, return TCP_SOCKET_ERROR);
+    TCP_ERR_HANDLER(socket->cookie != MAGIC_COOKIE, return TCP_SOCKET_ERROR);
+    int flags = fcntl(socket->sd, F_GETFL, 0);
+    TCP_DEBUG_PRINTF(flags == -1, "fcntl() failed with errno = %d [%s]", errno, strerror(errno));
+    TCP_ERR_HANDLER(flags == -1, return TCP_SOCKOP_ERROR);
+    flags = nonblocking ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK);
+    TCP_ERR_HANDLER(fcntl(socket->sd, F_SETFL, flags) == -1, return TCP_SOCKOP_ERROR);
+    return TCP_NO_ERROR;
+}
+
+int tcp_receive_some(tcpsock_t *socket, void *buffer, int *buf_size) {
+    TCP_ERR_HANDLER(socket == NULL, return TCP_SOCKET_ERROR);
+    TCP_ERR_HANDLER(socket->cookie != MAGIC_COOKIE, return TCP_SOCKET_ERROR);
+    if ((buffer == NULL) || (*buf_size <= 0))  //nothing to read
+    {
+        *buf_size = 0;
+        return TCP_NO_ERROR;
+    }
+    ssize_t result;
+    do {
+        result = recv(socket->sd, buffer, *buf_size, MSG_DONTWAIT);
+    } while (result < 0 && errno == EINTR);
+    *buf_size = (result > 0) ? (int) result : 0;
+    TCP_ERR_HANDLER(result == 0, return TCP_CONNECTION_CLOSED);
+    TCP_ERR_HANDLER((result < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK)), return TCP_WOULD_BLOCK);
+    TCP_ERR_HANDLER((result < 0) && ((errno == ENOTCONN) || (errno == ECONNRESET)), return TCP_CONNECTION_CLOSED);
+    TCP_DEBUG_PRINTF(result < 0, "Recv() failed with errno = %d [%s]", errno, strerror(errno));
+    TCP_ERR_HANDLER(result < 0, return TCP_SOCKOP_ERROR);
+    return TCP_NO_ERROR;
+}
+
+int tcp_accept_nonblock(tcpsock_t *socket, tcpsock_t **new_sockets, int max, int *count) {
+    struct sockaddr_in addr;
+    socklen_t length;
+
+    *count = 0;
+    TCP_ERR_HANDLER(socket == NULL, return TCP_SOCKET_ERROR);
+    TCP_ERR_HANDLER(socket->cookie != MAGIC_COOKIE, return TCP_SOCKET_ERROR);
+    // accept every pending connection, until the backlog is empty or 'max' is reached
+    while (*count < max) {
+        length = sizeof(struct sockaddr_in);
+        int sd = accept4(socket->sd, (struct sockaddr *) &addr, &length, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (sd == -1 && errno == EINTR) continue;
+        if (sd == -1) {
+            if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) break;
+            TCP_DEBUG_PRINTF(1, "Accept4() failed with errno = %d [%s]", errno, strerror(errno));
+            return (*count > 0) ? TCP_NO_ERROR : TCP_SOCKOP_ERROR;
+        }
+        tcpsock_t *s = tcp_sock_create();
+        TCP_ERR_HANDLER(s == NULL, close(sd); return (*count > 0) ? TCP_NO_ERROR : TCP_MEMORY_ERROR);
+        s->sd = sd;
+        s->ip_addr = s->ip_buffer;
+        inet_ntop(AF_INET, &addr.sin_addr, s->ip_addr, CHAR_IP_ADDR_LENGTH);
+        s->port = ntohs(addr.sin_port);
+        s->cookie = MAGIC_COOKIE;
+        new_sockets[(*count)++] = s;
+    }
+    return (*count > 0) ? TCP_NO_ERROR : TCP_WOULD_BLOCK;
+}
+
+int tcp_sendv(tcpsock_t *socket, const struct iovec *iov, int iovcnt, int *sent) {
+    *sent = 0;
+    TCP_ERR_HANDLER(socket == NULL, return TCP_SOCKET_ERROR);
+    TCP_ERR_HANDLER(socket->cookie != MAGIC_COOKIE, return TCP_SOCKET_ERROR);
+    if ((iov == NULL) || (iovcnt <= 0)) return TCP_NO_ERROR; //nothing to send
+    struct msghdr message = {.msg_iov = (struct iovec *) iov, .msg_iovlen = iovcnt};
+    ssize_t result;
+    do {
+        // use MSG_NOSIGNAL flag to avoid a SIGPIPE signal when the peer is gone
+        result = sendmsg(socket->sd, &message, MSG_NOSIGNAL);
+    } while (result < 0 && errno == EINTR);
+    *sent = (result > 0) ? (int) result : 0;
+    TCP_ERR_HANDLER((result < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK)), return TCP_WOULD_BLOCK);
+    TCP_ERR_HANDLER((result < 0) && ((errno == EPIPE) || (errno == ENOTCONN) || (errno == ECONNRESET)), return TCP_CONNECTION_CLOSED);
+    TCP_DEBUG_PRINTF(result < 0, "Sendmsg() failed with errno = %d [%s]", errno, strerror(errno));
+    TCP_ERR_HANDLER(result < 0, return TCP_SOCKOP_ERROR);
+    return TCP_NO_ERROR;
+}
+
+int tcp_adopt(tcpsock_t **socket, int sd) {
+    struct sockaddr_in addr;
+    socklen_t length = sizeof(struct sockaddr_in);
+    *socket = NULL;
+    TCP_ERR_HANDLER(sd < 0, return TCP_SOCKET_ERROR);
+    int result = getpeername(sd, (struct sockaddr *) &addr, &length);
+    TCP_DEBUG_PRINTF(result == -1, "Getpeername() failed with errno = %d [%s]", errno, strerror(errno));
+    TCP_ERR_HANDLER(result == -1, return TCP_SOCKOP_ERROR);
+    tcpsock_t *s = tcp_sock_create();
+    TCP_ERR_HANDLER(s == NULL, return TCP_MEMORY_ERROR);
+    s->sd = sd;
+    s->ip_addr = s->ip_buffer;
+    inet_ntop(AF_INET, &addr.sin_addr, s->ip_addr, CHAR_IP_ADDR_LENGTH);
+    s->port = ntohs(addr.sin_port);
+    s->cookie = MAGIC_COOKIE;
+    *socket = s;
+    return TCP_NO_ERROR;
+}
+
+int tcp_adopt_passive(tcpsock_t **socket, int sd) {
+    struct sockaddr_in addr;
+    socklen_t length = sizeof(struct sockaddr_in);
+    *socket = NULL;
+    TCP_ERR_HANDLER(sd < 0, return TCP_SOCKET_ERROR);
+    int result = getsockname(sd, (struct sockaddr *) &addr, &length);
+    TCP_DEBUG_PRINTF(result == -1, "getsockname() failed with errno = %d [%s]", errno, strerror(errno));
+    TCP_ERR_HANDLER(result == -1, return TCP_SOCKOP_ERROR);
+    tcpsock_t *s = tcp_sock_create();
+    TCP_ERR_HANDLER(s == NULL, return TCP_MEMORY_ERROR);
+    s->sd = sd;
+    s->ip_addr = NULL; // like tcp_passive_open, the socket listens on INADDR_ANY
+    s->port = ntohs(addr.sin_port);
+    s->cookie = MAGIC_COOKIE;
+    *socket = s;
+    return TCP_NO_ERROR;
+}
+
+int tcp_detach(tcpsock_t **socket, int *sd) {
+    TCP_ERR_HANDLER(socket == NULL || *socket == NULL, return TCP_SOCKET_ERROR);
+    TCP_ERR_HANDLER((*socket)->cookie != MAGIC_COOKIE, return TCP_SOCKET_ERROR);
+    *sd = (*socket)->sd;
+    (*socket)->cookie = 0;
+    (*socket)->sd = -1;
+    sock_release(*socket);
+    *socket = NULL;
+    return TCP_NO_ERROR;
+}
+
 static tcpsock_t *tcp_sock_create() {
-    tcpsock_t *s = (tcpsock_t *) malloc(sizeof(tcpsock_t));
+    tcpsock_t *s = (tcpsock_t *) sock_alloc(sizeof(tcpsock_t));
     if (s) // init the socket to default values
     {
         s->cookie = 0;  // socket is not yet bound!
@@ -2,6 +2,9 @@
 #ifndef __TCPSOCK_H__
 #define __TCPSOCK_H__
 
+#include <stddef.h>
+#include <sys/uio.h>
+
 #define MIN_PORT    1024
 #define MAX_PORT    65536
 
@@ -11,6 +14,7 @@
 #define    TCP_SOCKOP_ERROR         3   // socket operator (socket, listen, bind, accept,...) error
 #define    TCP_CONNECTION_CLOSED    4   // send/receive indicate connection is closed
 #define    TCP_MEMORY_ERROR         5   // mem alloc error
+#define    TCP_WOULD_BLOCK          6   // nonblocking socket: nothing to accept, receive or send right now (EAGAIN)
 
 #define MAX_PENDING 10
 
@@ -121,4 +125,92 @@ int tcp_get_port(tcpsock_t *socket, int *port);
  */
 int tcp_get_sd(tcpsock_t *socket, int *sd);
 
+/**
+ * Switches 'socket' between blocking and nonblocking mode
+ * If 'socket' is NULL or not yet bound, TCP_SOCKET_ERROR is returned
+ * If the mode can not be changed, TCP_SOCKOP_ERROR is returned
+ * \param socket the socket
+ * \param nonblocking nonzero for nonblocking mode, 0 for blocking mode
+ * \return TCP_NO_ERROR if no error occurs during execution
+ */
+int tcp_set_nonblocking(tcpsock_t *socket, int nonblocking);
+
+/**
+ * Receives at most '*buf_size' bytes without waiting, whatever is available right now
+ * The number of bytes received is returned in '*buf_size', it can be less than requested
+ * If nothing is available, '*buf_size' is 0 and TCP_WOULD_BLOCK is returned
+ * If the peer closed the connection, TCP_CONNECTION_CLOSED is returned
+ * \param socket the socket to read from
+ * \param buffer the buffer to receive in
+ * \param buf_size the size of the buffer, on return the number of bytes received
+ * \return TCP_NO_ERROR if at least one byte was received
+ */
+int tcp_receive_some(tcpsock_t *socket, void *buffer, int *buf_size);
+
+/**
+ * Accepts every pending connection on a passive socket without waiting, at most 'max'
+ * The new sockets are nonblocking and returned in 'new_sockets', their number in '*count'
+ * If no connection is pending, '*count' is 0 and TCP_WOULD_BLOCK is returned
+ * \param socket the passive socket
+ * \param new_sockets room for 'max' sockets
+ * \param max the number of sockets that fit in 'new_sockets'
+ * \param count the number of accepted sockets
+ * \return TCP_NO_ERROR if at least one connection was accepted
+ */
+int tcp_accept_nonblock(tcpsock_t *socket, tcpsock_t **new_sockets, int max, int *count);
+
+/**
+ * Sends the 'iovcnt' buffers of 'iov' with one system call, in order
+ * The number of bytes sent is returned in '*sent', it can be less than the total (partial write):
+ * the caller sends the rest later, starting at byte '*sent'
+ * If a nonblocking socket can not take any data, '*sent' is 0 and TCP_WOULD_BLOCK is returned
+ * \param socket the socket to send to
+ * \param iov the buffers
+ * \param iovcnt the number of buffers
+ * \param sent the number of bytes sent
+ * \return TCP_NO_ERROR if no error occurs during execution
+ */
+int tcp_sendv(tcpsock_t *socket, const struct iovec *iov, int iovcnt, int *sent);
+
+/**
+ * Creates a socket for a connected descriptor that was accepted elsewhere (e.g. by io_uring)
+ * The IP address and port of the peer are looked up, the socket owns 'sd' afterwards and tcp_close closes it
+ * \param socket a double pointer to the new socket
+ * \param sd the connected socket descriptor
+ * \return TCP_NO_ERROR if no error occurs during execution, 'sd' is not closed on error
+ */
+int tcp_adopt(tcpsock_t **socket, int sd);
+
+/**
+ * Creates a socket for a listening descriptor that was opened elsewhere (e.g. by another process)
+ * The port is looked up, the socket owns 'sd' afterwards and tcp_close closes it
+ * \param socket a double pointer to the new socket
+ * \param sd the listening socket descriptor
+ * \return TCP_NO_ERROR if no error occurs during execution, 'sd' is not closed on error
+ */
+int tcp_adopt_passive(tcpsock_t **socket, int sd);
+
+/**
+ * Frees the socket without shutting the connection down, the caller owns the descriptor afterwards
+ * Use it when the descriptor lives on elsewhere (e.g. it was passed to another process), tcp_close would end the connection
+ * \param socket a double pointer to the socket, set to NULL
+ * \param sd the socket descriptor
+ * \return TCP_NO_ERROR if no error occurs during execution
+ */
+int tcp_detach(tcpsock_t **socket, int *sd);
+
+/**
+ * Replaces the allocator of the socket structures, the default is malloc and free
+ * Call it before any socket is created, a socket must be closed with the allocator it was created with
+ * \param alloc returns memory for one socket structure of 'size' bytes, NULL restores malloc
+ * \param release frees a socket structure, NULL restores free
+ */
+void tcp_set_allocator(void *(*alloc)(size_t size), void (*release)(void *ptr));
+
+/**
+ * Returns the size of one socket structure, e.g. to set up a fixed-size allocator for tcp_set_allocator
+ * \return sizeof(tcpsock_t)
+ */
+size_t tcp_sock_size();
+
 #endif  //__TCPSOCK_H__
@@ -4,9 +4,11 @@
 #include <string.h>
 #include <time.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <unistd.h>
 #include "config.h"
 #include "tcpsock.h"
+#include "local_ring.h"
 
  // conditional compilation option to control the number of measurements this sensor node wil generate
 #if (LOOPS > 1)
@@ -51,9 +53,36 @@
 #define INITIAL_TEMPERATURE 20
 #define TEMP_DEV 5    // max deviation from previous temperature in 0.1 celsius
 
+// readings kept while the gateway can not be reached, the oldest reading is dropped when the backlog is full
+#ifndef NODE_BACKLOG
+#define NODE_BACKLOG 4096
+#endif
+
+// readings sent with one system call when the backlog is flushed
+#define NODE_FLUSH_BATCH 64
+
+// the wait before a reconnect doubles after every failed attempt, from NODE_BACKOFF_MIN to NODE_BACKOFF_MAX (ms)
+#define NODE_BACKOFF_MIN 250
+#define NODE_BACKOFF_MAX 30000
+
+// size of one reading on the wire: <sensor_id><temperature><timestamp>
+#define NODE_FRAME_SIZE (sizeof(sensor_id_t) + sizeof(sensor_value_t) + sizeof(sensor_ts_t))
+
+typedef struct {
+	sensor_data_t readings[NODE_BACKLOG];
+	int head;               // the oldest reading
+	int count;
+	long dropped;           // readings that did not fit
+} backlog_t;
 
 void print_help(void);
 int checkIP(char server_ip[]);
+void backlog_push(backlog_t* backlog, sensor_data_t* data);
+int backlog_flush(tcpsock_t* client, backlog_t* backlog);
+int backlog_flush_local(local_ring_t* ring, backlog_t* backlog);
+int send_iov(tcpsock_t* client, struct iovec* iov, int iovcnt, size_t* total);
+uint64_t node_clock();
+void node_sleep(uint64_t ms);
 
 /**
  * For starting the sensor node 4 command line arguments are needed. These should be given in the order below
@@ -63,61 +92,188 @@ int checkIP(char server_ip[]);
  * argv[2] = sleep time
  * argv[3] = server IP
  * argv[4] = server port
+ *
+ * A node on the gateway host can give 'local' instead of the IP and port, it hands its readings over in shared memory
  */
 
 int main(int argc, char* argv[]){
 	sensor_data_t data;
 	int server_port;
 	char server_ip[] = "000.000.000.000";
-	tcpsock_t* client;
-	int i, bytes, sleep_time;
+	tcpsock_t* client = NULL;
+	local_ring_t* ring = NULL;
+	bool connected = false;
+	int i, sleep_time;
+	static backlog_t backlog;
 
 	LOG_OPEN();
 
-	if(argc != 5){
+	bool local = (argc == 4 && strcmp(argv[3], "local") == 0);
+	if(argc != 5 && !local){
 		print_help();
 		exit(EXIT_SUCCESS);
 	} else{
 		data.id = atoi(argv[1]);
 		sleep_time = atoi(argv[2]);
-		strncpy(server_ip, argv[3], strlen(server_ip));
-		server_port = atoi(argv[4]);
+		if(!local){
+			strncpy(server_ip, argv[3], strlen(server_ip));
+			server_port = atoi(argv[4]);
+		}
 	}
 
 	//verifying IP
-	if(checkIP(server_ip) == -1) printf("ERROR: INVALID IP: %s\n", server_ip), exit(EXIT_FAILURE);
+	if(!local && checkIP(server_ip) == -1) printf("ERROR: INVALID IP: %s\n", server_ip), exit(EXIT_FAILURE);
+	// the ring outlives a gateway, it is registered again with the next one
+	if(local && local_ring_create(&ring, LOCAL_RING_CAPACITY) != LOCAL_RING_SUCCESS) printf("ERROR: NO LOCAL RING\n"), exit(EXIT_FAILURE);
 
-	srand48(time(NULL));
-
-	// open TCP connection to the server; server is listening to SERVER_IP and PORT
-	if(tcp_active_open(&client, server_port, server_ip) != TCP_NO_ERROR) printf("CANNOT OPEN TCP CONNECTION\n"), exit(EXIT_FAILURE);
+	// the jitter must differ between nodes that were started together
+	srand48(time(NULL) ^ ((long) getpid() << 16) ^ data.id);
 
 	data.value = INITIAL_TEMPERATURE;
 	i = LOOPS;
+	uint64_t next_reading = node_clock();
+	uint64_t next_attempt = next_reading;
+	uint64_t backoff = NODE_BACKOFF_MIN;
 	while(i){
-		data.value = data.value + TEMP_DEV * ((drand48() - 0.5) / 10);
-		time(&data.ts);
-		// send data to server in this order (!!): <sensor_id><temperature><timestamp>
-		// remark: don't send as a struct!
-		bytes = sizeof(data.id);
-		if(tcp_send(client, (void*) &data.id, &bytes) != TCP_NO_ERROR) exit(EXIT_FAILURE);
-		bytes = sizeof(data.value);
-		if(tcp_send(client, (void*) &data.value, &bytes) != TCP_NO_ERROR) exit(EXIT_FAILURE);
-		bytes = sizeof(data.ts);
-		if(tcp_send(client, (void*) &data.ts, &bytes) != TCP_NO_ERROR) exit(EXIT_FAILURE);
-		LOG_PRINTF(data.id, data.value, data.ts);
-		sleep(sleep_time);
-		UPDATE(i);
-	}
+		uint64_t now = node_clock();
+		if(now >= next_reading){
+			data.value = data.value + TEMP_DEV * ((drand48() - 0.5) / 10);
+			// the wire only carries the second, the local ring the time in microseconds
+			struct timespec wall;
+			clock_gettime(CLOCK_REALTIME, &wall);
+			data.ts = wall.tv_sec;
+			data.time = (sensor_time_t) wall.tv_sec * SENSOR_TIME_SECOND + wall.tv_nsec / 1000;
+			// readings are taken while the gateway is away, they go out when the node is connected again
+			backlog_push(&backlog, &data);
+			LOG_PRINTF(data.id, data.value, data.ts);
+			next_reading = now + (uint64_t) sleep_time * 1000;
+			UPDATE(i);
+		}
+
+		// open TCP connection to the server; server is listening to SERVER_IP and PORT, or register the ring
+		if(!connected && now >= next_attempt){
+			connected = local ? (local_ring_register(ring, LOCAL_RING_SOCKET) == LOCAL_RING_SUCCESS)
+			                  : (tcp_active_open(&client, server_port, server_ip) == TCP_NO_ERROR);
+			if(connected){
+				printf("CONNECTED, %d READINGS IN THE BACKLOG\n", backlog.count);
+				backoff = NODE_BACKOFF_MIN;
+			}
+			else{
+				client = NULL;
+				// a random wait between half and all of the backoff, so nodes that lost the gateway together do not return together
+				next_attempt = now + backoff / 2 + (uint64_t) (drand48() * (backoff / 2));
+				backoff = (backoff * 2 > NODE_BACKOFF_MAX) ? NODE_BACKOFF_MAX : backoff * 2;
+			}
+		}
 
+		if(connected && (local ? backlog_flush_local(ring, &backlog) : backlog_flush(client, &backlog)) != TCP_NO_ERROR){
+			printf("CONNECTION LOST, %d READINGS IN THE BACKLOG\n", backlog.count);
+			if(client != NULL) tcp_close(&client);
+			client = NULL;
+			connected = false;
+			next_attempt = now + backoff / 2 + (uint64_t) (drand48() * (backoff / 2));
+		}
+
+		// sleep until the next reading, or the next attempt to connect if that comes first
+		uint64_t wake = (!connected && next_attempt < next_reading) ? next_attempt : next_reading;
+		if(i && wake > now) node_sleep(wake - now);
+	}
 
-	if(tcp_close(&client) != TCP_NO_ERROR) exit(EXIT_FAILURE);
+	if(backlog.dropped > 0) printf("DROPPED %ld READINGS, THE BACKLOG WAS FULL\n", backlog.dropped);
+	if(!connected || backlog.count > 0) exit(EXIT_FAILURE);
+	if(local){
+		// the readings in the ring are gone with it, the gateway gets the time to take them
+		while(local_ring_available(ring) > 0 && local_ring_check(ring) == LOCAL_RING_SUCCESS) node_sleep(10);
+		if(local_ring_available(ring) > 0) exit(EXIT_FAILURE);
+		local_ring_close(&ring);
+	}
+	else if(tcp_close(&client) != TCP_NO_ERROR) exit(EXIT_FAILURE);
 
 	LOG_CLOSE();
 
 	exit(EXIT_SUCCESS);
 }
 
+void backlog_push(backlog_t* backlog, sensor_data_t* data){
+	if(backlog->count == NODE_BACKLOG){
+		backlog->head = (backlog->head + 1) % NODE_BACKLOG;
+		backlog->count--;
+		backlog->dropped++;
+	}
+	backlog->readings[(backlog->head + backlog->count) % NODE_BACKLOG] = *data;
+	backlog->count++;
+}
+
+int backlog_flush(tcpsock_t* client, backlog_t* backlog){
+	while(backlog->count > 0){
+		// send data to server in this order (!!): <sensor_id><temperature><timestamp>
+		// remark: don't send as a struct! The fields of a batch of readings go out with one system call
+		int count = backlog->count;
+		if(count > NODE_FLUSH_BATCH) count = NODE_FLUSH_BATCH;
+		if(count > NODE_BACKLOG - backlog->head) count = NODE_BACKLOG - backlog->head;
+		struct iovec iov[3 * NODE_FLUSH_BATCH];
+		for(int r = 0; r < count; r++){
+			sensor_data_t* data = &(backlog->readings[backlog->head + r]);
+			iov[3 * r] = (struct iovec) {&(data->id), sizeof(data->id)};
+			iov[3 * r + 1] = (struct iovec) {&(data->value), sizeof(data->value)};
+			iov[3 * r + 2] = (struct iovec) {&(data->ts), sizeof(data->ts)};
+		}
+
+		// a reading that only went out in part is sent again on the next connection, the gateway drops the part
+		size_t total = 0;
+		int result = send_iov(client, iov, 3 * count, &total);
+		int sent = total / NODE_FRAME_SIZE;
+		backlog->head = (backlog->head + sent) % NODE_BACKLOG;
+		backlog->count -= sent;
+		if(result != TCP_NO_ERROR) return result;
+	}
+	return TCP_NO_ERROR;
+}
+
+int backlog_flush_local(local_ring_t* ring, backlog_t* backlog){
+	// a full ring keeps the rest in the backlog, where the oldest reading is dropped when it is full as well
+	while(backlog->count > 0 && local_ring_push(ring, &(backlog->readings[backlog->head])) == LOCAL_RING_SUCCESS){
+		backlog->head = (backlog->head + 1) % NODE_BACKLOG;
+		backlog->count--;
+	}
+	return (local_ring_check(ring) == LOCAL_RING_SUCCESS) ? TCP_NO_ERROR : TCP_CONNECTION_CLOSED;
+}
+
+int send_iov(tcpsock_t* client, struct iovec* iov, int iovcnt, size_t* total){
+	struct iovec* next = iov;
+	int left = iovcnt;
+	*total = 0;
+	while(left > 0){
+		int sent;
+		int result = tcp_sendv(client, next, left, &sent);
+		if(result != TCP_NO_ERROR) return result;
+		*total += sent;
+
+		// a partial write: skip what was sent and continue with the rest
+		while(left > 0 && (size_t) sent >= next->iov_len){
+			sent -= next->iov_len;
+			next++;
+			left--;
+		}
+		if(left > 0){
+			next->iov_base = (char*) next->iov_base + sent;
+			next->iov_len -= sent;
+		}
+	}
+	return TCP_NO_ERROR;
+}
+
+uint64_t node_clock(){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+void node_sleep(uint64_t ms){
+	struct timespec ts = {ms / 1000, (ms % 1000) * 1000000L};
+	while(nanosleep(&ts, &ts) == -1);
+}
+
 /**
  * Helper method to print a message on how to use this application
  */
@@ -125,7 +281,7 @@ void print_help(void){
 	printf("Use this program with 4 command line options: \n");
 	printf("\t%-15s : a unique sensor node ID\n", "\'ID\'");
 	printf("\t%-15s : node sleep time (in sec) between two measurements\n", "\'sleep time\'");
-	printf("\t%-15s : TCP server IP address\n", "\'server IP\'");
+	printf("\t%-15s : TCP server IP address, or local for a gateway on this host\n", "\'server IP\'");
 	printf("\t%-15s : TCP server port number\n", "\'server port\'");
 }
 
@@ -0,0 +1,396 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "config.h"
+
+/*
+ * Load generator: one process drives many virtual sensors, each over its own nonblocking TCP connection.
+ * The readings use the wire format of sensor_node: <sensor_id><temperature><timestamp>.
+ * Every sensor has its next reading in a min-heap; the loop sends what is due and waits in epoll for connects
+ * that complete and for sockets that can take the bytes a full send buffer left behind.
+ */
+
+#define SIM_FRAME_SIZE (sizeof(sensor_id_t) + sizeof(sensor_value_t) + sizeof(sensor_ts_t))
+// readings kept per sensor while its socket is full, a reading that does not fit any more is dropped
+#define SIM_OUT_FRAMES 32
+#define SIM_EVENTS 256
+// a connection that failed or ended is opened again after 1 s plus up to 1 s of jitter
+#define SIM_RECONNECT_NS 1000000000ULL
+#define SIM_NS 1000000000ULL
+
+#define INITIAL_TEMPERATURE 20
+#define TEMP_DEV 5    // max deviation from previous temperature in 0.1 celsius, as in sensor_node
+
+typedef enum {SIM_WALK, SIM_UNIFORM, SIM_NORMAL} sim_distribution_t;
+
+typedef struct {
+    sensor_id_t id;
+    int fd;                             // -1 while disconnected
+    bool connecting;
+    bool waiting;                       // the socket waits for EPOLLOUT
+    sensor_value_t value;
+    uint64_t next_event;                // ns: the next reading, or the next connect while disconnected (the heap key)
+    uint64_t reconnect_at;              // ns: when a disconnected sensor connects again
+    uint64_t disconnect_at;             // ns: churn closes the connection then, 0 without churn
+    int out_len;                        // bytes in 'out' that the socket did not take yet
+    uint8_t out[SIM_OUT_FRAMES * SIM_FRAME_SIZE];
+} sim_sensor_t;
+
+typedef struct {
+    struct sockaddr_in gateway;
+    int sensors;
+    int first_id;
+    double rate;                        // readings per second per sensor
+    double duration;                    // seconds, 0 runs until SIGINT
+    double churn;                       // mean connection lifetime in seconds, 0 keeps the connections
+    sim_distribution_t distribution;
+    double mean;
+    double spread;
+} sim_config_t;
+
+typedef struct {
+    uint64_t sent;                      // readings handed to the kernel completely
+    uint64_t dropped;                   // readings that found their sensor disconnected or its buffer full
+    uint64_t connects;
+    uint64_t failures;                  // connects that failed and connections that broke
+    int connected;
+} sim_stats_t;
+
+// helper methods
+static void print_help(void);
+static int sim_parse(int argc, char* argv[], sim_config_t* config);
+static void sim_handle(sim_sensor_t* sensor, uint64_t now);
+static void sim_send(sim_sensor_t* sensor);
+static void sim_flush(sim_sensor_t* sensor);
+static void sim_connect(sim_sensor_t* sensor, uint64_t now);
+static void sim_connected(sim_sensor_t* sensor, uint64_t now);
+static void sim_disconnect(sim_sensor_t* sensor, uint64_t now, bool failed);
+static sensor_value_t sim_value(sim_sensor_t* sensor);
+static uint64_t sim_lifetime();
+static void heap_push(sim_sensor_t* sensor);
+static sim_sensor_t* heap_pop();
+static uint64_t sim_clock();
+
+// global variables
+static sim_config_t config;
+static sim_stats_t stats;
+static sim_sensor_t* sensors;
+static sim_sensor_t** heap;
+static int heap_size = 0;
+static int epoll_fd;
+static uint64_t interval;               // ns between two readings of a sensor
+static time_t wall_clock;               // the timestamp of the readings, read once per loop
+static volatile sig_atomic_t running = 1;
+
+static void sim_stop(int sig){
+    (void) sig;
+    running = 0;
+}
+
+int main(int argc, char* argv[]){
+    if(sim_parse(argc, argv, &config) != 0){
+        print_help();
+        return EXIT_FAILURE;
+    }
+    srand48(time(NULL) ^ getpid());
+    signal(SIGINT, sim_stop);
+    signal(SIGTERM, sim_stop);
+    signal(SIGPIPE, SIG_IGN);
+
+    // every sensor needs a descriptor
+    struct rlimit limit;
+    if(getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max){
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    sensors = calloc(config.sensors, sizeof(sim_sensor_t));
+    heap = malloc(config.sensors * sizeof(sim_sensor_t*));
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if(sensors == NULL || heap == NULL || epoll_fd == -1) printf("CANNOT START THE SIMULATOR\n"), exit(EXIT_FAILURE);
+
+    // the sensors connect together, their readings are spread over the first interval
+    interval = (uint64_t) (SIM_NS / config.rate);
+    uint64_t start = sim_clock();
+    wall_clock = time(NULL);
+    for(int i = 0; i < config.sensors; i++){
+        sim_sensor_t* sensor = &sensors[i];
+        sensor->id = (sensor_id_t) (config.first_id + i);
+        sensor->fd = -1;
+        sensor->value = (config.distribution == SIM_WALK) ? config.mean : 0;
+        sim_connect(sensor, start);
+        sensor->next_event = start + (uint64_t) (drand48() * interval);
+        heap_push(sensor);
+    }
+
+    uint64_t end = (config.duration > 0) ? start + (uint64_t) (config.duration * SIM_NS) : UINT64_MAX;
+    uint64_t next_report = start + SIM_NS;
+    uint64_t reported = 0;
+    struct epoll_event events[SIM_EVENTS];
+    while(running){
+        uint64_t now = sim_clock();
+        wall_clock = time(NULL);
+        while(heap_size > 0 && heap[0]->next_event <= now){
+            sim_sensor_t* sensor = heap_pop();
+            sim_handle(sensor, now);
+            heap_push(sensor);
+        }
+
+        if(now >= next_report){
+            printf("%6.1f s  SENT %llu/s  CONNECTED %d  DROPPED %llu  FAILURES %llu\n", (now - start) / 1e9,
+                   (unsigned long long) (stats.sent - reported), stats.connected,
+                   (unsigned long long) stats.dropped, (unsigned long long) stats.failures);
+            fflush(stdout);
+            reported = stats.sent;
+            next_report += SIM_NS;
+        }
+        if(now >= end) break;
+
+        // wait for the next reading, a socket that is ready or the next report
+        uint64_t wake = (heap_size > 0 && heap[0]->next_event < next_report) ? heap[0]->next_event : next_report;
+        int timeout = (wake > now) ? (int) ((wake - now + 999999) / 1000000) : 0;
+        int ready = epoll_wait(epoll_fd, events, SIM_EVENTS, timeout);
+        now = sim_clock();
+        for(int e = 0; e < ready; e++){
+            sim_sensor_t* sensor = events[e].data.ptr;
+            if(sensor->fd == -1) continue;
+            // the gateway closed the connection or the connect failed
+            if(events[e].events & (EPOLLERR | EPOLLHUP | EPOLLRDHUP)){
+                sim_disconnect(sensor, now, true);
+                continue;
+            }
+            if(sensor->connecting) sim_connected(sensor, now);
+            else if(events[e].events & EPOLLOUT) sim_flush(sensor);
+        }
+    }
+
+    uint64_t elapsed = sim_clock() - start;
+    for(int i = 0; i < config.sensors; i++) if(sensors[i].fd != -1) close(sensors[i].fd);
+    printf("SENT %llu READINGS FROM %d SENSORS IN %.1f S: %.0f READINGS/S (TARGET %.0f/S)\n",
+           (unsigned long long) stats.sent, config.sensors, elapsed / 1e9, stats.sent / (elapsed / 1e9), config.sensors * config.rate);
+    printf("CONNECTS %llu  FAILURES %llu  DROPPED %llu\n", (unsigned long long) stats.connects,
+           (unsigned long long) stats.failures, (unsigned long long) stats.dropped);
+    close(epoll_fd);
+    free(heap);
+    free(sensors);
+    return EXIT_SUCCESS;
+}
+
+static void sim_handle(sim_sensor_t* sensor, uint64_t now){
+    // the key of a sensor only changes here, while it is out of the heap
+    if(sensor->fd == -1){
+        if(now >= sensor->reconnect_at) sim_connect(sensor, now);
+        sensor->next_event = (sensor->fd == -1) ? sensor->reconnect_at : now + (uint64_t) (drand48() * interval);
+        return;
+    }
+
+    // churn: the connection ends between two readings
+    if(sensor->disconnect_at != 0 && now >= sensor->disconnect_at && !sensor->connecting){
+        sim_disconnect(sensor, now, false);
+        sensor->next_event = sensor->reconnect_at;
+        return;
+    }
+
+    sim_send(sensor);
+    // the schedule does not drift when the loop is late, a late reading is sent right away
+    sensor->next_event += interval;
+    if(sensor->next_event < now) sensor->next_event = now;
+}
+
+static void sim_send(sim_sensor_t* sensor){
+    sensor_value_t value = sim_value(sensor);
+    if(sensor->connecting || sensor->out_len + (int) SIM_FRAME_SIZE > (int) sizeof(sensor->out)){
+        stats.dropped++;
+        return;
+    }
+
+    // send data to server in this order (!!): <sensor_id><temperature><timestamp>
+    uint8_t* frame = sensor->out + sensor->out_len;
+    sensor_ts_t ts = wall_clock;
+    memcpy(frame, &(sensor->id), sizeof(sensor_id_t));
+    memcpy(frame + sizeof(sensor_id_t), &value, sizeof(sensor_value_t));
+    memcpy(frame + sizeof(sensor_id_t) + sizeof(sensor_value_t), &ts, sizeof(sensor_ts_t));
+    sensor->out_len += SIM_FRAME_SIZE;
+    // while bytes are waiting for EPOLLOUT the new reading queues behind them
+    if(sensor->out_len == (int) SIM_FRAME_SIZE) sim_flush(sensor);
+}
+
+static void sim_flush(sim_sensor_t* sensor){
+    // a reading counts as sent once its last byte is taken
+    int before = (sensor->out_len + SIM_FRAME_SIZE - 1) / SIM_FRAME_SIZE;
+    ssize_t sent = send(sensor->fd, sensor->out, sensor->out_len, MSG_NOSIGNAL);
+    if(sent == -1 && errno != EAGAIN && errno != EWOULDBLOCK){
+        sim_disconnect(sensor, sim_clock(), true);
+        return;
+    }
+    if(sent > 0){
+        memmove(sensor->out, sensor->out + sent, sensor->out_len - sent);
+        sensor->out_len -= sent;
+        stats.sent += before - (sensor->out_len + SIM_FRAME_SIZE - 1) / SIM_FRAME_SIZE;
+    }
+
+    // only a socket with bytes left waits for EPOLLOUT, the registration only changes with that
+    bool waiting = (sensor->out_len > 0);
+    if(waiting == sensor->waiting) return;
+    sensor->waiting = waiting;
+    struct epoll_event event = {.events = EPOLLRDHUP | (waiting ? EPOLLOUT : 0), .data.ptr = sensor};
+    epoll_ctl(epoll_fd, EPOLL_CTL_MOD, sensor->fd, &event);
+}
+
+static void sim_connect(sim_sensor_t* sensor, uint64_t now){
+    sensor->fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_TCP);
+    if(sensor->fd == -1){
+        sim_disconnect(sensor, now, true);
+        return;
+    }
+    sensor->out_len = 0;
+    sensor->connecting = true;
+    if(connect(sensor->fd, (struct sockaddr*) &(config.gateway), sizeof(config.gateway)) == -1 && errno != EINPROGRESS){
+        close(sensor->fd);
+        sensor->fd = -1;
+        sim_disconnect(sensor, now, true);
+        return;
+    }
+    // the connect completes with EPOLLOUT
+    struct epoll_event event = {.events = EPOLLOUT | EPOLLRDHUP, .data.ptr = sensor};
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, sensor->fd, &event);
+}
+
+static void sim_connected(sim_sensor_t* sensor, uint64_t now){
+    int error = 0;
+    socklen_t length = sizeof(error);
+    if(getsockopt(sensor->fd, SOL_SOCKET, SO_ERROR, &error, &length) != 0 || error != 0){
+        sim_disconnect(sensor, now, true);
+        return;
+    }
+    sensor->connecting = false;
+    sensor->waiting = false;
+    sensor->disconnect_at = (config.churn > 0) ? now + sim_lifetime() : 0;
+    stats.connects++;
+    stats.connected++;
+    struct epoll_event event = {.events = EPOLLRDHUP, .data.ptr = sensor};
+    epoll_ctl(epoll_fd, EPOLL_CTL_MOD, sensor->fd, &event);
+}
+
+static void sim_disconnect(sim_sensor_t* sensor, uint64_t now, bool failed){
+    if(sensor->fd != -1){
+        if(!sensor->connecting) stats.connected--;
+        close(sensor->fd);
+        sensor->fd = -1;
+    }
+    sensor->connecting = false;
+    sensor->out_len = 0;
+    if(failed) stats.failures++;
+    // churn reconnects at once, a failure waits so a gateway that is down is not flooded with connects
+    sensor->reconnect_at = now + (failed ? SIM_RECONNECT_NS + (uint64_t) (drand48() * SIM_RECONNECT_NS) : 0);
+}
+
+static sensor_value_t sim_value(sim_sensor_t* sensor){
+    switch(config.distribution){
+        case SIM_UNIFORM:
+            return config.mean + config.spread * (2 * drand48() - 1);
+        case SIM_NORMAL:{
+            // Box-Muller
+            double u = 1.0 - drand48();
+            return config.mean + config.spread * sqrt(-2 * log(u)) * cos(2 * M_PI * drand48());
+        }
+        default:
+            sensor->value += TEMP_DEV * ((drand48() - 0.5) / 10);
+            return sensor->value;
+    }
+}
+
+static uint64_t sim_lifetime(){
+    // exponential lifetimes: the sensors do not all reconnect in the same second
+    return (uint64_t) (-log(1.0 - drand48()) * config.churn * SIM_NS);
+}
+
+static void heap_push(sim_sensor_t* sensor){
+    int i = heap_size++;
+    while(i > 0 && heap[(i - 1) / 2]->next_event > sensor->next_event){
+        heap[i] = heap[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    heap[i] = sensor;
+}
+
+static sim_sensor_t* heap_pop(){
+    sim_sensor_t* top = heap[0];
+    sim_sensor_t* last = heap[--heap_size];
+    int i = 0;
+    for(;;){
+        int child = 2 * i + 1;
+        if(child >= heap_size) break;
+        if(child + 1 < heap_size && heap[child + 1]->next_event < heap[child]->next_event) child++;
+        if(heap[child]->next_event >= last->next_event) break;
+        heap[i] = heap[child];
+        i = child;
+    }
+    if(heap_size > 0) heap[i] = last;
+    return top;
+}
+
+static uint64_t sim_clock(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * SIM_NS + ts.tv_nsec;
+}
+
+static int sim_parse(int argc, char* argv[], sim_config_t* config){
+    *config = (sim_config_t) {.sensors = 100, .first_id = 1, .rate = 1.0, .distribution = SIM_WALK,
+                              .mean = INITIAL_TEMPERATURE, .spread = 5.0};
+    int option;
+    while((option = getopt(argc, argv, "n:i:r:d:c:D:m:s:")) != -1){
+        switch(option){
+            case 'n': config->sensors = atoi(optarg); break;
+            case 'i': config->first_id = atoi(optarg); break;
+            case 'r': config->rate = atof(optarg); break;
+            case 'd': config->duration = atof(optarg); break;
+            case 'c': config->churn = atof(optarg); break;
+            case 'm': config->mean = atof(optarg); break;
+            case 's': config->spread = atof(optarg); break;
+            case 'D':
+                if(strcmp(optarg, "walk") == 0) config->distribution = SIM_WALK;
+                else if(strcmp(optarg, "uniform") == 0) config->distribution = SIM_UNIFORM;
+                else if(strcmp(optarg, "normal") == 0) config->distribution = SIM_NORMAL;
+                else return -1;
+                break;
+            default: return -1;
+        }
+    }
+    if(argc - optind != 2) return -1;
+    memset(&(config->gateway), 0, sizeof(config->gateway));
+    config->gateway.sin_family = AF_INET;
+    config->gateway.sin_port = htons(atoi(argv[optind + 1]));
+    if(inet_aton(argv[optind], &(config->gateway.sin_addr)) == 0) return -1;
+    // the sensor ids are 16 bit
+    if(config->sensors <= 0 || config->first_id < 0 || config->first_id + config->sensors - 1 > UINT16_MAX) return -1;
+    if(config->rate <= 0 || config->duration < 0 || config->churn < 0) return -1;
+    return 0;
+}
+
+static void print_help(void){
+    printf("Use this program as: sensor_sim [options] 'server IP' 'server port'\n");
+    printf("\t%-12s : number of virtual sensors (default 100)\n", "-n SENSORS");
+    printf("\t%-12s : id of the first sensor, the others follow (default 1)\n", "-i ID");
+    printf("\t%-12s : readings per second of every sensor, e.g. 0.2 or 50 (default 1)\n", "-r RATE");
+    printf("\t%-12s : seconds to run, 0 runs until SIGINT (default 0)\n", "-d SECONDS");
+    printf("\t%-12s : mean lifetime of a connection in seconds, 0 keeps them open (default 0)\n", "-c SECONDS");
+    printf("\t%-12s : walk, uniform or normal (default walk)\n", "-D DIST");
+    printf("\t%-12s : start value of the walk, mean of uniform and normal (default %d)\n", "-m MEAN", INITIAL_TEMPERATURE);
+    printf("\t%-12s : half width of uniform, standard deviation of normal (default 5)\n", "-s SPREAD");
+}
@@ -0,0 +1,119 @@
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <signal.h>
+#include "config.h"
+#include "logger.h"
+#include "sensor_map.h"
+#include "alert_rules.h"
+
+// index of the rule of every sensor, room and type, 0 (the default rule) if there is none on that level
+typedef struct {
+    alert_rule_t rules[ALERT_RULES_MAX];
+    int count;
+    uint16_t sensor_rule[65536];
+    uint16_t room_rule[65536];
+    uint16_t type_rule[SENSOR_TYPE_NR + 1];
+} alert_table_t;
+
+// helper methods
+static alert_table_t* alert_rules_parse(FILE* fp_rules);
+
+// global variables
+static alert_table_t* table = NULL;
+static volatile sig_atomic_t reload_requested = 0;
+
+int alert_rules_init(FILE* fp_rules){
+    alert_table_t* parsed = alert_rules_parse(fp_rules);
+    if(parsed == NULL) return ALERT_RULES_FAILURE;
+    free(table);
+    table = parsed;
+    return ALERT_RULES_SUCCESS;
+}
+
+void alert_rules_request_reload(){
+    reload_requested = 1;
+}
+
+void alert_rules_poll(){
+    if(!reload_requested) return;
+    reload_requested = 0;
+
+    FILE* fp_rules = fopen(ALERT_RULES_FILE, "r");
+    if(fp_rules == NULL){
+        log_message(LOG_WARNING, "AlertRules", "Could not read %s, keeping the current rules\n", ALERT_RULES_FILE);
+        return;
+    }
+    // the datamgr is the only reader, the table can be replaced right away
+    int res = alert_rules_init(fp_rules);
+    fclose(fp_rules);
+    if(res == ALERT_RULES_SUCCESS)
+        log_message(LOG_LEVEL_INFO, "AlertRules", "RELOADED ALERT RULES: %d RULES", table->count);
+}
+
+const alert_rule_t* alert_rules_find(sensor_id_t sensor_id, room_id_t room_id, sensor_type_t type){
+    uint16_t rule = table->sensor_rule[sensor_id];
+    if(rule == 0) rule = table->room_rule[room_id];
+    if(rule == 0) rule = table->type_rule[type];
+    return &(table->rules[rule]);
+}
+
+void alert_rules_free(){
+    free(table);
+    table = NULL;
+}
+
+static alert_table_t* alert_rules_parse(FILE* fp_rules){
+    alert_table_t* parsed = calloc(1, sizeof(alert_table_t));
+    if(parsed == NULL) return NULL;
+
+    // rule 0 is the default rule
+    parsed->rules[0] = (alert_rule_t) {
+        .min = SET_MIN_TEMP, .max = SET_MAX_TEMP,
+        .hysteresis = 0, .interval = ALERT_REPEAT_INTERVAL
+    };
+    parsed->count = 1;
+
+    char line[128];
+    int line_nr = 0;
+    while(fp_rules != NULL && fgets(line, sizeof(line), fp_rules) != NULL){
+        line_nr++;
+        char scope[16], id[32];
+        alert_rule_t rule = {.hysteresis = 0, .interval = ALERT_REPEAT_INTERVAL};
+
+        // empty lines and comments are skipped
+        char* start = line + strspn(line, " \t");
+        if(*start == '#' || *start == '\n' || *start == '\0') continue;
+
+        if(sscanf(start, "%15s %31s %lf %lf %lf %d", scope, id, &rule.min, &rule.max, &rule.hysteresis, &rule.interval) < 4
+           || rule.min > rule.max || rule.hysteresis < 0 || rule.interval < 0){
+            log_message(LOG_WARNING, "AlertRules", "%s:%d: invalid rule skipped\n", ALERT_RULES_FILE, line_nr);
+            continue;
+        }
+
+        if(strcmp(scope, "default") == 0){
+            parsed->rules[0] = rule;
+            continue;
+        }
+        if(parsed->count == ALERT_RULES_MAX){
+            log_message(LOG_WARNING, "AlertRules", "%s:%d: more than %d rules, rule skipped\n", ALERT_RULES_FILE, line_nr, ALERT_RULES_MAX);
+            continue;
+        }
+
+        uint16_t* slot = NULL;
+        if(strcmp(scope, "sensor") == 0) slot = &(parsed->sensor_rule[(sensor_id_t) atoi(id)]);
+        else if(strcmp(scope, "room") == 0) slot = &(parsed->room_rule[(room_id_t) atoi(id)]);
+        else if(strcmp(scope, "type") == 0 && sensor_type_from_name(id) != SENSOR_UNKNOWN) slot = &(parsed->type_rule[sensor_type_from_name(id)]);
+        if(slot == NULL){
+            log_message(LOG_WARNING, "AlertRules", "%s:%d: unknown scope '%s %s', rule skipped\n", ALERT_RULES_FILE, line_nr, scope, id);
+            continue;
+        }
+
+        // a later rule for the same sensor, room or type replaces the earlier one
+        parsed->rules[parsed->count] = rule;
+        *slot = parsed->count++;
+    }
+    return parsed;
+}
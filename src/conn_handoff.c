@@ -0,0 +1,110 @@
+#define _GNU_SOURCE
+
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/time.h>
+#include "conn_handoff.h"
+
+// helper methods
+static int conn_handoff_address(const char* path, struct sockaddr_un* addr);
+static void conn_handoff_set_timeout(int channel);
+
+int conn_handoff_listen(const char* path){
+    struct sockaddr_un addr;
+    if(conn_handoff_address(path, &addr) != CONN_HANDOFF_SUCCESS) return -1;
+    int listener = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if(listener == -1) return -1;
+
+    // a successor binds the path again after the takeover, the old listener keeps running unreachable until it closes
+    unlink(path);
+    if(bind(listener, (struct sockaddr*) &addr, sizeof(addr)) != 0 || listen(listener, 1) != 0){
+        close(listener);
+        return -1;
+    }
+    return listener;
+}
+
+int conn_handoff_accept(int listener){
+    int channel = accept4(listener, NULL, NULL, SOCK_CLOEXEC);
+    if(channel != -1) conn_handoff_set_timeout(channel);
+    return channel;
+}
+
+int conn_handoff_connect(const char* path){
+    struct sockaddr_un addr;
+    if(conn_handoff_address(path, &addr) != CONN_HANDOFF_SUCCESS) return -1;
+    int channel = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if(channel == -1) return -1;
+    // no socket file, or a file nobody listens on any more
+    if(connect(channel, (struct sockaddr*) &addr, sizeof(addr)) != 0){
+        close(channel);
+        return -1;
+    }
+    conn_handoff_set_timeout(channel);
+    return channel;
+}
+
+int conn_handoff_send(int channel, int fd, const void* data, size_t size){
+    struct iovec iov = {.iov_base = (void*) data, .iov_len = size};
+    union {
+        struct cmsghdr header;
+        char buffer[CMSG_SPACE(sizeof(int))];
+    } control;
+    struct msghdr msg = {.msg_iov = &iov, .msg_iovlen = 1};
+    if(fd >= 0){
+        memset(&control, 0, sizeof(control));
+        msg.msg_control = control.buffer;
+        msg.msg_controllen = sizeof(control.buffer);
+        struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+        memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+    }
+
+    ssize_t sent;
+    while((sent = sendmsg(channel, &msg, MSG_NOSIGNAL)) == -1 && errno == EINTR);
+    return (sent == (ssize_t) size) ? CONN_HANDOFF_SUCCESS : CONN_HANDOFF_FAILURE;
+}
+
+int conn_handoff_receive(int channel, int* fd, void* data, size_t size){
+    struct iovec iov = {.iov_base = data, .iov_len = size};
+    union {
+        struct cmsghdr header;
+        char buffer[CMSG_SPACE(sizeof(int))];
+    } control;
+    struct msghdr msg = {.msg_iov = &iov, .msg_iovlen = 1, .msg_control = control.buffer, .msg_controllen = sizeof(control.buffer)};
+
+    *fd = -1;
+    ssize_t received;
+    while((received = recvmsg(channel, &msg, MSG_CMSG_CLOEXEC)) == -1 && errno == EINTR);
+    if(received == -1) return CONN_HANDOFF_FAILURE;
+
+    for(struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg))
+        if(cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) memcpy(fd, CMSG_DATA(cmsg), sizeof(int));
+
+    // a truncated message is as bad as a missing one, the descriptor that came with it is not used
+    if(received != (ssize_t) size || (msg.msg_flags & (MSG_TRUNC | MSG_CTRUNC))){
+        if(*fd != -1) close(*fd);
+        *fd = -1;
+        return CONN_HANDOFF_FAILURE;
+    }
+    return CONN_HANDOFF_SUCCESS;
+}
+
+static int conn_handoff_address(const char* path, struct sockaddr_un* addr){
+    memset(addr, 0, sizeof(struct sockaddr_un));
+    addr->sun_family = AF_UNIX;
+    if(strlen(path) >= sizeof(addr->sun_path)) return CONN_HANDOFF_FAILURE;
+    strcpy(addr->sun_path, path);
+    return CONN_HANDOFF_SUCCESS;
+}
+
+static void conn_handoff_set_timeout(int channel){
+    struct timeval timeout = {CONN_HANDOFF_TIMEOUT_MS / 1000, (CONN_HANDOFF_TIMEOUT_MS % 1000) * 1000};
+    setsockopt(channel, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(channel, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+}
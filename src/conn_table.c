@@ -0,0 +1,123 @@
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <string.h>
+#include "config.h"
+#include "conn_table.h"
+
+// helper methods
+static int conn_table_grow(conn_table_t* table, int capacity);
+static int conn_table_grow_fds(conn_table_t* table, int fd);
+static void* conn_table_resize(void* array, size_t size, int capacity, bool* failed);
+
+int conn_table_init(conn_table_t** table){
+    *table = calloc(1, sizeof(conn_table_t));
+    if(*table == NULL) return CONN_TABLE_FAILURE;
+
+    (*table)->free_head = -1;
+    if(conn_table_grow(*table, CONN_TABLE_CHUNK) != CONN_TABLE_SUCCESS){
+        conn_table_free(table);
+        return CONN_TABLE_FAILURE;
+    }
+    return CONN_TABLE_SUCCESS;
+}
+
+conn_t* conn_table_add(conn_table_t* table, int fd, short events, tcpsock_t* socket){
+    if(fd < 0) return NULL;
+    if(fd >= table->fd_capacity && conn_table_grow_fds(table, fd) != CONN_TABLE_SUCCESS) return NULL;
+    if(table->free_head == -1 && conn_table_grow(table, table->capacity * 2) != CONN_TABLE_SUCCESS) return NULL;
+
+    // pop the free list
+    int slot = table->free_head;
+    table->free_head = table->next_free[slot];
+    table->next_free[slot] = -1;
+    table->count++;
+    if(slot >= table->high) table->high = slot + 1;
+
+    conn_t* conn = conn_table_get(table, slot);
+    memset(conn, 0, sizeof(conn_t));
+    conn->socket_id = socket;
+    conn->slot = slot;
+
+    table->pollfds[slot] = (struct pollfd) {.fd = fd, .events = events, .revents = 0};
+    table->slot_of_fd[fd] = slot + 1;
+    return conn;
+}
+
+void conn_table_remove(conn_table_t* table, int slot){
+    int fd = table->pollfds[slot].fd;
+    if(fd < 0) return;
+    if(fd < table->fd_capacity) table->slot_of_fd[fd] = 0;
+
+    table->pollfds[slot] = (struct pollfd) {.fd = -1, .events = 0, .revents = 0};
+    table->generation[slot]++;
+    table->count--;
+
+    // push the free list, the most recently released slot is reused first
+    table->next_free[slot] = table->free_head;
+    table->free_head = slot;
+
+    // free slots at the end are not passed to poll() anymore
+    while(table->high > 0 && table->pollfds[table->high - 1].fd < 0) table->high--;
+}
+
+void conn_table_free(conn_table_t** table){
+    if(*table == NULL) return;
+    if((*table)->chunks != NULL)
+        for(int chunk = 0; chunk < (*table)->capacity / CONN_TABLE_CHUNK; chunk++) free((*table)->chunks[chunk]);
+    free((*table)->chunks);
+    free((*table)->pollfds);
+    free((*table)->generation);
+    free((*table)->next_free);
+    free((*table)->slot_of_fd);
+    free(*table);
+    *table = NULL;
+}
+
+static int conn_table_grow(conn_table_t* table, int capacity){
+    // every array is resized on its own, after a failure all arrays are still valid for the old capacity
+    bool failed = false;
+    table->pollfds = conn_table_resize(table->pollfds, sizeof(struct pollfd), capacity, &failed);
+    table->generation = conn_table_resize(table->generation, sizeof(uint32_t), capacity, &failed);
+    table->next_free = conn_table_resize(table->next_free, sizeof(int), capacity, &failed);
+    table->chunks = conn_table_resize(table->chunks, sizeof(conn_t*), capacity / CONN_TABLE_CHUNK, &failed);
+    if(failed) return CONN_TABLE_FAILURE;
+
+    // the connections themselves are never reallocated, the timers of the wheel point into them
+    int chunk = table->capacity / CONN_TABLE_CHUNK;
+    for(; chunk < capacity / CONN_TABLE_CHUNK; chunk++){
+        table->chunks[chunk] = malloc(CONN_TABLE_CHUNK * sizeof(conn_t));
+        if(table->chunks[chunk] == NULL) break;
+    }
+    int grown = chunk * CONN_TABLE_CHUNK;
+    if(grown == table->capacity) return CONN_TABLE_FAILURE;
+
+    // the new slots go on the free list in ascending order
+    for(int slot = grown - 1; slot >= table->capacity; slot--){
+        table->pollfds[slot] = (struct pollfd) {.fd = -1, .events = 0, .revents = 0};
+        table->generation[slot] = 0;
+        table->next_free[slot] = table->free_head;
+        table->free_head = slot;
+    }
+    table->capacity = grown;
+    return CONN_TABLE_SUCCESS;
+}
+
+static int conn_table_grow_fds(conn_table_t* table, int fd){
+    int fd_capacity = table->fd_capacity == 0 ? 1024 : table->fd_capacity;
+    while(fd_capacity <= fd) fd_capacity *= 2;
+
+    int* resized = realloc(table->slot_of_fd, fd_capacity * sizeof(int));
+    if(resized == NULL) return CONN_TABLE_FAILURE;
+    memset(&(resized[table->fd_capacity]), 0, (fd_capacity - table->fd_capacity) * sizeof(int));
+    table->slot_of_fd = resized;
+    table->fd_capacity = fd_capacity;
+    return CONN_TABLE_SUCCESS;
+}
+
+static void* conn_table_resize(void* array, size_t size, int capacity, bool* failed){
+    void* resized = realloc(array, size * capacity);
+    if(resized != NULL) return resized;
+    *failed = true;
+    return array;
+}
@@ -0,0 +1,298 @@
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <signal.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <linux/time_types.h>
+#include <linux/io_uring.h>
+#include "conn_uring.h"
+
+// the buffer group of the receive buffers
+#define CONN_URING_GROUP 0
+// user_data of the receive that checks the kernel for multishot support
+#define CONN_URING_PROBE (UINT64_MAX - 2)
+
+struct conn_uring {
+    int fd;
+    // submission queue, 'sq_local' runs ahead of the shared tail until the entries are submitted
+    unsigned* sq_head;
+    unsigned* sq_tail;
+    unsigned* sq_array;
+    unsigned sq_mask;
+    unsigned sq_entries;
+    unsigned sq_local;
+    struct io_uring_sqe* sqes;
+    // completion queue
+    unsigned* cq_head;
+    unsigned* cq_tail;
+    unsigned cq_mask;
+    struct io_uring_cqe* cqes;
+    // provided buffers: the ring the kernel takes buffers from and the memory behind them
+    struct io_uring_buf_ring* buf_ring;
+    uint16_t buf_tail;
+    uint8_t* buffers;
+    // mappings of the rings
+    void* ring_map;
+    size_t ring_map_size;
+    size_t sqes_size;
+    size_t buf_ring_size;
+};
+
+// helper methods
+static struct io_uring_sqe* conn_uring_sqe(conn_uring_t* ring);
+static int conn_uring_enter(conn_uring_t* ring, unsigned wait, int timeout_ms);
+static void conn_uring_provide(conn_uring_t* ring, uint16_t bid);
+static bool conn_uring_probe(conn_uring_t* ring);
+
+int conn_uring_init(conn_uring_t** ring){
+    *ring = calloc(1, sizeof(conn_uring_t));
+    if(*ring == NULL) return CONN_URING_FAILURE;
+    conn_uring_t* r = *ring;
+    r->fd = -1;
+    r->ring_map = r->sqes = MAP_FAILED;
+    r->buf_ring = MAP_FAILED;
+
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_CQSIZE;
+    params.cq_entries = 4 * CONN_URING_ENTRIES;
+    r->fd = (int) syscall(__NR_io_uring_setup, CONN_URING_ENTRIES, &params);
+    if(r->fd < 0) goto failure;
+
+    // one mapping for both rings (5.4), waiting with a timeout (5.11) and no dropped completions
+    unsigned needed = IORING_FEAT_SINGLE_MMAP | IORING_FEAT_EXT_ARG | IORING_FEAT_NODROP;
+    if((params.features & needed) != needed) goto failure;
+
+    size_t sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    size_t cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    r->ring_map_size = sq_size > cq_size ? sq_size : cq_size;
+    r->ring_map = mmap(NULL, r->ring_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQ_RING);
+    if(r->ring_map == MAP_FAILED) goto failure;
+    r->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    r->sqes = mmap(NULL, r->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQES);
+    if(r->sqes == MAP_FAILED) goto failure;
+
+    char* map = r->ring_map;
+    r->sq_head = (unsigned*) (map + params.sq_off.head);
+    r->sq_tail = (unsigned*) (map + params.sq_off.tail);
+    r->sq_array = (unsigned*) (map + params.sq_off.array);
+    r->sq_mask = *(unsigned*) (map + params.sq_off.ring_mask);
+    r->sq_entries = params.sq_entries;
+    r->sq_local = *(r->sq_tail);
+    r->cq_head = (unsigned*) (map + params.cq_off.head);
+    r->cq_tail = (unsigned*) (map + params.cq_off.tail);
+    r->cq_mask = *(unsigned*) (map + params.cq_off.ring_mask);
+    r->cqes = (struct io_uring_cqe*) (map + params.cq_off.cqes);
+
+    // register the ring of provided buffers (5.19), it has to be page aligned
+    r->buf_ring_size = CONN_URING_BUFFERS * sizeof(struct io_uring_buf);
+    r->buf_ring = mmap(NULL, r->buf_ring_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(r->buf_ring == MAP_FAILED) goto failure;
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (uint64_t) (uintptr_t) r->buf_ring;
+    reg.ring_entries = CONN_URING_BUFFERS;
+    reg.bgid = CONN_URING_GROUP;
+    if(syscall(__NR_io_uring_register, r->fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) goto failure;
+
+    r->buffers = malloc((size_t) CONN_URING_BUFFERS * CONN_URING_BUFFER_SIZE);
+    if(r->buffers == NULL) goto failure;
+    for(int bid = 0; bid < CONN_URING_BUFFERS; bid++) conn_uring_provide(r, (uint16_t) bid);
+
+    // multishot receive (6.0) is the newest feature used, the older kernels reject the flag
+    if(!conn_uring_probe(r)) goto failure;
+    return CONN_URING_SUCCESS;
+
+failure:
+    conn_uring_free(ring);
+    return CONN_URING_FAILURE;
+}
+
+int conn_uring_accept(conn_uring_t* ring, int server_fd){
+    struct io_uring_sqe* sqe = conn_uring_sqe(ring);
+    if(sqe == NULL) return CONN_URING_FAILURE;
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = server_fd;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+    sqe->user_data = CONN_URING_ACCEPT;
+    return CONN_URING_SUCCESS;
+}
+
+int conn_uring_recv(conn_uring_t* ring, int fd, uint64_t user_data){
+    struct io_uring_sqe* sqe = conn_uring_sqe(ring);
+    if(sqe == NULL) return CONN_URING_FAILURE;
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = fd;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = CONN_URING_GROUP;
+    sqe->user_data = user_data;
+    return CONN_URING_SUCCESS;
+}
+
+int conn_uring_poll(conn_uring_t* ring, int fd){
+    struct io_uring_sqe* sqe = conn_uring_sqe(ring);
+    if(sqe == NULL) return CONN_URING_FAILURE;
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd;
+    sqe->len = IORING_POLL_ADD_MULTI;
+    sqe->poll32_events = POLLIN;
+    sqe->user_data = CONN_URING_POLL;
+    return CONN_URING_SUCCESS;
+}
+
+int conn_uring_poll_once(conn_uring_t* ring, int fd, uint64_t user_data){
+    struct io_uring_sqe* sqe = conn_uring_sqe(ring);
+    if(sqe == NULL) return CONN_URING_FAILURE;
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd;
+    sqe->poll32_events = POLLIN;
+    sqe->user_data = user_data;
+    return CONN_URING_SUCCESS;
+}
+
+int conn_uring_cancel(conn_uring_t* ring, uint64_t user_data){
+    struct io_uring_sqe* sqe = conn_uring_sqe(ring);
+    if(sqe == NULL) return CONN_URING_FAILURE;
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = user_data;
+    sqe->cancel_flags = IORING_ASYNC_CANCEL_ALL;
+    sqe->user_data = CONN_URING_IGNORE;
+    return CONN_URING_SUCCESS;
+}
+
+int conn_uring_wait(conn_uring_t* ring, int timeout_ms){
+    // events that are already there are taken without waiting
+    bool empty = (*(ring->cq_head) == __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE));
+    if(!empty && ring->sq_local == *(ring->sq_tail)) return CONN_URING_SUCCESS;
+    return conn_uring_enter(ring, empty ? 1 : 0, timeout_ms);
+}
+
+bool conn_uring_next(conn_uring_t* ring, conn_uring_event_t* event){
+    unsigned head = *(ring->cq_head);
+    if(head == __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE)) return false;
+
+    struct io_uring_cqe* cqe = &(ring->cqes[head & ring->cq_mask]);
+    event->user_data = cqe->user_data;
+    event->res = cqe->res;
+    event->flags = cqe->flags;
+    event->more = (cqe->flags & IORING_CQE_F_MORE);
+    // the entry can be reused by the kernel, the buffer stays ours until it is released
+    __atomic_store_n(ring->cq_head, head + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+const uint8_t* conn_uring_buffer(conn_uring_t* ring, const conn_uring_event_t* event){
+    if(!(event->flags & IORING_CQE_F_BUFFER)) return NULL;
+    return ring->buffers + (size_t) (event->flags >> IORING_CQE_BUFFER_SHIFT) * CONN_URING_BUFFER_SIZE;
+}
+
+void conn_uring_release(conn_uring_t* ring, const conn_uring_event_t* event){
+    if(!(event->flags & IORING_CQE_F_BUFFER)) return;
+    conn_uring_provide(ring, (uint16_t) (event->flags >> IORING_CQE_BUFFER_SHIFT));
+}
+
+void conn_uring_free(conn_uring_t** ring){
+    if(ring == NULL || *ring == NULL) return;
+    conn_uring_t* r = *ring;
+
+    // closing the ring cancels the pending requests and unregisters the buffers
+    if(r->fd >= 0) close(r->fd);
+    if(r->sqes != MAP_FAILED) munmap(r->sqes, r->sqes_size);
+    if(r->ring_map != MAP_FAILED) munmap(r->ring_map, r->ring_map_size);
+    if(r->buf_ring != MAP_FAILED) munmap(r->buf_ring, r->buf_ring_size);
+    free(r->buffers);
+    free(r);
+    *ring = NULL;
+}
+
+static struct io_uring_sqe* conn_uring_sqe(conn_uring_t* ring){
+    // a full submission queue is handed to the kernel first
+    if(ring->sq_local - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE) >= ring->sq_entries){
+        if(conn_uring_enter(ring, 0, 0) != CONN_URING_SUCCESS) return NULL;
+        if(ring->sq_local - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE) >= ring->sq_entries) return NULL;
+    }
+    unsigned index = ring->sq_local & ring->sq_mask;
+    struct io_uring_sqe* sqe = &(ring->sqes[index]);
+    memset(sqe, 0, sizeof(struct io_uring_sqe));
+    ring->sq_array[index] = index;
+    ring->sq_local++;
+    return sqe;
+}
+
+static int conn_uring_enter(conn_uring_t* ring, unsigned wait, int timeout_ms){
+    // publish the new entries, the kernel reads them during the call
+    __atomic_store_n(ring->sq_tail, ring->sq_local, __ATOMIC_RELEASE);
+    unsigned submit = ring->sq_local - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+    if(submit == 0 && wait == 0) return CONN_URING_SUCCESS;
+
+    struct __kernel_timespec timeout = {
+        .tv_sec = timeout_ms / 1000,
+        .tv_nsec = (long long) (timeout_ms % 1000) * 1000000,
+    };
+    struct io_uring_getevents_arg arg;
+    memset(&arg, 0, sizeof(arg));
+    arg.sigmask_sz = _NSIG / 8;
+    arg.ts = (uint64_t) (uintptr_t) &timeout;
+
+    unsigned flags = IORING_ENTER_EXT_ARG | (wait > 0 ? IORING_ENTER_GETEVENTS : 0);
+    long result = syscall(__NR_io_uring_enter, ring->fd, submit, wait, flags, &arg, sizeof(arg));
+    // a timeout, a signal or a full completion queue: the caller takes the events that are there
+    if(result < 0 && errno != ETIME && errno != EINTR && errno != EBUSY && errno != EAGAIN) return CONN_URING_FAILURE;
+    return CONN_URING_SUCCESS;
+}
+
+static void conn_uring_provide(conn_uring_t* ring, uint16_t bid){
+    struct io_uring_buf* buf = &(ring->buf_ring->bufs[ring->buf_tail & (CONN_URING_BUFFERS - 1)]);
+    buf->addr = (uint64_t) (uintptr_t) (ring->buffers + (size_t) bid * CONN_URING_BUFFER_SIZE);
+    buf->len = CONN_URING_BUFFER_SIZE;
+    buf->bid = bid;
+    ring->buf_tail++;
+    __atomic_store_n(&(ring->buf_ring->tail), ring->buf_tail, __ATOMIC_RELEASE);
+}
+
+static bool conn_uring_probe(conn_uring_t* ring){
+    int pair[2];
+    if(socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, pair) < 0) return false;
+
+    // a multishot receive of one byte stays armed (IORING_CQE_F_MORE) on a kernel that supports it
+    bool supported = false;
+    bool done = false;
+    if(write(pair[1], "p", 1) == 1 && conn_uring_recv(ring, pair[0], CONN_URING_PROBE) == CONN_URING_SUCCESS){
+        conn_uring_event_t event;
+        for(int tries = 0; tries < 10 && !supported && !done; tries++){
+            if(conn_uring_wait(ring, 100) != CONN_URING_SUCCESS) break;
+            while(conn_uring_next(ring, &event)){
+                if(event.user_data != CONN_URING_PROBE) continue;
+                conn_uring_release(ring, &event);
+                supported = (event.res == 1 && event.more);
+                done = !event.more;
+            }
+        }
+    }
+
+    // wait for the end of the receive, so no event of the probe is left for the caller
+    if(!done && conn_uring_cancel(ring, CONN_URING_PROBE) == CONN_URING_SUCCESS){
+        conn_uring_event_t event;
+        for(int tries = 0; tries < 10 && !done; tries++){
+            if(conn_uring_wait(ring, 100) != CONN_URING_SUCCESS) break;
+            while(conn_uring_next(ring, &event)){
+                if(event.user_data != CONN_URING_PROBE) continue;
+                conn_uring_release(ring, &event);
+                done = !event.more;
+            }
+        }
+    }
+    close(pair[0]);
+    close(pair[1]);
+    return supported && done;
+}
@@ -1,52 +1,151 @@
-
 #define _GNU_SOURCE
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <inttypes.h>
+#include <stddef.h>
+#include <string.h>
 #include <time.h>
+#include <errno.h>
 #include <poll.h>
-#include "dplist.h"
+#include <signal.h>
+#include <stdatomic.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
 #include "connection_manager.h"
 #include "config.h"
 #include "sensor_buffer.h"
+#include "timer_wheel.h"
+#include "conn_table.h"
+#include "conn_uring.h"
+#include "conn_handoff.h"
+#include "local_ring.h"
+#include "reorder_window.h"
+#include "data_manager.h"
 #include <fcntl.h>
 #include <unistd.h>
 #include <pthread.h>
 #include "logger.h"
 
-typedef struct pollfd pollfd_t;
-
-typedef struct{
-	pollfd_t file_d;
-	sensor_id_t sensor_id;
-	tcpsock_t* socket_id;
-	sensor_ts_t last_modified;
-} poll_info_t;
-
-// dpl_create functions
-void* element_copy(void* element);
-void element_free(void** element);
-int element_compare(void* x, void* y);
+// the server socket always has slot 0 of the connection table
+#define SERVER_SLOT 0
+// the UDP socket, if there is one, has the slot after the server
+#define UDP_SLOT 1
+
+// a datagram with the largest number of readings
+#define CONNMGR_UDP_SIZE (sizeof(uint32_t) + CONNMGR_UDP_READINGS * CONN_FRAME_SIZE)
+
+// the sequence numbers behind the next one of a sensor that are remembered, one bit each
+#define CONNMGR_UDP_WINDOW 64
+
+// the recvmmsg buffers of the UDP socket, the next sequence number of every sensor and the statistics
+typedef struct {
+	uint8_t data[CONNMGR_UDP_BATCH][CONNMGR_UDP_SIZE];
+	struct iovec iov[CONNMGR_UDP_BATCH];
+	struct mmsghdr msgs[CONNMGR_UDP_BATCH];
+	uint32_t next_sequence[65536];
+	uint64_t received[65536];   /** < bit i: sequence number next_sequence - 1 - i arrived */
+	uint8_t seen[65536];
+	uint64_t datagrams;
+	uint64_t readings;
+	uint64_t lost;
+	uint64_t late;          /** < datagrams behind the sequence that did not arrive before, they are published */
+	uint64_t dropped;       /** < duplicates, and datagrams too far behind to tell */
+	uint64_t invalid;
+} connmgr_udp_t;
+
+// where released readings go, see connmgr_release_reading
+typedef struct {
+	sbuffer_t** buffer;
+	FILE* fp_sensor_data_text;
+	int* readings;
+} connmgr_sink_t;
 
 // helper functions
-int connmgr_add_sensor(poll_info_t** poll_at_index, int* list_size);
-int connmgr_add_sensor_data(sbuffer_t** buffer, poll_info_t** poll_at_index, sensor_data_t* sensor_data);
-void connmgr_remove_sensor(int* list_size, int index, poll_info_t** poll_at_index, poll_info_t* poll_server);
-void connmgr_close_connection(int port_number, poll_info_t** poll_at_index, poll_info_t* poll_server, FILE* fp_sensor_data_text);
-void connmgr_update_threads();
+uint64_t connmgr_poll_wait(sbuffer_t** buffer, conn_t* poll_server, FILE* fp_sensor_data_text, int* readings);
+uint64_t connmgr_uring_wait(sbuffer_t** buffer, conn_t* poll_server, FILE* fp_sensor_data_text, int* readings);
+int connmgr_add_sensor(conn_t* poll_server, uint64_t now);
+conn_t* connmgr_open_sensor(tcpsock_t* socket, uint64_t now);
+int connmgr_add_sensor_data(sbuffer_t** buffer, conn_t** poll_at_index, uint64_t now, FILE* fp_sensor_data_text, int* readings);
+void connmgr_add_bytes(sbuffer_t** buffer, conn_t* poll_at_index, const uint8_t* data, int size, FILE* fp_sensor_data_text, int* readings);
+void connmgr_store_reading(sbuffer_t** buffer, conn_t* poll_at_index, sensor_data_t* sensor_data, FILE* fp_sensor_data_text, int* readings);
+sensor_data_t* connmgr_decode_reading(sbuffer_t** buffer, const uint8_t* data);
+void connmgr_ingest_reading(sbuffer_t** buffer, sensor_data_t* sensor_data, FILE* fp_sensor_data_text, int* readings);
+void connmgr_release_reading(sensor_data_t* sensor_data, void* arg);
+void connmgr_release_readings(sbuffer_t** buffer, FILE* fp_sensor_data_text, int* readings, bool all);
+int connmgr_wait_timeout();
+void connmgr_publish_reading(sbuffer_t** buffer, sensor_data_t* sensor_data, FILE* fp_sensor_data_text);
+int connmgr_udp_open(int fd);
+void connmgr_udp_drain(sbuffer_t** buffer, conn_t* poll_server, uint64_t now, FILE* fp_sensor_data_text, int* readings);
+void connmgr_udp_datagram(sbuffer_t** buffer, const uint8_t* data, int size, FILE* fp_sensor_data_text, int* readings);
+void connmgr_udp_close();
+void connmgr_add_local(uint64_t now);
+void connmgr_local_hello(conn_t* poll_at_index, uint64_t now);
+void connmgr_local_drain(sbuffer_t** buffer, conn_t* poll_at_index, uint64_t now, FILE* fp_sensor_data_text, int* readings);
+void connmgr_local_resume(sbuffer_t** buffer, uint64_t now, FILE* fp_sensor_data_text, int* readings);
+void connmgr_mark_pending(conn_t* poll_at_index);
+int connmgr_add_handle(conn_handle_t** list, int* size, int* capacity, conn_handle_t handle);
+void connmgr_remove_sensor(conn_t* poll_at_index, conn_t* poll_server, uint64_t now);
+void connmgr_remove_closing(conn_t* poll_server, uint64_t now);
+void connmgr_take_over(int channel, uint32_t count, uint64_t now);
+void connmgr_hand_over(int channel, sbuffer_t** buffer, conn_t* poll_server, FILE* fp_sensor_data_text);
+void connmgr_uring_quiesce(sbuffer_t** buffer, conn_t* poll_server, FILE* fp_sensor_data_text);
+void connmgr_uring_rearm();
+void connmgr_mark_closing(conn_t* poll_at_index);
+void connmgr_close_connection(int port_number, FILE* fp_sensor_data_text);
+void connmgr_idle_expired(timer_entry_t* timer, void* arg);
+void connmgr_load_timeouts(FILE* fp_timeouts);
+void connmgr_update_threads(int count);
 void connmgr_close_threads();
 
 // global variables
-static dplist_t* dpl_connections;
+static conn_table_t* connections = NULL;
+static timer_wheel_t* wheel = NULL;
+static reorder_window_t* window = NULL;
+// NULL when the connmgr polls
+static conn_uring_t* ring = NULL;
+static int backend = CONNMGR_BACKEND;
+// connections that are removed at the end of the iteration, a handle goes stale if it was already removed
+static conn_handle_t* closing = NULL;
+static int closing_size = 0;
+static int closing_capacity = 0;
+static bool connmgr_idle = false;
+static volatile sig_atomic_t stop_requested = 0;
+// the Unix socket a new gateway takes the sockets over from, -1 without one
+static int handoff_listener = -1;
+static bool handing_off = false;
+static bool handed_off = false;
+// the main thread waits for the server before it starts the readers, see connmgr_wait_started
+static pthread_mutex_t started_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t started_cond = PTHREAD_COND_INITIALIZER;
+static bool started = false;
+static bool took_over = false;
+// set once by a successful handoff, it outlives connmgr_free
+static atomic_bool handed_over = false;
+// requests of the ring that did not post their last completion yet while handing off
+static int handoff_armed = 0;
+// the UDP socket, -1 without one; the slots before 'first_sensor' are the server and the UDP socket
+static int udp_port = 0;
+static int udp_fd = -1;
+static connmgr_udp_t* udp = NULL;
+static int first_sensor = SERVER_SLOT + 1;
+// the last drain stopped at its budget, io_uring posts no new wakeup for the datagrams that are left
+static bool udp_backlog = false;
+// the Unix socket producers on this host register their ring on, -1 without one
+static int local_listener = -1;
+static int local_count = 0;
+// local producers whose readings did not ring the doorbell, they are taken in the next iteration
+static conn_handle_t* local_pending = NULL;
+static int local_pending_size = 0;
+static int local_pending_capacity = 0;
+// idle timeouts in ms: the default and one per sensor id (0 means the default)
+static uint64_t default_timeout = (uint64_t) TIMEOUT * 1000;
+static uint32_t* sensor_timeout = NULL;
 // multithreading variables
-static pthread_cond_t* data_cond;
-static pthread_mutex_t* datamgr_lock;
-static int* data_mgr;
-
-static pthread_cond_t* db_cond;
-static pthread_mutex_t* db_lock;
-static int* data_sensor_db;
+static notifier_t* datamgr_notify;
+static notifier_t* db_notify;
+static notifier_t* stream_notify;
 
 static pthread_rwlock_t* connmgr_lock;
 static bool* connmgr_working;
@@ -56,13 +155,9 @@ static pthread_mutex_t* log_mutex;
 static int* fifo_fd;
 
 void connmgr_init(config_thread_t* config_thread){
-	data_cond = config_thread->data_cond;
-	datamgr_lock = config_thread->datamgr_lock;
-	data_mgr = config_thread->data_mgr;
-
-	db_cond = config_thread->db_cond;
-	db_lock = config_thread->db_lock;
-	data_sensor_db = config_thread->data_sensor_db;
+	datamgr_notify = config_thread->datamgr_notify;
+	db_notify = config_thread->db_notify;
+	stream_notify = config_thread->stream_notify;
 
 	connmgr_lock = config_thread->connmgr_lock;
 	connmgr_working = config_thread->connmgr_working;
@@ -72,288 +167,982 @@ void connmgr_init(config_thread_t* config_thread){
 	log_mutex = config_thread->log_mutex;
 }
 
+void connmgr_set_timeout(int seconds){
+	if(seconds > 0) default_timeout = (uint64_t) seconds * 1000;
+}
+
+int connmgr_set_backend(const char* name){
+	if(strcmp(name, "auto") == 0) backend = CONNMGR_BACKEND_AUTO;
+	else if(strcmp(name, "poll") == 0) backend = CONNMGR_BACKEND_POLL;
+	else if(strcmp(name, "uring") == 0) backend = CONNMGR_BACKEND_URING;
+	else return -1;
+	return 0;
+}
+
+void connmgr_set_udp_port(int port){
+	udp_port = (port > 0) ? port : 0;
+}
+
+void connmgr_request_stop(){
+	stop_requested = 1;
+}
+
 
 void connmgr_listen(int port_number, sbuffer_t** buffer){
 #ifdef DEBUG
 	printf(PURPLE_CLR "CONNMGR: NEW CONNMGR.\n" OFF_CLR);
 #endif
-	// create and initialize dpl_connections
-	dpl_connections = dpl_create(element_copy, element_free, element_compare);
-
-	// open file 
-	FILE* fp_sensor_data_text = fopen("sensor_data_recv", "w");
+	// create and initialize the connection table
+	if(conn_table_init(&connections) != CONN_TABLE_SUCCESS) printf("CANNOT CREATE CONNECTION TABLE\n"), exit(EXIT_FAILURE);
+
+	// the per sensor timeouts are optional
+	FILE* fp_timeouts = fopen(TIMEOUT_MAP_FILE, "r");
+	connmgr_load_timeouts(fp_timeouts);
+	if(fp_timeouts != NULL) fclose(fp_timeouts);
+
+	// all idle timeouts are kept in one wheel on the local monotonic clock
+	uint64_t now = timer_wheel_clock();
+	if(timer_wheel_init(&wheel, now) != TIMER_WHEEL_SUCCESS) printf("CANNOT CREATE TIMER WHEEL\n"), exit(EXIT_FAILURE);
+	// the readings of every sensor are published in the order of their timestamps
+	if(reorder_init(&window, REORDER_DELAY_MS) != REORDER_SUCCESS) printf("CANNOT CREATE REORDER WINDOW\n"), exit(EXIT_FAILURE);
+
+	// a gateway that is still running hands its sockets over, otherwise the port is opened
+	tcpsock_t* socket = NULL;
+	int channel = conn_handoff_connect(CONN_HANDOFF_SOCKET);
+	conn_handoff_header_t header;
+	int udp_taken = -1;
+	if(channel != -1){
+		int listen_fd;
+		if(conn_handoff_receive(channel, &listen_fd, &header, sizeof(header)) != CONN_HANDOFF_SUCCESS || header.magic != CONN_HANDOFF_MAGIC
+		   || (header.udp && (conn_handoff_receive(channel, &udp_taken, &header, sizeof(header)) != CONN_HANDOFF_SUCCESS || udp_taken == -1))
+		   || tcp_adopt_passive(&socket, listen_fd) != TCP_NO_ERROR) printf("CANNOT TAKE OVER THE RUNNING GATEWAY\n"), exit(EXIT_FAILURE);
+	}
+	else if(tcp_passive_open(&socket, port_number) != TCP_NO_ERROR) printf("CANNOT CREATE SERVER\n"), exit(EXIT_FAILURE);
 
-	//open tcp socket
-	tcpsock_t* socket;
-	if(tcp_passive_open(&socket, port_number) != TCP_NO_ERROR) printf("CANNOT CREATE SERVER\n"), exit(EXIT_FAILURE);
+	// open file, after a takeover the readings of the old gateway are kept
+	FILE* fp_sensor_data_text = fopen("sensor_data_recv", (channel != -1) ? "a" : "w");
 	// get the socket descriptor
-	pollfd_t pollfd;
-	if(tcp_get_sd(socket, &(pollfd.fd)) != TCP_NO_ERROR) printf("SOCKET NOT BOUND\n"), exit(EXIT_FAILURE);
-
-	// start server
-	poll_info_t poll_server = {
-		.last_modified = time(NULL), // last event in server
-		.socket_id = socket,
-		.file_d = pollfd,
-	};
+	int server_fd;
+	if(tcp_get_sd(socket, &server_fd) != TCP_NO_ERROR) printf("SOCKET NOT BOUND\n"), exit(EXIT_FAILURE);
+	// accepting never blocks the loop, pending connections are taken in batches
+	if(tcp_set_nonblocking(socket, 1) != TCP_NO_ERROR) printf("SOCKET NOT NONBLOCKING\n"), exit(EXIT_FAILURE);
+
+	// start server, the first slot of an empty table is SERVER_SLOT; only listen to incoming
+	conn_t* poll_server = conn_table_add(connections, server_fd, POLLIN, socket);
+	poll_server->last_active = now; // last event in server
+	poll_server->timeout = default_timeout;
+
+	// the connmgr stops when no sensor is connected for 'timeout' ms
+	timer_wheel_schedule(wheel, &(poll_server->idle_timer), now + poll_server->timeout);
+
+	// the UDP socket of the old gateway is kept even without a UDP port, it still gets the datagrams of its sensors
+	if(udp_taken != -1 || udp_port > 0){
+		if(connmgr_udp_open(udp_taken) != 0) printf("CANNOT CREATE UDP SERVER\n"), exit(EXIT_FAILURE);
+		log_message(LOG_LEVEL_INFO, "ConnMgr/Thread-1", "RECEIVING UDP DATAGRAMS");
+	}
 
-	// only listen to incoming 
-	poll_server.file_d.events = POLLIN;
+	// io_uring if the kernel supports it, poll otherwise
+	if(backend != CONNMGR_BACKEND_POLL){
+		if(conn_uring_init(&ring) == CONN_URING_SUCCESS && conn_uring_accept(ring, server_fd) == CONN_URING_SUCCESS
+		   && (udp_fd == -1 || conn_uring_poll(ring, udp_fd) == CONN_URING_SUCCESS))
+			log_message(LOG_LEVEL_INFO, "ConnMgr/Thread-1", "USING IO_URING");
+		else{
+			conn_uring_free(&ring);
+			log_message(backend == CONNMGR_BACKEND_URING ? LOG_WARNING : LOG_LEVEL_INFO, "ConnMgr/Thread-1", "IO_URING NOT AVAILABLE, USING POLL");
+		}
+	}
 
-	// add the poll_server as the first index 
-	dpl_connections = dpl_insert_at_index(dpl_connections, &poll_server, 0, true);
+	if(channel != -1){
+		connmgr_take_over(channel, header.count, now);
+		close(channel);
+	}
+	// the readers start from the state the old gateway left behind
+	pthread_mutex_lock(&started_mutex);
+	started = true;
+	took_over = (channel != -1);
+	pthread_cond_broadcast(&started_cond);
+	pthread_mutex_unlock(&started_mutex);
+	// the next gateway takes the sockets over from here
+	handoff_listener = conn_handoff_listen(CONN_HANDOFF_SOCKET);
+	if(handoff_listener == -1) log_message(LOG_WARNING, "ConnMgr/Thread-1", "NO %s, AN UPGRADE RECONNECTS EVERY SENSOR", CONN_HANDOFF_SOCKET);
+	local_listener = local_ring_listen(LOCAL_RING_SOCKET);
+	if(local_listener == -1) log_message(LOG_WARNING, "ConnMgr/Thread-1", "NO %s, LOCAL PRODUCERS CAN NOT REGISTER", LOCAL_RING_SOCKET);
+	uint64_t next_handoff_check = now;
 
-	// get size of list
-	int list_size = dpl_size(dpl_connections);
-	int index = 0;
 	while(*connmgr_working){
-		// iterate through the list and check their polls
-		if(index == list_size) index = 0;
-
-		// get the poll_info_t at the index
-		poll_info_t* poll_at_index = dpl_get_element_at_index(dpl_connections, index);
-
-		// get the values
-		int poll_nr = poll(&(poll_at_index->file_d), 1, TIMEOUT);
-		short poll_events = poll_at_index->file_d.revents;
-		long timeout_ts = time(NULL) - TIMEOUT;
-
-		// in index == 0 we get notified about new connections 
-		if(poll_nr > 0 && poll_events == POLLIN && index == 0)
-			if(connmgr_add_sensor(&poll_at_index, &list_size) != TCP_NO_ERROR) continue;
-
-		// in index > 0 we get notified about new sensor data
-		if(poll_nr > 0 && poll_events == POLLIN && index > 0){
-			// save the data in the sensor_data
-			sensor_data_t sensor_data;
-
-			// add it in the buffer
-			if(connmgr_add_sensor_data(buffer, &(poll_at_index), &sensor_data) != TCP_NO_ERROR){
-				// if error remove the sensor
-				connmgr_remove_sensor(&list_size, index, &poll_at_index, &poll_server);
-				continue;
-			}
+		// wait for all connections at once, the wheel is advanced at least every tick
+		int readings = 0;
+		now = (ring != NULL) ? connmgr_uring_wait(buffer, poll_server, fp_sensor_data_text, &readings)
+		                     : connmgr_poll_wait(buffer, poll_server, fp_sensor_data_text, &readings);
+		// the readings that waited out the reorder window
+		connmgr_release_readings(buffer, fp_sensor_data_text, &readings, false);
 
-			// update the datamgr and db threads
-			connmgr_update_threads();
-
-			// print it in the text file
-			fprintf(fp_sensor_data_text, "ID: %u   VAL: %f   TIME: %ld\n",
-				sensor_data.id, sensor_data.value, sensor_data.ts);
-#ifdef DEBUG
-			printf(PURPLE_CLR "CONNMGR: ID: %u   VAL: %f   TIME: %ld\n"OFF_CLR,
-				sensor_data.id, sensor_data.value, sensor_data.ts);
-#endif
-		}
+		// update the datamgr and db threads once for all readings of this iteration
+		if(readings > 0) connmgr_update_threads(readings);
 
 		// REMOVE THE SENSOR IF:
-		// not sent data in TIMEOUT seconds || a POLLHUP signal
-		if((poll_at_index->last_modified < timeout_ts && index > 0) || poll_events == POLLHUP)
-			connmgr_remove_sensor(&list_size, index, &poll_at_index, &poll_server);
-
+		// not sent data in its timeout
+		timer_wheel_advance(wheel, now, connmgr_idle_expired, &now);
+		connmgr_remove_closing(poll_server, now);
+
+		// local producers register and a new gateway asks for the sockets, checked once per tick
+		if(now >= next_handoff_check){
+			next_handoff_check = now + TIMER_WHEEL_TICK;
+			if(local_listener != -1) connmgr_add_local(now);
+			int successor = (handoff_listener != -1) ? conn_handoff_accept(handoff_listener) : -1;
+			if(successor != -1){
+				connmgr_hand_over(successor, buffer, poll_server, fp_sensor_data_text);
+				close(successor);
+			}
+		}
 
 		// STOP THE CONNMGR IF:
-		// no sensors in the list && TIMEOUT seconds have passed
-		if(list_size == 1 && poll_server.last_modified < timeout_ts){
-			connmgr_close_connection(port_number, &poll_at_index, &poll_server, fp_sensor_data_text);
+		// no sensors in the list && the server timeout has passed, or a stop was requested, or the sockets were handed over
+		if(stop_requested && !handed_off)
+			log_message(LOG_LEVEL_INFO, "ConnMgr/Thread-1", "STOP REQUESTED, CLOSING %d SENSORS", connections->count - first_sensor);
+		if(connmgr_idle || stop_requested || handed_off){
+			// nothing that was received stays in the reorder window
+			readings = 0;
+			connmgr_release_readings(buffer, fp_sensor_data_text, &readings, true);
+			if(readings > 0) connmgr_update_threads(readings);
+			connmgr_close_connection(port_number, fp_sensor_data_text);
 			break;
 		}
-
-		index++;
 	}
 #ifdef DEBUG
 	printf(PURPLE_CLR "CLOSING CONNMGR.\n" OFF_CLR);
 #endif
 }
 
+uint64_t connmgr_poll_wait(sbuffer_t** buffer, conn_t* poll_server, FILE* fp_sensor_data_text, int* readings){
+	int poll_nr = poll(connections->pollfds, connections->high, connmgr_wait_timeout());
+	uint64_t now = timer_wheel_clock();
+	connmgr_local_resume(buffer, now, fp_sensor_data_text, readings);
+
+	// in slot > 0 we get notified about new sensor data, free slots (fd -1) never have events
+	for(int slot = SERVER_SLOT + 1; slot < connections->high && poll_nr > 0; slot++){
+		short poll_events = connections->pollfds[slot].revents;
+		if(poll_events == 0) continue;
+		poll_nr--;
+
+		// poll keeps reporting the UDP socket until it is drained
+		if(slot < first_sensor){
+			connmgr_udp_drain(buffer, poll_server, now, fp_sensor_data_text, readings);
+			continue;
+		}
+
+		conn_t* poll_at_index = conn_table_get(connections, slot);
+		// a local producer sent its registration, rang the doorbell or left, the readings in its ring are taken either way
+		if(poll_at_index->local != NULL){
+			if(!local_ring_registered(poll_at_index->local)){
+				connmgr_local_hello(poll_at_index, now);
+				continue;
+			}
+			bool gone = (local_ring_doorbells(poll_at_index->local) != LOCAL_RING_SUCCESS);
+			connmgr_local_drain(buffer, poll_at_index, now, fp_sensor_data_text, readings);
+			if(gone) connmgr_mark_closing(poll_at_index);
+			continue;
+		}
+		if(poll_events & POLLIN){
+			// add the complete readings in the buffer, if error remove the sensor
+			if(connmgr_add_sensor_data(buffer, &(poll_at_index), now, fp_sensor_data_text, readings) != TCP_NO_ERROR)
+				connmgr_mark_closing(poll_at_index);
+		}
+		// a POLLHUP signal
+		else if(poll_events & (POLLHUP | POLLERR)) connmgr_mark_closing(poll_at_index);
+	}
+
+	// in slot 0 we get notified about new connections, a new sensor is only polled from the next iteration on
+	if(connections->pollfds[SERVER_SLOT].revents & POLLIN)
+		connmgr_add_sensor(poll_server, now);
+	return now;
+}
+
+uint64_t connmgr_uring_wait(sbuffer_t** buffer, conn_t* poll_server, FILE* fp_sensor_data_text, int* readings){
+	if(conn_uring_wait(ring, connmgr_wait_timeout()) != CONN_URING_SUCCESS)
+		log_message(LOG_ERROR, "ConnMgr/Thread-1", "IO_URING WAIT FAILED");
+	uint64_t now = timer_wheel_clock();
+	if(udp_backlog && !handing_off) connmgr_udp_drain(buffer, poll_server, now, fp_sensor_data_text, readings);
+	if(!handing_off) connmgr_local_resume(buffer, now, fp_sensor_data_text, readings);
+
+	// the accept and the receives stay armed, a request only has to be queued again when IORING_CQE_F_MORE is not set
+	conn_uring_event_t event;
+	while(conn_uring_next(ring, &event)){
+		if(event.user_data == CONN_URING_IGNORE) continue;
+
+		if(event.user_data == CONN_URING_ACCEPT){
+			tcpsock_t* new_socket;
+			if(event.res >= 0){
+				if(tcp_adopt(&new_socket, event.res) != TCP_NO_ERROR) close(event.res);
+				else{
+					// while handing off the data stays in the socket for the new gateway
+					conn_t* insert_sensor = connmgr_open_sensor(new_socket, now);
+					if(insert_sensor != NULL && !handing_off && conn_uring_recv(ring, event.res, conn_table_handle(connections, insert_sensor->slot)) != CONN_URING_SUCCESS)
+						connmgr_mark_closing(insert_sensor);
+				}
+				poll_server->last_active = now;
+			}
+			if(!event.more){
+				if(handing_off) handoff_armed--;
+				else conn_uring_accept(ring, connections->pollfds[SERVER_SLOT].fd);
+			}
+			continue;
+		}
+
+		// the UDP socket has data, while handing off the datagrams stay in the socket for the new gateway
+		if(event.user_data == CONN_URING_POLL){
+			if(event.res > 0 && !handing_off) connmgr_udp_drain(buffer, poll_server, now, fp_sensor_data_text, readings);
+			if(!event.more){
+				if(handing_off) handoff_armed--;
+				else conn_uring_poll(ring, udp_fd);
+			}
+			continue;
+		}
+
+		// a receive, the connection can be gone already: then the handle is stale
+		conn_t* poll_at_index = conn_table_lookup(connections, event.user_data);
+		if(poll_at_index == NULL){
+			conn_uring_release(ring, &event);
+			continue;
+		}
+		// the single poll of a local producer that did not register yet, a cancelled one only ends while handing off
+		if(poll_at_index->local != NULL && !local_ring_registered(poll_at_index->local)){
+			if(handing_off) handoff_armed--;
+			else if(event.res != -ECANCELED) connmgr_local_hello(poll_at_index, now);
+			continue;
+		}
+		if(event.res > 0){
+			// the data of a local producer is its doorbell, the readings are in its ring
+			if(poll_at_index->local != NULL) connmgr_local_drain(buffer, poll_at_index, now, fp_sensor_data_text, readings);
+			else{
+				// the idle timer is not touched, it checks last_active when it fires
+				poll_at_index->last_active = now;
+				connmgr_add_bytes(buffer, poll_at_index, conn_uring_buffer(ring, &event), event.res, fp_sensor_data_text, readings);
+			}
+			conn_uring_release(ring, &event);
+			if(!event.more){
+				if(handing_off) handoff_armed--;
+				else conn_uring_recv(ring, connections->pollfds[poll_at_index->slot].fd, event.user_data);
+			}
+		}
+		// out of buffers: the receive stopped, it continues when the buffers of this iteration are given back
+		else if(event.res == -ENOBUFS){
+			if(handing_off) handoff_armed--;
+			else conn_uring_recv(ring, connections->pollfds[poll_at_index->slot].fd, event.user_data);
+		}
+		// 0 is the end of the stream, a cancelled receive only ends while handing off
+		else{
+			if(handing_off) handoff_armed--;
+			if(!handing_off || event.res != -ECANCELED){
+				if(poll_at_index->local != NULL && !handing_off) connmgr_local_drain(buffer, poll_at_index, now, fp_sensor_data_text, readings);
+				connmgr_mark_closing(poll_at_index);
+			}
+		}
+	}
+	return now;
+}
+
+
+bool connmgr_wait_started(){
+	pthread_mutex_lock(&started_mutex);
+	while(!started) pthread_cond_wait(&started_cond, &started_mutex);
+	bool result = took_over;
+	pthread_mutex_unlock(&started_mutex);
+	return result;
+}
+
+bool connmgr_handed_over(){
+	return atomic_load(&handed_over);
+}
 
 void connmgr_free(){
-	dpl_free(&dpl_connections, true);
+	// closing the ring ends the requests on the sockets
+	conn_uring_free(&ring);
+	// after a handoff the socket file belongs to the new gateway
+	if(handoff_listener != -1){
+		close(handoff_listener);
+		if(!handed_off) unlink(CONN_HANDOFF_SOCKET);
+	}
+	handoff_listener = -1;
+	if(local_listener != -1){
+		close(local_listener);
+		if(!handed_off) unlink(LOCAL_RING_SOCKET);
+	}
+	local_listener = -1;
+	handing_off = handed_off = false;
+	if(connections != NULL){
+		// close the sockets of the server and the remaining sensors
+		for(int slot = 0; slot < connections->high; slot++){
+			if(connections->pollfds[slot].fd < 0) continue;
+			conn_t* poll_at_index = conn_table_get(connections, slot);
+			if(poll_at_index->socket_id != NULL) tcp_close(&(poll_at_index->socket_id));
+			local_ring_close(&(poll_at_index->local));
+		}
+	}
+	connmgr_udp_close();
+	if(window != NULL){
+		reorder_stats_t stats = reorder_get_stats(window);
+		log_message(LOG_LEVEL_INFO, "ConnMgr/Thread-1", "TIMESTAMPS: %" PRIu64 " CORRECTED, %" PRIu64 " REORDERED, %" PRIu64 " LATE",
+		            stats.corrected, stats.reordered, stats.late);
+	}
+	reorder_free(&window);
+	conn_table_free(&connections);
+	timer_wheel_free(&wheel);
+	free(closing);
+	free(local_pending);
+	free(sensor_timeout);
+	closing = NULL;
+	local_pending = NULL;
+	local_pending_size = local_pending_capacity = local_count = 0;
+	sensor_timeout = NULL;
+	closing_size = closing_capacity = 0;
+	connmgr_idle = false;
 }
 
-void connmgr_close_connection(int port_number, poll_info_t** poll_at_index, poll_info_t* poll_server, FILE* fp_sensor_data_text){
+void connmgr_close_connection(int port_number, FILE* fp_sensor_data_text){
 	connmgr_close_threads();
-	
- 
-     if ((*poll_at_index)->socket_id != NULL) {
-        tcp_close(&((*poll_at_index)->socket_id));
-        (*poll_at_index)->socket_id = NULL;
-    }
-    
 
   log_message(LOG_LEVEL_INFO, "ConnMgr/Thread-1", "CLOSED CONNECTION MANAGER : %d", port_number);
-  
-	    if (poll_server->socket_id != NULL) {
-        tcp_close(&(poll_server->socket_id));
-        poll_server->socket_id = NULL;
-    }
+
+	// the sockets of the server and the remaining sensors are closed by connmgr_free
 	fclose(fp_sensor_data_text);
 	connmgr_free();
 }
 
 
-void connmgr_remove_sensor(int* list_size, int index, poll_info_t** poll_at_index, poll_info_t* poll_server){
+void connmgr_remove_sensor(conn_t* poll_at_index, conn_t* poll_server, uint64_t now){
 #ifdef DEBUG
-	printf(PURPLE_CLR "CLOSED CONNECTION SENSOR ID: %d\n"OFF_CLR, (*poll_at_index)->sensor_id);
+	printf(PURPLE_CLR "CLOSED CONNECTION SENSOR ID: %d\n"OFF_CLR, poll_at_index->sensor_id);
 #endif
 	// remove the sensor
-	
- 
- log_message(LOG_LEVEL_INFO, "ConnMgr/Thread-1", "CLOSED CONNECTION SENSOR ID: %d", (*poll_at_index)->sensor_id);
- 
-	    if (poll_server->socket_id != NULL) {
-        tcp_close(&(poll_server->socket_id));
-        poll_server->socket_id = NULL;
-    }
-	dpl_connections = dpl_remove_at_index(dpl_connections, index, true);
-	(*list_size)--; // decrement the list size
-
-	// update the last modified time of the poll_server
-	poll_server->last_modified = time(NULL);
-}
-int connmgr_add_sensor(poll_info_t** poll_at_index, int* list_size){
-	tcpsock_t* new_socket;
-	if(tcp_wait_for_connection((*poll_at_index)->socket_id, &new_socket) != TCP_NO_ERROR){
+
+
+ log_message(LOG_LEVEL_INFO, "ConnMgr/Thread-1", "CLOSED CONNECTION SENSOR ID: %d", poll_at_index->sensor_id);
+
+	timer_wheel_cancel(&(poll_at_index->idle_timer));
+	// the receive holds on to the socket until it is cancelled
+	if(ring != NULL) conn_uring_cancel(ring, conn_table_handle(connections, poll_at_index->slot));
+	if(poll_at_index->socket_id != NULL) tcp_close(&(poll_at_index->socket_id));
+	if(poll_at_index->local != NULL){
+		local_ring_close(&(poll_at_index->local));
+		local_count--;
+	}
+	conn_table_remove(connections, poll_at_index->slot);
+
+	// update the last event of the poll_server, the connmgr stops 'timeout' ms after the last sensor left
+	poll_server->last_active = now;
+	if(connections->count == first_sensor)
+		timer_wheel_schedule(wheel, &(poll_server->idle_timer), now + poll_server->timeout);
+}
+
+void connmgr_remove_closing(conn_t* poll_server, uint64_t now){
+	for(int index = 0; index < closing_size; index++){
+		conn_t* poll_at_index = conn_table_lookup(connections, closing[index]);
+		if(poll_at_index != NULL) connmgr_remove_sensor(poll_at_index, poll_server, now);
+	}
+	closing_size = 0;
+}
+
+void connmgr_take_over(int channel, uint32_t count, uint64_t now){
+	// the sockets are only read once the old gateway let go of them, both gateways reading would split the readings
+	for(uint32_t i = 0; i < count; i++){
+		conn_handoff_state_t state;
+		int fd;
+		if(conn_handoff_receive(channel, &fd, &state, sizeof(state)) != CONN_HANDOFF_SUCCESS || fd == -1)
+			printf("CANNOT TAKE OVER THE RUNNING GATEWAY\n"), exit(EXIT_FAILURE);
+
+		// the sensor can have left in the meantime
+		tcpsock_t* socket;
+		if(tcp_adopt(&socket, fd) != TCP_NO_ERROR){
+			close(fd);
+			continue;
+		}
+		conn_t* insert_sensor = connmgr_open_sensor(socket, now);
+		if(insert_sensor == NULL) continue;
+		insert_sensor->sensor_id = state.sensor_id;
+		insert_sensor->frame_len = (state.frame_len < CONN_FRAME_SIZE) ? state.frame_len : 0;
+		memcpy(insert_sensor->frame, state.frame, insert_sensor->frame_len);
+		insert_sensor->timeout = state.timeout;
+		insert_sensor->last_active = now - ((state.idle < state.timeout) ? state.idle : state.timeout);
+		timer_wheel_schedule(wheel, &(insert_sensor->idle_timer), insert_sensor->last_active + insert_sensor->timeout);
+	}
+
+	uint8_t ack = 1;
+	if(conn_handoff_send(channel, -1, &ack, sizeof(ack)) != CONN_HANDOFF_SUCCESS)
+		printf("CANNOT TAKE OVER THE RUNNING GATEWAY\n"), exit(EXIT_FAILURE);
+	for(int slot = first_sensor; ring != NULL && slot < connections->high; slot++){
+		if(connections->pollfds[slot].fd < 0) continue;
+		if(conn_uring_recv(ring, connections->pollfds[slot].fd, conn_table_handle(connections, slot)) != CONN_URING_SUCCESS)
+			connmgr_mark_closing(conn_table_get(connections, slot));
+	}
+	log_message(LOG_LEVEL_INFO, "ConnMgr/Thread-1", "TOOK OVER %d SENSORS FROM THE RUNNING GATEWAY", connections->count - first_sensor);
+}
+
+void connmgr_hand_over(int channel, sbuffer_t** buffer, conn_t* poll_server, FILE* fp_sensor_data_text){
+	// a connection that is closing has no request left in the ring, e.g. a local producer refused in this tick
+	uint64_t now = timer_wheel_clock();
+	connmgr_remove_closing(poll_server, now);
+	// the ring stops reading the sockets, the last completions can still carry readings
+	if(ring != NULL) connmgr_uring_quiesce(buffer, poll_server, fp_sensor_data_text);
+	now = timer_wheel_clock();
+	connmgr_remove_closing(poll_server, now);
+	// the new gateway starts with an empty reorder window, what waits here is published first
+	int readings = 0;
+	connmgr_release_readings(buffer, fp_sensor_data_text, &readings, true);
+	if(readings > 0) connmgr_update_threads(readings);
+	// the new gateway restores the datamgr from the snapshot once it has the sockets, no reading may be missing in it
+	if(datamgr_handoff_checkpoint(CONNMGR_HANDOFF_DRAIN_MS) != 0)
+		log_message(LOG_WARNING, "ConnMgr/Thread-1", "NO SNAPSHOT FOR THE NEW GATEWAY, IT STARTS FROM AN OLDER ONE");
+	// the new gateway appends to the same file
+	fflush(fp_sensor_data_text);
+
+	conn_handoff_header_t header = {.magic = CONN_HANDOFF_MAGIC, .count = connections->count - first_sensor - local_count, .udp = (udp_fd != -1)};
+	bool sent = (conn_handoff_send(channel, connections->pollfds[SERVER_SLOT].fd, &header, sizeof(header)) == CONN_HANDOFF_SUCCESS);
+	if(sent && udp_fd != -1) sent = (conn_handoff_send(channel, udp_fd, &header, sizeof(header)) == CONN_HANDOFF_SUCCESS);
+	for(int slot = first_sensor; sent && slot < connections->high; slot++){
+		if(connections->pollfds[slot].fd < 0) continue;
+		conn_t* poll_at_index = conn_table_get(connections, slot);
+		if(poll_at_index->local != NULL) continue;
+		conn_handoff_state_t state = {.sensor_id = poll_at_index->sensor_id, .frame_len = poll_at_index->frame_len,
+		                              .timeout = poll_at_index->timeout, .idle = now - poll_at_index->last_active};
+		memcpy(state.frame, poll_at_index->frame, poll_at_index->frame_len);
+		sent = (conn_handoff_send(channel, connections->pollfds[slot].fd, &state, sizeof(state)) == CONN_HANDOFF_SUCCESS);
+	}
+
+	uint8_t ack;
+	int fd;
+	if(!sent || conn_handoff_receive(channel, &fd, &ack, sizeof(ack)) != CONN_HANDOFF_SUCCESS){
+		log_message(LOG_ERROR, "ConnMgr/Thread-1", "HANDOFF FAILED, THE SENSORS STAY CONNECTED HERE");
+		if(ring != NULL) connmgr_uring_rearm();
+		return;
+	}
+
+	// the new gateway owns the sockets now: they are closed here without ending the connections
+	// the UDP socket is closed by connmgr_free, a datagram is never split between the gateways
+	int count = connections->count - first_sensor - local_count;
+	int local = local_count;
+	for(int slot = SERVER_SLOT; slot < connections->high; slot++){
+		if(connections->pollfds[slot].fd < 0) continue;
+		conn_t* poll_at_index = conn_table_get(connections, slot);
+		int sd;
+		if(poll_at_index->socket_id != NULL && tcp_detach(&(poll_at_index->socket_id), &sd) == TCP_NO_ERROR) close(sd);
+		// a local producer registers its ring with the new gateway when its connection ends, the ring keeps its readings
+		if(poll_at_index->local != NULL){
+			local_ring_close(&(poll_at_index->local));
+			local_count--;
+		}
+		if(slot < first_sensor) continue;
+		timer_wheel_cancel(&(poll_at_index->idle_timer));
+		conn_table_remove(connections, slot);
+	}
+	handed_off = true;
+	atomic_store(&handed_over, true);
+	log_message(LOG_LEVEL_INFO, "ConnMgr/Thread-1", "HANDED %d SENSORS OVER TO THE NEW GATEWAY, %d LOCAL PRODUCERS REGISTER AGAIN", count, local);
+}
+
+void connmgr_uring_quiesce(sbuffer_t** buffer, conn_t* poll_server, FILE* fp_sensor_data_text){
+	// the accept, the poll of the UDP socket and one receive per sensor end with a completion without IORING_CQE_F_MORE
+	handing_off = true;
+	handoff_armed = connections->count;
+	for(int slot = SERVER_SLOT; slot < connections->high; slot++){
+		if(connections->pollfds[slot].fd < 0) continue;
+		uint64_t user_data = (slot == SERVER_SLOT) ? CONN_URING_ACCEPT : (slot < first_sensor) ? CONN_URING_POLL : conn_table_handle(connections, slot);
+		// a full submission queue is submitted first
+		if(conn_uring_cancel(ring, user_data) != CONN_URING_SUCCESS){
+			conn_uring_wait(ring, 0);
+			conn_uring_cancel(ring, user_data);
+		}
+	}
+	for(int tick = 0; handoff_armed > 0 && tick < CONNMGR_HANDOFF_TICKS; tick++){
+		int readings = 0;
+		connmgr_uring_wait(buffer, poll_server, fp_sensor_data_text, &readings);
+		if(readings > 0) connmgr_update_threads(readings);
+	}
+}
+
+void connmgr_uring_rearm(){
+	handing_off = false;
+	conn_uring_accept(ring, connections->pollfds[SERVER_SLOT].fd);
+	if(udp_fd != -1) conn_uring_poll(ring, udp_fd);
+	for(int slot = first_sensor; slot < connections->high; slot++){
+		if(connections->pollfds[slot].fd < 0) continue;
+		conn_t* poll_at_index = conn_table_get(connections, slot);
+		conn_handle_t handle = conn_table_handle(connections, slot);
+		int result = (poll_at_index->local != NULL && !local_ring_registered(poll_at_index->local))
+		             ? conn_uring_poll_once(ring, connections->pollfds[slot].fd, handle)
+		             : conn_uring_recv(ring, connections->pollfds[slot].fd, handle);
+		if(result != CONN_URING_SUCCESS) connmgr_mark_closing(poll_at_index);
+	}
+}
+
+void connmgr_mark_closing(conn_t* poll_at_index){
+	// without room the connection is closed by its idle timer instead
+	if(connmgr_add_handle(&closing, &closing_size, &closing_capacity, conn_table_handle(connections, poll_at_index->slot)) != 0)
+		log_message(LOG_ERROR, "ConnMgr/Thread-1", "CANNOT CLOSE SENSOR ID: %d NOW", poll_at_index->sensor_id);
+}
+
+void connmgr_mark_pending(conn_t* poll_at_index){
+	// without room the readings are taken at the next doorbell
+	if(connmgr_add_handle(&local_pending, &local_pending_size, &local_pending_capacity, conn_table_handle(connections, poll_at_index->slot)) != 0)
+		log_message(LOG_ERROR, "ConnMgr/Thread-1", "CANNOT RESUME LOCAL SENSOR ID: %d NOW", poll_at_index->sensor_id);
+}
+
+int connmgr_add_handle(conn_handle_t** list, int* size, int* capacity, conn_handle_t handle){
+	if(*size == *capacity){
+		int grown = (*capacity == 0) ? 64 : *capacity * 2;
+		conn_handle_t* resized = realloc(*list, grown * sizeof(conn_handle_t));
+		if(resized == NULL) return -1;
+		*list = resized;
+		*capacity = grown;
+	}
+	(*list)[(*size)++] = handle;
+	return 0;
+}
+
+int connmgr_add_sensor(conn_t* poll_server, uint64_t now){
+	tcpsock_t* new_sockets[CONNMGR_ACCEPT_BATCH];
+	int count;
+	int result = tcp_accept_nonblock(poll_server->socket_id, new_sockets, CONNMGR_ACCEPT_BATCH, &count);
+	if(result != TCP_NO_ERROR){
 #ifdef DEBUG
-		printf(PURPLE_CLR "ERROR WAITING TCP CONNECTION.\n" OFF_CLR);
+		if(result != TCP_WOULD_BLOCK) printf(PURPLE_CLR "ERROR WAITING TCP CONNECTION.\n" OFF_CLR);
 #endif
-		return TCP_CONNECTION_CLOSED;
+		return result;
 	}
 
-	pollfd_t new_fd;
-	if(tcp_get_sd(new_socket, &(new_fd.fd)) != TCP_NO_ERROR){
+	for(int i = 0; i < count; i++) connmgr_open_sensor(new_sockets[i], now);
+	poll_server->last_active = now;
+	return TCP_NO_ERROR;
+}
+
+conn_t* connmgr_open_sensor(tcpsock_t* socket, uint64_t now){
+	int new_fd;
+	if(tcp_get_sd(socket, &new_fd) != TCP_NO_ERROR){
 #ifdef DEBUG
 		printf(PURPLE_CLR "ERROR GETTING TCP SD.\n" OFF_CLR);
 #endif
-		return TCP_SOCKET_ERROR;
+		tcp_close(&socket);
+		return NULL;
+	}
+
+	// initialise the sensor, also listen if the sensor quits
+	conn_t* insert_sensor = conn_table_add(connections, new_fd, POLLIN | POLLHUP, socket);
+	if(insert_sensor == NULL){
+		log_message(LOG_ERROR, "ConnMgr/Thread-1", "CONNECTION TABLE FULL, CONNECTION REFUSED");
+		tcp_close(&socket);
+		return NULL;
 	}
 
-	// initialise the sensor
-	poll_info_t insert_sensor = {
-		.last_modified = time(NULL),
-		.socket_id = new_socket,
-		.file_d = new_fd
-	};
+	// it gets the default timeout until its id is known
+	insert_sensor->last_active = now;
+	insert_sensor->timeout = default_timeout;
+	timer_wheel_schedule(wheel, &(insert_sensor->idle_timer), now + insert_sensor->timeout);
+	return insert_sensor;
+}
 
-	//also listen if the sensor quits
-	insert_sensor.file_d.events = POLLIN | POLLHUP;
+void connmgr_idle_expired(timer_entry_t* timer, void* arg){
+	conn_t* poll_info = (conn_t*) ((char*) timer - offsetof(conn_t, idle_timer));
+	uint64_t now = *(uint64_t*) arg;
 
-	// insert the sensor in the list
-	dpl_connections = dpl_insert_at_index(dpl_connections, &insert_sensor, dpl_size(dpl_connections), true);
-	(*list_size)++; //update list_size
-	return TCP_NO_ERROR;
+	// the server only times out when there are no sensors, removing the last sensor schedules it again
+	bool server = (poll_info->slot == SERVER_SLOT);
+	if(server && connections->count > first_sensor) return;
+
+	// data arrived after the timer was set: move the timer to the new deadline
+	if(now - poll_info->last_active < poll_info->timeout){
+		timer_wheel_schedule(wheel, timer, poll_info->last_active + poll_info->timeout);
+		return;
+	}
+
+	if(server) connmgr_idle = true;
+	else{
+		log_message(LOG_LEVEL_INFO, "ConnMgr/Thread-1", "SENSOR ID: %d IDLE FOR %" PRIu64 " MS", poll_info->sensor_id, now - poll_info->last_active);
+		connmgr_mark_closing(poll_info);
+	}
+}
+
+void connmgr_load_timeouts(FILE* fp_timeouts){
+	if(fp_timeouts == NULL) return;
+	sensor_timeout = calloc(65536, sizeof(uint32_t));
+	if(sensor_timeout == NULL) return;
+
+	// every line holds '<sensor id> <timeout in seconds>'
+	char line[64];
+	int line_nr = 0, count = 0;
+	while(fgets(line, sizeof(line), fp_timeouts) != NULL){
+		line_nr++;
+		unsigned int id;
+		int seconds;
+		char* start = line + strspn(line, " \t");
+		if(*start == '#' || *start == '\n' || *start == '\0') continue;
+		if(sscanf(start, "%u %d", &id, &seconds) != 2 || id > UINT16_MAX || seconds <= 0){
+			log_message(LOG_WARNING, "ConnMgr/Thread-1", "%s:%d: invalid timeout skipped\n", TIMEOUT_MAP_FILE, line_nr);
+			continue;
+		}
+		sensor_timeout[id] = (uint32_t) seconds;
+		count++;
+	}
+	log_message(LOG_LEVEL_INFO, "ConnMgr/Thread-1", "LOADED %d SENSOR TIMEOUTS, DEFAULT %" PRIu64 " MS", count, default_timeout);
 }
 
-int connmgr_add_sensor_data(sbuffer_t** buffer, poll_info_t** poll_at_index, sensor_data_t* sensor_data){
+int connmgr_add_sensor_data(sbuffer_t** buffer, conn_t** poll_at_index, uint64_t now, FILE* fp_sensor_data_text, int* readings){
+	conn_t* conn = *poll_at_index;
+	uint8_t data[CONNMGR_READ_SIZE];
+	int result = TCP_NO_ERROR;
 
-	// get the buf_size
-	int sit = (int) sizeof(sensor_id_t);
-	int sdt = (int) sizeof(sensor_value_t);
-	int stt = (int) sizeof(sensor_ts_t);
+	// a few reads per iteration at most, so one busy sensor can not starve the others
+	for(int reads = 0; reads < CONNMGR_READ_BUDGET; reads++){
+		int size = CONNMGR_READ_SIZE;
+		result = tcp_receive_some(conn->socket_id, data, &size);
+		if(result != TCP_NO_ERROR) break;
 
-	//receive the data
-	if(tcp_receive((*poll_at_index)->socket_id, &(sensor_data->id), &sit) != TCP_NO_ERROR){
 #ifdef DEBUG
-		printf(PURPLE_CLR "ERROR RECEIVING TCP DATA.\n" OFF_CLR);
+		printf(PURPLE_CLR "CONNMGR: NEW DATA RECEIVED.\n" OFF_CLR);
 #endif
-		return TCP_SOCKET_ERROR;
+		// the idle timer is not touched, it checks last_active when it fires
+		conn->last_active = now;
+		connmgr_add_bytes(buffer, conn, data, size, fp_sensor_data_text, readings);
+
+		// a short read means the socket is drained
+		if(size < CONNMGR_READ_SIZE) break;
 	}
-	tcp_receive((*poll_at_index)->socket_id, &(sensor_data->value), &sdt);
-	tcp_receive((*poll_at_index)->socket_id, &(sensor_data->ts), &stt);
 
-#ifdef DEBUG
-	printf(PURPLE_CLR "CONNMGR: NEW DATA RECEIVED.\n" OFF_CLR);
-#endif
+	// nothing more to read is not an error, poll tells when the rest arrives
+	return (result == TCP_WOULD_BLOCK) ? TCP_NO_ERROR : result;
+}
+
+void connmgr_add_bytes(sbuffer_t** buffer, conn_t* poll_at_index, const uint8_t* data, int size, FILE* fp_sensor_data_text, int* readings){
+	// a reading can arrive in pieces, the start that came with the previous bytes is completed first
+	if(poll_at_index->frame_len > 0){
+		int missing = CONN_FRAME_SIZE - poll_at_index->frame_len;
+		int copied = size < missing ? size : missing;
+		memcpy(poll_at_index->frame + poll_at_index->frame_len, data, copied);
+		poll_at_index->frame_len += copied;
+		data += copied;
+		size -= copied;
+		if(poll_at_index->frame_len < CONN_FRAME_SIZE) return;
+		poll_at_index->frame_len = 0;
+		connmgr_add_bytes(buffer, poll_at_index, poll_at_index->frame, CONN_FRAME_SIZE, fp_sensor_data_text, readings);
+	}
+
+	// send order of a node: <sensor_id><temperature><timestamp>, no padding
+	for(; size >= (int) CONN_FRAME_SIZE; data += CONN_FRAME_SIZE, size -= CONN_FRAME_SIZE){
+		sensor_data_t* sensor_data = connmgr_decode_reading(buffer, data);
+		if(sensor_data == NULL) continue;
+		connmgr_store_reading(buffer, poll_at_index, sensor_data, fp_sensor_data_text, readings);
+	}
+	memcpy(poll_at_index->frame, data, size);
+	poll_at_index->frame_len = (uint8_t) size;
+}
+
+void connmgr_store_reading(sbuffer_t** buffer, conn_t* poll_at_index, sensor_data_t* sensor_data, FILE* fp_sensor_data_text, int* readings){
 	// update the ID and log event if this is the first data from this sensor
-	if((*poll_at_index)->sensor_id != sensor_data->id){
+	if(poll_at_index->sensor_id != sensor_data->id){
 
 		// update the sensor ID and log the event
-		(*poll_at_index)->sensor_id = sensor_data->id;
+		poll_at_index->sensor_id = sensor_data->id;
    //write log 
-   log_message(LOG_LEVEL_INFO, "ConnMgr/Thread-1", "NEW CONNECTION SENSOR ID: %d", (*poll_at_index)->sensor_id);
+   log_message(LOG_LEVEL_INFO, "ConnMgr/Thread-1", "NEW CONNECTION SENSOR ID: %d", poll_at_index->sensor_id);
+
+		// a sensor can have its own idle timeout, the timer moves to the new deadline
+		if(sensor_timeout != NULL && sensor_timeout[sensor_data->id] != 0){
+			poll_at_index->timeout = (uint64_t) sensor_timeout[sensor_data->id] * 1000;
+			timer_wheel_schedule(wheel, &(poll_at_index->idle_timer), poll_at_index->last_active + poll_at_index->timeout);
+		}
    
    
 #ifdef DEBUG
-		printf(PURPLE_CLR "NEW CONNECTION SENSOR ID: %d\n"OFF_CLR, (*poll_at_index)->sensor_id);
+		printf(PURPLE_CLR "NEW CONNECTION SENSOR ID: %d\n"OFF_CLR, poll_at_index->sensor_id);
 #endif
 	}
+	connmgr_ingest_reading(buffer, sensor_data, fp_sensor_data_text, readings);
+}
+
+sensor_data_t* connmgr_decode_reading(sbuffer_t** buffer, const uint8_t* data){
+	// the reading is decoded straight into its slot in the buffer
+	sensor_data_t* sensor_data = sbuffer_reserve(*buffer);
+	if(sensor_data == NULL){
+		printf("CONNMGR: SBUFFER ERROR\n");
+		return NULL;
+	}
+	memcpy(&(sensor_data->id), data, sizeof(sensor_id_t));
+	memcpy(&(sensor_data->value), data + sizeof(sensor_id_t), sizeof(sensor_value_t));
+	memcpy(&(sensor_data->ts), data + sizeof(sensor_id_t) + sizeof(sensor_value_t), sizeof(sensor_ts_t));
+	// the wire carries whole seconds, the reorder window derives the time from ts
+	sensor_data->time = 0;
+	return sensor_data;
+}
+
+void connmgr_ingest_reading(sbuffer_t** buffer, sensor_data_t* sensor_data, FILE* fp_sensor_data_text, int* readings){
+	// the timestamp is checked and the reading waits for the ones of its sensor that are still on the way
+	// 'sensor_data' is a reserved slot of the buffer, it waits in the window as it is and is committed when it is released
+	connmgr_sink_t sink = {buffer, fp_sensor_data_text, readings};
+	reorder_add(window, sensor_data, connmgr_release_reading, &sink);
+}
+
+void connmgr_release_reading(sensor_data_t* sensor_data, void* arg){
+	connmgr_sink_t* sink = arg;
+	connmgr_publish_reading(sink->buffer, sensor_data, sink->fp_sensor_data_text);
+	(*(sink->readings))++;
+}
+
+void connmgr_release_readings(sbuffer_t** buffer, FILE* fp_sensor_data_text, int* readings, bool all){
+	connmgr_sink_t sink = {buffer, fp_sensor_data_text, readings};
+	if(all) reorder_flush(window, connmgr_release_reading, &sink);
+	else reorder_release(window, connmgr_release_reading, &sink);
+}
 
-	//update the poll_at_index time
-	(*poll_at_index)->last_modified = sensor_data->ts;
+int connmgr_wait_timeout(){
+	// what is left of a drain is taken at once, a reading in the reorder window wakes the connmgr when it is due
+	if(udp_backlog || local_pending_size > 0) return 0;
+	int next = reorder_next_ms(window);
+	return (next >= 0 && next < TIMER_WHEEL_TICK) ? next : TIMER_WHEEL_TICK;
+}
+
+void connmgr_publish_reading(sbuffer_t** buffer, sensor_data_t* sensor_data, FILE* fp_sensor_data_text){
+	// print it in the text file, before the readers can free it
+	fprintf(fp_sensor_data_text, "ID: %u   VAL: %f   TIME: %ld\n",
+		sensor_data->id, sensor_data->value, sensor_data->ts);
+#ifdef DEBUG
+	printf(PURPLE_CLR "CONNMGR: ID: %u   VAL: %f   TIME: %ld\n"OFF_CLR,
+		sensor_data->id, sensor_data->value, sensor_data->ts);
+#endif
 
-	if(sbuffer_insert(*buffer, sensor_data) != SBUFFER_SUCCESS)
+	// 'sensor_data' is a reserved slot of the buffer, it is published in place
+	if(sbuffer_commit(*buffer, sensor_data) != SBUFFER_SUCCESS)
 		printf("CONNMGR: SBUFFER ERROR\n");
-	return TCP_NO_ERROR;
 }
 
-void connmgr_update_threads(){
-	// lock the mutex
-	pthread_mutex_lock(datamgr_lock);
-	pthread_mutex_lock(db_lock);
+void connmgr_add_local(uint64_t now){
+	for(int i = 0; i < CONNMGR_ACCEPT_BATCH; i++){
+		local_ring_t* local;
+		int result = local_ring_accept(local_listener, &local);
+		if(result == LOCAL_RING_NONE) return;
+		if(result != LOCAL_RING_SUCCESS){
+			log_message(LOG_ERROR, "ConnMgr/Thread-1", "CANNOT ACCEPT LOCAL PRODUCER");
+			return;
+		}
+
+		// the connection carries the registration and then the doorbell, poll and io_uring watch it like a socket of a sensor
+		conn_t* insert_sensor = conn_table_add(connections, local_ring_fd(local), POLLIN, NULL);
+		if(insert_sensor == NULL){
+			log_message(LOG_ERROR, "ConnMgr/Thread-1", "CONNECTION TABLE FULL, LOCAL PRODUCER REFUSED");
+			local_ring_close(&local);
+			continue;
+		}
+		insert_sensor->local = local;
+		local_count++;
+		// a producer that does not register is closed by its idle timer, it never holds up the loop
+		insert_sensor->last_active = now;
+		insert_sensor->timeout = LOCAL_RING_REGISTER_MS;
+		timer_wheel_schedule(wheel, &(insert_sensor->idle_timer), now + insert_sensor->timeout);
+
+		// the producer sends its registration right after it connected, it is usually there already
+		connmgr_local_hello(insert_sensor, now);
+	}
+}
+
+void connmgr_local_hello(conn_t* poll_at_index, uint64_t now){
+	int result = local_ring_hello(poll_at_index->local);
+	if(result == LOCAL_RING_NONE){
+		// poll() keeps watching the connection, io_uring is asked again
+		if(ring != NULL && conn_uring_poll_once(ring, connections->pollfds[poll_at_index->slot].fd, conn_table_handle(connections, poll_at_index->slot)) != CONN_URING_SUCCESS)
+			connmgr_mark_closing(poll_at_index);
+		return;
+	}
+	if(result != LOCAL_RING_SUCCESS){
+		log_message(LOG_WARNING, "ConnMgr/Thread-1", "LOCAL PRODUCER REFUSED, NOT A VALID RING");
+		connmgr_mark_closing(poll_at_index);
+		return;
+	}
 
-	// update the number of data in the buffer
-	(*data_sensor_db)++;
-	(*data_mgr)++;
-	// unlock the mutex
-	pthread_mutex_unlock(datamgr_lock);
-	pthread_mutex_unlock(db_lock);
+	// the idle timer moves to the new deadline when it fires
+	poll_at_index->last_active = now;
+	poll_at_index->timeout = default_timeout;
+	log_message(LOG_LEVEL_INFO, "ConnMgr/Thread-1", "NEW LOCAL PRODUCER");
+	if(ring != NULL && conn_uring_recv(ring, connections->pollfds[poll_at_index->slot].fd, conn_table_handle(connections, poll_at_index->slot)) != CONN_URING_SUCCESS)
+		connmgr_mark_closing(poll_at_index);
 
-	// let the other threads know there is data to read
-	pthread_cond_broadcast(db_cond);
-	pthread_cond_broadcast(data_cond);
+	// the ring can hold readings already, e.g. the ones the previous gateway did not take
+	connmgr_mark_pending(poll_at_index);
 }
 
-void connmgr_close_threads(){
-	// close the connmgr
-	pthread_rwlock_wrlock(connmgr_lock);
-	*connmgr_working = false;
-	pthread_rwlock_unlock(connmgr_lock);
+void connmgr_local_drain(sbuffer_t** buffer, conn_t* poll_at_index, uint64_t now, FILE* fp_sensor_data_text, int* readings){
+	int available = local_ring_available(poll_at_index->local);
+	if(available == LOCAL_RING_FAILURE){
+		log_message(LOG_ERROR, "ConnMgr/Thread-1", "LOCAL PRODUCER OF SENSOR ID: %d BROKE ITS RING", poll_at_index->sensor_id);
+		connmgr_mark_closing(poll_at_index);
+		return;
+	}
+
+	// the readings are copied from the ring straight into their slots in the buffer, with the sub-second time of the producer
+	for(int index = 0; index < available; index++){
+		sensor_data_t* sensor_data = sbuffer_reserve(*buffer);
+		if(sensor_data == NULL){
+			printf("CONNMGR: SBUFFER ERROR\n");
+			continue;
+		}
+		*sensor_data = *local_ring_peek(poll_at_index->local, index);
+		connmgr_store_reading(buffer, poll_at_index, sensor_data, fp_sensor_data_text, readings);
+	}
+	local_ring_consume(poll_at_index->local, available);
+	if(available > 0) poll_at_index->last_active = now;
 
-	// lock the mutex
-	pthread_mutex_lock(datamgr_lock);
-	pthread_mutex_lock(db_lock);
+	// readings stored while the doorbell was asked for do not ring
+	if(local_ring_sleep(poll_at_index->local) > 0) connmgr_mark_pending(poll_at_index);
+}
 
-	// update the number of data in the buffer
-	(*data_mgr) = -1;
-	(*data_sensor_db) = -1;
+void connmgr_local_resume(sbuffer_t** buffer, uint64_t now, FILE* fp_sensor_data_text, int* readings){
+	// a drain can add its ring again, that one waits for the next iteration
+	int count = local_pending_size;
+	if(count == 0) return;
+	for(int index = 0; index < count; index++){
+		conn_t* poll_at_index = conn_table_lookup(connections, local_pending[index]);
+		if(poll_at_index != NULL) connmgr_local_drain(buffer, poll_at_index, now, fp_sensor_data_text, readings);
+	}
+	local_pending_size -= count;
+	memmove(local_pending, local_pending + count, local_pending_size * sizeof(conn_handle_t));
+}
 
-	// unlock the mutex
-	pthread_mutex_unlock(datamgr_lock);
-	pthread_mutex_unlock(db_lock);
+int connmgr_udp_open(int fd){
+	// a socket that is taken over is bound already
+	if(fd == -1){
+		fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+		if(fd == -1) return -1;
+		// bursts of many sensors are absorbed by the socket while the connmgr is busy, the kernel may cap the size
+		int size = CONNMGR_UDP_RCVBUF;
+		setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+		struct sockaddr_in address = {.sin_family = AF_INET, .sin_port = htons(udp_port), .sin_addr.s_addr = htonl(INADDR_ANY)};
+		if(bind(fd, (struct sockaddr*) &address, sizeof(address)) != 0){
+			close(fd);
+			return -1;
+		}
+	}
 
-	// let the other threads know there is data to read
-	pthread_cond_broadcast(db_cond);
-	pthread_cond_broadcast(data_cond);
+	// on the empty table the socket gets UDP_SLOT, the sensors come after it
+	udp = calloc(1, sizeof(connmgr_udp_t));
+	if(udp == NULL || conn_table_add(connections, fd, POLLIN, NULL) == NULL){
+		free(udp);
+		udp = NULL;
+		close(fd);
+		return -1;
+	}
+	for(int i = 0; i < CONNMGR_UDP_BATCH; i++){
+		udp->iov[i].iov_base = udp->data[i];
+		udp->iov[i].iov_len = CONNMGR_UDP_SIZE;
+		udp->msgs[i].msg_hdr.msg_iov = &(udp->iov[i]);
+		udp->msgs[i].msg_hdr.msg_iovlen = 1;
+	}
+	udp_fd = fd;
+	first_sensor = UDP_SLOT + 1;
+	return 0;
 }
 
-void* element_copy(void* element){
-	poll_info_t* src = (poll_info_t*) element;
-	poll_info_t* copy = malloc(sizeof(poll_info_t));
-	copy->file_d = src->file_d;
-	copy->sensor_id = src->sensor_id;
-	copy->socket_id = src->socket_id;
-	copy->last_modified = src->last_modified;
-	return copy;
+void connmgr_udp_drain(sbuffer_t** buffer, conn_t* poll_server, uint64_t now, FILE* fp_sensor_data_text, int* readings){
+	udp_backlog = false;
+	// a few batches per iteration at most, so a flood of datagrams can not starve the connections
+	for(int calls = 0; calls < CONNMGR_UDP_BUDGET; calls++){
+		int count = recvmmsg(udp_fd, udp->msgs, CONNMGR_UDP_BATCH, MSG_DONTWAIT, NULL);
+		if(count <= 0) return;
+
+		// the UDP sensors keep the connmgr running like a connected sensor does
+		poll_server->last_active = now;
+		for(int i = 0; i < count; i++){
+			// a datagram larger than the buffer is cut off, it is not decoded
+			int size = (udp->msgs[i].msg_hdr.msg_flags & MSG_TRUNC) ? 0 : (int) udp->msgs[i].msg_len;
+			connmgr_udp_datagram(buffer, udp->data[i], size, fp_sensor_data_text, readings);
+		}
+
+		// a short batch means the socket is drained
+		if(count < CONNMGR_UDP_BATCH) return;
+	}
+	udp_backlog = true;
 }
 
-void element_free(void **element) {
-    if (element == NULL || *element == NULL) return;
+void connmgr_udp_datagram(sbuffer_t** buffer, const uint8_t* data, int size, FILE* fp_sensor_data_text, int* readings){
+	udp->datagrams++;
+	size -= (int) sizeof(uint32_t);
+	if(size < (int) CONN_FRAME_SIZE || size % CONN_FRAME_SIZE != 0){
+		udp->invalid++;
+		return;
+	}
 
-    poll_info_t *info = (poll_info_t *)(*element);
+	// every reading of a datagram comes from the sensor of the first one
+	uint32_t sequence;
+	sensor_id_t id;
+	memcpy(&sequence, data, sizeof(uint32_t));
+	data += sizeof(uint32_t);
+	memcpy(&id, data, sizeof(sensor_id_t));
+	if(!udp->seen[id]){
+		udp->seen[id] = 1;
+		log_message(LOG_LEVEL_INFO, "ConnMgr/Thread-1", "NEW UDP SENSOR ID: %d", id);
+		udp->next_sequence[id] = sequence + 1;
+		udp->received[id] = 1;
+	}
+	else{
+		// the difference wraps around with the sequence number
+		int32_t ahead = (int32_t) (sequence - udp->next_sequence[id]);
+		// a copy of the first datagram within the remembered sequence numbers is not a restart, the bitmap tells
+		if(ahead < 0 && ((sequence == 0 && -ahead > CONNMGR_UDP_WINDOW) || ahead < -CONNMGR_UDP_RESTART)){
+			log_message(LOG_LEVEL_INFO, "ConnMgr/Thread-1", "UDP SENSOR ID: %d RESTARTED AT SEQUENCE %" PRIu32, id, sequence);
+			udp->next_sequence[id] = sequence + 1;
+			udp->received[id] = 1;
+		}
+		else if(ahead < 0){
+			// a late datagram still has valid readings, it was counted as lost when the gap was seen and is not lost after all
+			// a duplicate would store its readings twice, and further behind it can not be told apart from one
+			uint32_t behind = (uint32_t) (-(ahead + 1));
+			if(behind >= CONNMGR_UDP_WINDOW || (udp->received[id] & ((uint64_t) 1 << behind))){
+				udp->dropped++;
+				return;
+			}
+			udp->received[id] |= (uint64_t) 1 << behind;
+			udp->late++;
+			if(udp->lost > 0) udp->lost--;
+		}
+		else{
+			udp->lost += (uint64_t) ahead;
+			udp->next_sequence[id] = sequence + 1;
+			udp->received[id] = ((ahead < CONNMGR_UDP_WINDOW - 1) ? udp->received[id] << (ahead + 1) : 0) | 1;
+		}
+	}
 
-    // Ch? close socket n?u chua b? dng
-    if (info->socket_id != NULL) {
-        tcp_close(&(info->socket_id));
-        info->socket_id = NULL;
-    }
+	for(; size > 0; data += CONN_FRAME_SIZE, size -= CONN_FRAME_SIZE){
+		sensor_data_t* sensor_data = connmgr_decode_reading(buffer, data);
+		if(sensor_data == NULL) continue;
+		connmgr_ingest_reading(buffer, sensor_data, fp_sensor_data_text, readings);
+		udp->readings++;
+	}
+}
 
-    free(info);
-    *element = NULL;
+void connmgr_udp_close(){
+	if(udp_fd == -1) return;
+	log_message(LOG_LEVEL_INFO, "ConnMgr/Thread-1", "UDP: %" PRIu64 " DATAGRAMS, %" PRIu64 " READINGS, %" PRIu64 " LOST, %" PRIu64
+	            " LATE, %" PRIu64 " DUPLICATE OR TOO LATE, %" PRIu64 " INVALID", udp->datagrams, udp->readings, udp->lost, udp->late,
+	            udp->dropped, udp->invalid);
+	close(udp_fd);
+	free(udp);
+	udp = NULL;
+	udp_fd = -1;
+	first_sensor = SERVER_SLOT + 1;
+	udp_backlog = false;
 }
 
-int element_compare(void* x, void* y){
-	sensor_id_t x_id = *(sensor_id_t*) x;
-	sensor_id_t y_id = ((poll_info_t*) y)->sensor_id;
-	return (x_id == y_id) ? 0 : ((x_id > y_id) ? 1 : -1);
+void connmgr_update_threads(int count){
+	// a reader thread that is busy picks the readings up without a wakeup
+	notifier_post(datamgr_notify, count);
+	notifier_post(db_notify, count);
+	notifier_post(stream_notify, count);
 }
 
+void connmgr_close_threads(){
+	// close the connmgr
+	pthread_rwlock_wrlock(connmgr_lock);
+	*connmgr_working = false;
+	pthread_rwlock_unlock(connmgr_lock);
+
+	// let the other threads know no data will follow
+	notifier_close(datamgr_notify);
+	notifier_close(db_notify);
+	notifier_close(stream_notify);
+}
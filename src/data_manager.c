@@ -3,42 +3,35 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
 #include "config.h"
 #include "sensor_buffer.h"
-#include "dplist.h"
+#include "sensor_table.h"
+#include "window_kernel.h"
 #include "data_manager.h"
+#include "connection_manager.h"
 #include "logger.h"
-
-// definition of error codes
-#define DPLIST_NO_ERROR 0
-#define DPLIST_MEMORY_ERROR 1 // error due to mem alloc failure
-#define DPLIST_INVALID_ERROR 2 //error due to a list operation applied on a NULL list 
-#define ERROR_NULL_POINTER 3
-
-
-// global variables
-static dplist_t* sensor_list;
+#include "latest_table.h"
+#include "sensor_history.h"
+#include "room_stats.h"
+#include "sensor_map.h"
+#include "alert_rules.h"
+#include "slab.h"
 
 // helper methods
-
-void datamgr_read_sensor_map(FILE* fp_sensor_map);
-void datamgr_add_sensor_data(sensor_data_t* new_data);
-
-// methods for dpl_create
-void sensor_free(void** element);
-void* sensor_copy(void* element);
-int sensor_compare(void* x, void* y);
+void datamgr_add_batch(const sensor_data_t** batch, int count);
+void datamgr_sweep_stale(sensor_ts_t now);
+void datamgr_restore();
+void datamgr_checkpoint();
+void datamgr_alert(int slot, const alert_rule_t* rule, alert_state_t state, time_t now);
 
 // global variables
-static dplist_t* sensor_list;
-
-static pthread_cond_t* data_cond;
-static pthread_mutex_t* datamgr_lock;
-static int* data_mgr;
+static sensor_table_t* sensors = NULL;
+static int8_t batch_index[65536];      // position of a sensor in the current batch, -1 if it is not in it
 
-static pthread_cond_t* db_cond;
-static pthread_mutex_t* db_lock;
-static int* data_sensor_db;
+static notifier_t* datamgr_notify;
 
 static pthread_rwlock_t* connmgr_lock;
 static bool* connmgr_working;
@@ -47,13 +40,7 @@ static pthread_mutex_t* fifo_mutex;
 static int* fifo_fd;
 
 void datamgr_init(config_thread_t* config_thread){
-    data_cond = config_thread->data_cond;
-    datamgr_lock = config_thread->datamgr_lock;
-    data_mgr = config_thread->data_mgr;
-
-    db_cond = config_thread->db_cond;
-    db_lock = config_thread->db_lock;
-    data_sensor_db = config_thread->data_sensor_db;
+    datamgr_notify = config_thread->datamgr_notify;
 
     connmgr_lock = config_thread->connmgr_lock;
     connmgr_working = config_thread->connmgr_working;
@@ -62,207 +49,307 @@ void datamgr_init(config_thread_t* config_thread){
     fifo_mutex = config_thread->fifo_mutex;
 }
 
-void datamgr_parse_sensor_files(FILE* fp_sensor_map, sbuffer_t** sbuffer){
+void datamgr_parse_sensor_files(sbuffer_t** sbuffer){
 #ifdef DEBUG
     printf(GREEN_CLR "DATAMGR: INITIATING DATAMGR.\n"OFF_CLR);
 #endif
-    // initialize the sensor_list
-    sensor_list = dpl_create(sensor_copy, sensor_free, sensor_compare);
+    // initialize the sensor table
+    if(sensor_table_init(&sensors) != SENSOR_TABLE_SUCCESS){
+        log_message(LOG_ERROR, "DataMgr/Thread-1", "Could not initialize the sensor table\n");
+        return;
+    }
+    datamgr_restore();
+    time_t next_sweep = time(NULL) + SENSOR_SWEEP_INTERVAL;
+    time_t next_checkpoint = time(NULL) + SENSOR_CHECKPOINT_INTERVAL;
+    memset(batch_index, -1, sizeof(batch_index));
+
+    // the alert rules are optional, without them every sensor uses SET_MIN_TEMP and SET_MAX_TEMP
+    FILE* fp_rules = fopen(ALERT_RULES_FILE, "r");
+    if(alert_rules_init(fp_rules) != ALERT_RULES_SUCCESS){
+        log_message(LOG_ERROR, "DataMgr/Thread-1", "Could not initialize the alert rules\n");
+    }
+    if(fp_rules != NULL) fclose(fp_rules);
 
-    // read the sensor_map file
-    datamgr_read_sensor_map(fp_sensor_map);
+    // pick the window kernel for this CPU
+    window_kernel_init();
+    log_message(LOG_LEVEL_INFO, "DataMgr/Thread-1", "WINDOW KERNEL: %s", window_kernel_name());
+
+    // initialize the room aggregates from the shared sensor map
+    uint32_t map_generation = sensor_map_generation();
+    if(room_stats_init() != ROOM_STATS_SUCCESS){
+        log_message(LOG_ERROR, "DataMgr/Thread-1", "Could not initialize the room aggregates\n");
+    }
 
     // parse sensor_data, and insert it to the appropriate sensor
-    while(*connmgr_working){
-        pthread_mutex_lock(datamgr_lock);
-        while((*data_mgr) == 0){
-            pthread_cond_wait(data_cond, datamgr_lock);
-        #ifdef DEBUG
-            printf(GREEN_CLR "DATAMGR: WAITING FOR DATA.\n" OFF_CLR);
-        #endif
-            if (!*connmgr_working) {
-            pthread_mutex_unlock(datamgr_lock);
-            return;
-            }
-        }
-        if(*connmgr_working == false){
-            pthread_mutex_unlock(datamgr_lock);
+    // after the connmgr closed the notifier the readings still in the buffer are processed, until the drain deadline
+    while(!notifier_expired(datamgr_notify)){
+        // wait until the connmgr added data
+        int available = notifier_wait(datamgr_notify);
+        if(available == NOTIFIER_CLOSED) break;
+        if(available > WINDOW_KERNEL_BATCH) available = WINDOW_KERNEL_BATCH;
+
+        // read everything that is available in place, up to one kernel batch
+        const sensor_data_t* batch[WINDOW_KERNEL_BATCH];
+        int count = 0;
+        int res = sbuffer_peek(*sbuffer, batch, available, DATAMGR_THREAD, &count);
+        if( res == SBUFFER_FAILURE) {
+            printf(GREEN_CLR "DATAMGR: SBUFFER ERROR %d\n" OFF_CLR, res);
             break;
         }
+        if(count == 0) continue;
 
-        pthread_mutex_unlock(datamgr_lock);
-
-        // copy the data
-        sensor_data_t new_data;
-        int res = sbuffer_remove(*sbuffer, &new_data, DATAMGR_THREAD);
-        if( res != SBUFFER_SUCCESS) {
-            printf(GREEN_CLR "DATAMGR: SBUFFER ERROR %d\n" OFF_CLR, res);
-            break;
+        // the sensor map was reloaded, the rooms are rebuilt before the readings are aggregated
+        if(sensor_map_generation() != map_generation){
+            map_generation = sensor_map_generation();
+            room_stats_reload(batch[0]->ts);
         }
 
-        //add the sensor_data to the sensor_list
-        datamgr_add_sensor_data(&new_data);
+        //add the sensor_data to the sensor table
+        datamgr_add_batch(batch, count);
+        sbuffer_release(*sbuffer, count, DATAMGR_THREAD);
+
+        // look for sensors that went silent
+        time_t now = time(NULL);
+        if(now >= next_sweep){
+            datamgr_sweep_stale(now);
+            next_sweep = now + SENSOR_SWEEP_INTERVAL;
+        }
+        if(now >= next_checkpoint){
+            datamgr_checkpoint();
+            next_checkpoint = now + SENSOR_CHECKPOINT_INTERVAL;
+        }
         
-        pthread_mutex_lock(datamgr_lock);
-        (*data_mgr)--;
-        pthread_mutex_unlock(datamgr_lock);
+        notifier_take(datamgr_notify, count);
     }
+    // the drained readings are part of the last snapshot
+    datamgr_checkpoint();
 }
 
-void datamgr_read_sensor_map(FILE* fp_sensor_map){
-    if(fp_sensor_map == NULL){
-        fprintf(stderr, "Error: NULL pointer fp_sensor_map\n");
-        exit(ERROR_NULL_POINTER);
+void datamgr_restore(){
+    // without a snapshot every sensor starts with an empty window
+    if(access(SENSOR_SNAPSHOT_FILE, F_OK) != 0) return;
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if(sensor_table_load(sensors, SENSOR_SNAPSHOT_FILE) != SENSOR_TABLE_SUCCESS){
+        log_message(LOG_WARNING, "DataMgr/Thread-1", "IGNORED INVALID SNAPSHOT %s", SENSOR_SNAPSHOT_FILE);
+        return;
     }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    log_message(LOG_LEVEL_INFO, "DataMgr/Thread-1", "RESTORED %d SENSORS FROM %s IN %.3f MS", sensors->count, SENSOR_SNAPSHOT_FILE,
+                (end.tv_sec - start.tv_sec) * 1e3 + (end.tv_nsec - start.tv_nsec) / 1e6);
+}
 
-    //add the room_id and sensor_id to the sensor_list
-    while(!feof(fp_sensor_map)){
-        //read each line in str unless empty/NULL 
-        char str[8];
-        if(fgets(str, 8, fp_sensor_map) == NULL) continue;
-
-        //parse the room_id and sensor_id
-        sensor_id_t s_id;
-        room_id_t r_id;
-        sscanf(str, "%hu %hu", &r_id, &s_id);
-
-        // initialize the sensor
-        sensor_t sens = {
-            .room_id = r_id,  .sensor_id = s_id,
-            .running_avg = 0.0,     .last_modified = 0,
-            .buffer_position = 0,   .take_avg = false
-        };
-#ifdef DEBUG
-        printf(GREEN_CLR "DATAMGR: NEW SENSOR ID: %d  ROOM ID: %d\n"OFF_CLR, sens.sensor_id, sens.room_id);
-#endif
-        //add the sensor_t to the sensor_list
-        sensor_list = dpl_insert_at_index(sensor_list, &sens, 0, true);
+int datamgr_handoff_checkpoint(int timeout_ms){
+    struct timespec pause = {0, 1000000L};
+    for(int waited = 0; notifier_pending(datamgr_notify) > 0; waited++){
+        if(waited >= timeout_ms) return -1;
+        nanosleep(&pause, NULL);
     }
+    if(sensors == NULL || sensor_table_save(sensors, SENSOR_SNAPSHOT_FILE) != SENSOR_TABLE_SUCCESS) return -1;
+    return 0;
 }
 
-void datamgr_add_sensor_data(sensor_data_t* new_data){
-    //find element in list where sensor_id = buffer_id and add the element
-    bool added = false;
-
-
-    for(int i = 0; i < dpl_size(sensor_list);i++){
-        sensor_t* sns = dpl_get_element_at_index(sensor_list, i);
+void datamgr_checkpoint(){
+    // the snapshot of a gateway that handed its sockets over would overwrite the one of the new gateway
+    if(connmgr_handed_over()) return;
+    if(sensor_table_save(sensors, SENSOR_SNAPSHOT_FILE) != SENSOR_TABLE_SUCCESS)
+        log_message(LOG_ERROR, "DataMgr/Thread-1", "CANNOT WRITE SNAPSHOT %s", SENSOR_SNAPSHOT_FILE);
+}
 
-        // if the sensor_id is not the same, continue
-        if(sns->sensor_id != new_data->id) continue;
+void datamgr_add_batch(const sensor_data_t** batch, int count){
+    window_batch_t windows;
+    int slots[WINDOW_KERNEL_BATCH];
+    const sensor_data_t* last[WINDOW_KERNEL_BATCH];
+    uint64_t full = 0;
+    int unique = 0;
 
-        //add the new data point in the circular buffer
-        sns->data_buffer[sns->buffer_position] = new_data->value;
+    // apply new alert rules between two batches
+    alert_rules_poll();
 
-        //update buffer pointer position
-        sns->buffer_position++;
+    // the windows are updated in arrival order, a sensor that reports more than once is evaluated once
+    for(int i = 0; i < count; i++){
+        const sensor_data_t* new_data = batch[i];
 
-        //act as a circular buffer
-        if(sns->buffer_position == RUN_AVG_LENGTH){
-            sns->buffer_position = 0;
-            sns->take_avg = true; //if the buffer is full, start taking the average
+        // only sensors in the current sensor map are processed, the map can change while the gateway runs
+        room_id_t room_id = sensor_map_get_room(new_data->id);
+        if(room_id == 0){
+#ifdef DEBUG
+            printf(GREEN_CLR "DATAMGR: DID NOT ADD DATA\n" OFF_CLR);
+#endif
+            continue;
         }
 
-        //update the timestamp
-        sns->last_modified = new_data->ts;
-                
-        added = true;
-
-        //if the buffer is not full we don't take the average
-        if(sns->take_avg == false){
+        // first reading of a sensor in the map, start tracking it
+        int slot = sensor_table_find(sensors, new_data->id);
+        if(slot == -1){
+            slot = sensor_table_add(sensors, new_data->id, room_id);
+            if(slot == -1){
+                log_message(LOG_ERROR, "DataMgr/Thread-1", "SENSOR ID: %d DROPPED, SENSOR TABLE IS FULL\n", new_data->id);
+                continue;
+            }
 #ifdef DEBUG
-            printf(GREEN_CLR "DATAMGR: ID: %u ROOM: %d  AVG: %f   TIME: %ld\n" OFF_CLR,
-                sns->sensor_id, sns->room_id, sns->running_avg, sns->last_modified);
+            printf(GREEN_CLR "DATAMGR: NEW SENSOR ID: %d  ROOM ID: %d\n"OFF_CLR, new_data->id, room_id);
 #endif
-            continue;
         }
 
-        //update the running average
-        sensor_value_t avg = 0;
+        // the sensor may have moved to another room
+        sensors->rooms[slot] = room_id;
 
-        // calculate sum of all elements in the buffer
-        for(int i = 0; i < RUN_AVG_LENGTH; i++) avg = avg + sns->data_buffer[i];
+        //add the new data point to the window
+        bool window_full = sensor_table_store(sensors, slot, new_data->value, new_data->ts);
 
-        // calculate the average
-        sns->running_avg = (avg / RUN_AVG_LENGTH);
+        //keep the reading in the in-memory history
+        history_append(new_data->id, new_data->value, new_data->ts);
 
-        // log in case it is an extreme
-        if(sns->running_avg > SET_MAX_TEMP){ 
-          log_message(LOG_WARNING, "DataMgr/Thread-1", "SENSOR ID: %d TOO HOT! (AVG_TEMP = %f)\n", sns->sensor_id, sns->running_avg);
+        //update the aggregates of the room of the sensor
+        room_stats_update(new_data->id, new_data->value, new_data->ts);
+
+        int index = batch_index[new_data->id];
+        if(index == -1){
+            index = unique++;
+            batch_index[new_data->id] = index;
+            slots[index] = slot;
         }
-        if(sns->running_avg < SET_MIN_TEMP){
-          log_message(LOG_WARNING, "DataMgr/Thread-1", "SENSOR ID: %d TOO COOL! (AVG_TEMP = %f)\n", sns->sensor_id, sns->running_avg);
-        } 
-        
-#ifdef DEBUG
-        printf(GREEN_CLR "DATAMGR: ID: %u ROOM: %d  AVG: %f   TIME: %ld\n" OFF_CLR,
-                sns->sensor_id, sns->room_id, sns->running_avg, sns->last_modified);
-#endif
+        last[index] = new_data;
+        if(window_full) full |= (uint64_t) 1 << index;
+    }
+    if(unique == 0) return;
+
+    // transpose the windows so the kernel adds contiguous rows
+    const alert_rule_t* rules[WINDOW_KERNEL_BATCH];
+    sensor_value_t min[WINDOW_KERNEL_BATCH], max[WINDOW_KERNEL_BATCH];
+    for(int index = 0; index < unique; index++){
+        int slot = slots[index];
+        const sensor_value_t* window = &(sensors->windows[slot * RUN_AVG_LENGTH]);
+        for(int k = 0; k < RUN_AVG_LENGTH; k++) windows[k][index] = window[k];
+
+        // a sensor that is out of range stays so until it is 'hysteresis' back inside the range
+        sensor_id_t id = sensors->ids[slot];
+        rules[index] = alert_rules_find(id, sensors->rooms[slot], sensor_map_get_type(id));
+        min[index] = rules[index]->min;
+        max[index] = rules[index]->max;
+        if(sensors->alert_state[slot] == ALERT_HOT) max[index] -= rules[index]->hysteresis;
+        if(sensors->alert_state[slot] == ALERT_COLD) min[index] += rules[index]->hysteresis;
     }
-    if(!added){
+
+    //update the running averages and compare them with the thresholds in one pass
+    sensor_value_t avg[WINDOW_KERNEL_BATCH];
+    uint64_t hot, cold;
+    window_kernel_eval(windows, unique, min, max, avg, &hot, &cold);
+
+    for(int index = 0; index < unique; index++){
+        int slot = slots[index];
+        const sensor_data_t* new_data = last[index];
+        batch_index[new_data->id] = -1;
+
+        //if the buffer is not full we don't take the average
+        if(full & ((uint64_t) 1 << index)) sensors->running_avg[slot] = avg[index];
+
+        // publish the new state for readers outside the gateway
+        latest_table_publish(new_data->id, sensors->rooms[slot], new_data->value, sensors->running_avg[slot], new_data->ts);
+
 #ifdef DEBUG
-        printf(GREEN_CLR "DATAMGR: DID NOT ADD DATA\n" OFF_CLR);
+        printf(GREEN_CLR "DATAMGR: ID: %u ROOM: %d  AVG: %f   TIME: %ld\n" OFF_CLR,
+                new_data->id, sensors->rooms[slot], sensors->running_avg[slot], new_data->ts);
 #endif
     }
-}
-
-void datamgr_free(){
-    dpl_free(&sensor_list, true);
-}
 
+    // only sensors with a full window that are out of range or were out of range before need a look
+    uint64_t alerting = 0;
+    for(int index = 0; index < unique; index++) if(sensors->alert_state[slots[index]] != ALERT_NORMAL) alerting |= (uint64_t) 1 << index;
 
-room_id_t datamgr_get_room_id(sensor_id_t sensor_id){
-    for(int i = 0; i < dpl_size(sensor_list); i++){
-        sensor_t* sensor = (sensor_t*) dpl_get_element_at_index(sensor_list, i);
-        if(sensor->sensor_id == sensor_id) return sensor->room_id;
+    time_t now = time(NULL);
+    for(uint64_t bits = (hot | cold | alerting) & full; bits != 0; bits &= bits - 1){
+        int index = __builtin_ctzll(bits);
+        uint64_t bit = (uint64_t) 1 << index;
+        alert_state_t state = (hot & bit) ? ALERT_HOT : (cold & bit) ? ALERT_COLD : ALERT_NORMAL;
+        datamgr_alert(slots[index], rules[index], state, now);
     }
-    return 0;
 }
 
+void datamgr_alert(int slot, const alert_rule_t* rule, alert_state_t state, time_t now){
+    sensor_id_t id = sensors->ids[slot];
+    sensor_value_t running_avg = sensors->running_avg[slot];
+
+    if(state == sensors->alert_state[slot]){
+        // still out of range, remind at most once per interval
+        if(state == ALERT_NORMAL || rule->interval == 0 || now - sensors->alert_last[slot] < rule->interval) return;
+        log_message(LOG_WARNING, "DataMgr/Thread-1", "SENSOR ID: %d STILL TOO %s! (AVG_TEMP = %f)\n",
+                    id, (state == ALERT_HOT) ? "HOT" : "COOL", running_avg);
+        sensors->alert_last[slot] = now;
+        return;
+    }
 
-sensor_value_t datamgr_get_avg(sensor_id_t sensor_id){
-    for(int i = 0; i < dpl_size(sensor_list); i++){
-        sensor_t* sensor = (sensor_t*) dpl_get_element_at_index(sensor_list, i);
-        if(sensor->sensor_id == sensor_id) return sensor->running_avg;
+    if(state == ALERT_HOT){
+        log_message(LOG_WARNING, "DataMgr/Thread-1", "SENSOR ID: %d TOO HOT! (AVG_TEMP = %f)\n", id, running_avg);
     }
-    return 0;
+    if(state == ALERT_COLD){
+        log_message(LOG_WARNING, "DataMgr/Thread-1", "SENSOR ID: %d TOO COOL! (AVG_TEMP = %f)\n", id, running_avg);
+    }
+    if(state == ALERT_NORMAL){
+        log_message(LOG_LEVEL_INFO, "DataMgr/Thread-1", "SENSOR ID: %d BACK IN RANGE (AVG_TEMP = %f)", id, running_avg);
+    }
+    sensors->alert_state[slot] = state;
+    sensors->alert_last[slot] = now;
 }
 
-
-time_t datamgr_get_last_modified(sensor_id_t sensor_id){
-    for(int i = 0; i < dpl_size(sensor_list); i++){
-        sensor_t* sensor = (sensor_t*) dpl_get_element_at_index(sensor_list, i);
-        if(sensor->sensor_id == sensor_id) return sensor->last_modified;
+void datamgr_sweep_stale(sensor_ts_t now){
+    // one pass over the timestamps, a sensor is only reported when it goes silent
+    sensor_ts_t* last_modified = sensors->last_modified;
+    bool* stale = sensors->stale;
+    for(int slot = 0; slot < sensors->count; slot++){
+        if(stale[slot] || now - last_modified[slot] <= SENSOR_STALE_AGE) continue;
+        stale[slot] = true;
+        log_message(LOG_WARNING, "DataMgr/Thread-1", "SENSOR ID: %d SILENT FOR %ld SECONDS\n",
+                    sensors->ids[slot], (long) (now - last_modified[slot]));
     }
-    return 0;
 }
 
+void datamgr_dump_stats(FILE* fp){
+    if(sensors == NULL) return;
+    int stale = 0, hot = 0, cold = 0, averaging = 0;
+    for(int slot = 0; slot < sensors->count; slot++) stale += sensors->stale[slot];
+    for(int slot = 0; slot < sensors->count; slot++) averaging += sensors->take_avg[slot];
+    for(int slot = 0; slot < sensors->count; slot++){
+        hot += (sensors->alert_state[slot] == ALERT_HOT);
+        cold += (sensors->alert_state[slot] == ALERT_COLD);
+    }
+    fprintf(fp, "SENSORS: %d (CAPACITY %d)  AVERAGING: %d  TOO HOT: %d  TOO COOL: %d  SILENT: %d\n",
+            sensors->count, sensors->capacity, averaging, hot, cold, stale);
+    for(int slot = 0; slot < sensors->count; slot++){
+        fprintf(fp, "  ID: %u ROOM: %u  AVG: %f  TIME: %ld%s\n", sensors->ids[slot], sensors->rooms[slot],
+                sensors->running_avg[slot], (long) sensors->last_modified[slot], sensors->stale[slot] ? "  SILENT" : "");
+    }
+    slab_dump_stats(fp);
+}
 
-int datamgr_get_total_sensors(){
-    return dpl_size(sensor_list);
+void datamgr_free(){
+#ifdef DEBUG
+    datamgr_dump_stats(stdout);
+#endif
+    sensor_table_free(&sensors);
+    room_stats_free();
+    alert_rules_free();
 }
 
-void sensor_free(void** element){
-    free(*element);
-    *element = NULL;
+
+room_id_t datamgr_get_room_id(sensor_id_t sensor_id){
+    return sensor_map_get_room(sensor_id);
 }
 
-void* sensor_copy(void* element){
-    sensor_t* sensor = (sensor_t*) element;
-    sensor_t* copy = malloc(sizeof(sensor_t));
-    copy->sensor_id = sensor->sensor_id;
-    copy->room_id = sensor->room_id;
-    copy->running_avg = sensor->running_avg;
-    copy->last_modified = sensor->running_avg;
-    return (void*) copy;
+
+sensor_value_t datamgr_get_avg(sensor_id_t sensor_id){
+    int slot = (sensors == NULL) ? -1 : sensor_table_find(sensors, sensor_id);
+    return (slot == -1) ? 0 : sensors->running_avg[slot];
 }
 
-int sensor_compare(void* x, void* y){
-    sensor_t* sensor_y = (sensor_t*) y;
-    sensor_t* sensor_x = (sensor_t*) x;
-    if(sensor_y->sensor_id == sensor_x->sensor_id) return 0;
-    if(sensor_y->sensor_id < sensor_x->sensor_id) return 1;
-    if(sensor_y->sensor_id > sensor_x->sensor_id) return -1;
-    else return -1;
+
+time_t datamgr_get_last_modified(sensor_id_t sensor_id){
+    int slot = (sensors == NULL) ? -1 : sensor_table_find(sensors, sensor_id);
+    return (slot == -1) ? 0 : sensors->last_modified[slot];
 }
 
+
+int datamgr_get_total_sensors(){
+    return (sensors == NULL) ? 0 : sensors->count;
+}
@@ -16,13 +16,9 @@ int sql_query(DBCONN* conn, callback_t f, char* sql);
 void sensor_close_threads();
 
 // global variables
-static pthread_cond_t* data_cond;
-static pthread_mutex_t* datamgr_lock;
-static int* data_mgr;
-
-static pthread_cond_t* db_cond;
-static pthread_mutex_t* db_lock;
-static int* data_sensor_db;
+static notifier_t* datamgr_notify;
+static notifier_t* db_notify;
+static notifier_t* stream_notify;
 
 static pthread_rwlock_t* connmgr_lock;
 static bool* connmgr_working;
@@ -30,14 +26,14 @@ static bool* connmgr_working;
 static pthread_mutex_t* fifo_mutex;
 static int* fifo_fd;
 
-void sensor_db_init(config_thread_t* config_thread){
-    data_cond = config_thread->data_cond;
-    datamgr_lock = config_thread->datamgr_lock;
-    data_mgr = config_thread->data_mgr;
+// the insert statement is prepared once and reused for every reading of its connection
+static sqlite3_stmt* insert_stmt = NULL;
+static DBCONN* insert_conn = NULL;
 
-    db_cond = config_thread->db_cond;
-    db_lock = config_thread->db_lock;
-    data_sensor_db = config_thread->data_sensor_db;
+void sensor_db_init(config_thread_t* config_thread){
+    datamgr_notify = config_thread->datamgr_notify;
+    db_notify = config_thread->db_notify;
+    stream_notify = config_thread->stream_notify;
 
     connmgr_lock = config_thread->connmgr_lock;
     connmgr_working = config_thread->connmgr_working;
@@ -63,6 +59,7 @@ DBCONN* init_connection(char clear_up_flag){
         sensor_close_threads();
         return NULL;
     }
+    sqlite3_busy_timeout(db, DB_BUSY_TIMEOUT_MS);
 
     if(clear_up_flag){
         char* sql = sqlite3_mprintf("DROP TABLE IF EXISTS %s", TABLE_NAME_STRING);
@@ -97,6 +94,12 @@ DBCONN* init_connection(char clear_up_flag){
 
 
 void disconnect(DBCONN* conn){
+    // a connection with an unfinalized statement can not be closed
+    if(insert_conn == conn){
+        sqlite3_finalize(insert_stmt);
+        insert_stmt = NULL;
+        insert_conn = NULL;
+    }
     sqlite3_close(conn);
 #ifdef DEBUG
     printf(BLUE_CLR"DB: DISCONNECTED FROM DATABASE\n" OFF_CLR);
@@ -104,49 +107,83 @@ void disconnect(DBCONN* conn){
 }
 
 int sensor_db_listen(DBCONN* conn, sbuffer_t** buffer){
-    while(*connmgr_working == true){
-        pthread_mutex_lock(db_lock);
-        while((*data_sensor_db) == 0){
-            pthread_cond_wait(db_cond, db_lock);
-        #ifdef DEBUG
-            printf(BLUE_CLR "DB: WAITING FOR DATA.\n" OFF_CLR);
-        #endif
-        
-        if (!*connmgr_working) {
-    pthread_mutex_unlock(db_lock);
-    return 0;
-}
-        }
-        if(*connmgr_working == false){
-            pthread_mutex_unlock(db_lock);
-            break;
-        }
-        pthread_mutex_unlock(db_lock);
-
-        // copy the data
-        sensor_data_t new_data;
-        if(sbuffer_remove(*buffer, &new_data, DB_THREAD) != SBUFFER_SUCCESS) break;
-
-        // insert the sensor in the database
-        if(insert_sensor(conn, new_data.id, new_data.value, new_data.ts) != 0){
+    // after the connmgr closed the notifier the readings still in the buffer are written, until the drain deadline
+    while(!notifier_expired(db_notify)){
+        // wait until the connmgr added data
+        int available = notifier_wait(db_notify);
+        if(available == NOTIFIER_CLOSED) break;
+        if(available > DB_BATCH_MAX) available = DB_BATCH_MAX;
+
+        // read the data in place
+        const sensor_data_t* batch[DB_BATCH_MAX];
+        int count;
+        if(sbuffer_peek(*buffer, batch, available, DB_THREAD, &count) != SBUFFER_SUCCESS) break;
+
+        // insert the sensors in the database, a reading that can not be inserted is skipped
+        int res = insert_sensor_batch(conn, batch, count);
+        sbuffer_release(*buffer, count, DB_THREAD);
+        if(res != 0){
             
             log_message(LOG_ERROR, "StorageMgr", "INSERT SENSOR ERROR - SKIPPED DATA \n");
-        continue; 
 }
 #ifdef DEBUG
-            printf(BLUE_CLR "DB: GOT DATA. %ld\n" OFF_CLR, time(NULL));
+            printf(BLUE_CLR "DB: GOT %d DATA. %ld\n" OFF_CLR, count, time(NULL));
 #endif
-        pthread_mutex_lock(db_lock);
-        (*data_sensor_db)--;
-        pthread_mutex_unlock(db_lock);
+        notifier_take(db_notify, count);
     }
     return 0;
 }
 
+int insert_sensor_batch(DBCONN* conn, const sensor_data_t** batch, int count){
+    // one commit, and one sync of the journal, for the whole batch instead of one per reading
+    if(sqlite3_exec(conn, "BEGIN", NULL, NULL, NULL) != SQLITE_OK){
+        log_message(LOG_ERROR, "StorageMgr", "CANNOT BEGIN TRANSACTION: %s\n", sqlite3_errmsg(conn));
+        return -1;
+    }
+    int res = 0;
+    for(int i = 0; i < count; i++)
+        if(insert_sensor(conn, batch[i]->id, batch[i]->value, batch[i]->ts) != 0) res = -1;
+
+    if(sqlite3_exec(conn, "COMMIT", NULL, NULL, NULL) != SQLITE_OK){
+        log_message(LOG_ERROR, "StorageMgr", "CANNOT COMMIT %d READINGS: %s\n", count, sqlite3_errmsg(conn));
+        sqlite3_exec(conn, "ROLLBACK", NULL, NULL, NULL);
+        return -1;
+    }
+    return res;
+}
+
 int insert_sensor(DBCONN* conn, sensor_id_t id, sensor_value_t value, sensor_ts_t ts){
-    char* sql = sqlite3_mprintf("INSERT INTO `%s` (`sensor_id`, `sensor_value`, `timestamp`)"
-        "VALUES ('%d', '%f', '%ld');", TABLE_NAME_STRING, id, value, ts);
-    return sql_query(conn, 0, sql);
+    if(insert_conn != conn){
+        sqlite3_finalize(insert_stmt);
+        insert_stmt = NULL;
+        insert_conn = NULL;
+
+        char* sql = sqlite3_mprintf("INSERT INTO `%s` (`sensor_id`, `sensor_value`, `timestamp`)"
+            "VALUES (?, ?, ?);", TABLE_NAME_STRING);
+        int res = sqlite3_prepare_v2(conn, sql, -1, &insert_stmt, NULL);
+        sqlite3_free(sql);
+        if(res != SQLITE_OK){
+            log_message(LOG_ERROR, "StorageMgr", "CANNOT PREPARE INSERT: %s\n", sqlite3_errmsg(conn));
+            insert_stmt = NULL;
+            return -1;
+        }
+        insert_conn = conn;
+    }
+
+    // only the values change, the statement is not parsed again
+    sqlite3_bind_int(insert_stmt, 1, id);
+    sqlite3_bind_double(insert_stmt, 2, value);
+    sqlite3_bind_int64(insert_stmt, 3, ts);
+    int res = sqlite3_step(insert_stmt);
+    sqlite3_reset(insert_stmt);
+    if(res != SQLITE_DONE){
+        log_message(LOG_ERROR, "StorageMgr", "INSERT FAILED: %s\n", sqlite3_errmsg(conn));
+        return -1;
+    }
+#ifdef DEBUG
+    printf(BLUE_CLR "DB: INSERTED %d %f %ld %ld\n" OFF_CLR, id, value, ts, time(NULL));
+#endif
+    return 0;
 }
 
 int insert_sensor_from_file(DBCONN* conn, FILE* sensor_data){
@@ -218,19 +255,8 @@ void sensor_close_threads(){
 	*connmgr_working = false;
 	pthread_rwlock_unlock(connmgr_lock);
 
-	// lock the mutex
-	pthread_mutex_lock(datamgr_lock);
-	pthread_mutex_lock(db_lock);
-
-	// update the number of data in the buffer
-	(*data_mgr) = -1;
-	(*data_sensor_db) = -1;
-
-	// unlock the mutex
-	pthread_mutex_unlock(datamgr_lock);
-	pthread_mutex_unlock(db_lock);
-	
 	// notify the threads
-	pthread_cond_broadcast(db_cond);
-	pthread_cond_broadcast(data_cond);
+	notifier_close(datamgr_notify);
+	notifier_close(db_notify);
+	notifier_close(stream_notify);
 }
\ No newline at end of file
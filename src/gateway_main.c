@@ -23,8 +23,15 @@
 #include "tcpsock.h"
 #include "dplist.h"
 #include "logger.h"
-
-#define MAIN_PROCESS_THREAD_NR 3
+#include "latest_table.h"
+#include "sensor_history.h"
+#include "sensor_map.h"
+#include "stream_manager.h"
+#include "alert_rules.h"
+#include "slab.h"
+#include "thread_placement.h"
+
+#define MAIN_PROCESS_THREAD_NR 5
 // define as 1 to drop existing table, 0 to keep existing table
 #define DB_FLAG 0
 
@@ -32,18 +39,18 @@
 void* connmgr_th(void* arg);
 void* datamgr_th(void* arg);
 void* sensor_db_th(void* arg);
+void* streammgr_th(void* arg);
+void* mapwatch_th(void* arg);
 
 int print_help();
+void* main_sock_alloc(size_t size);
+void main_sock_release(void* socket);
 void handle_signal(int sig, siginfo_t *siginfo, void *context);
 void cleanup_and_exit();
 // thread variables
-pthread_cond_t data_cond;
-pthread_mutex_t datamgr_lock;
-int* data_mgr;
-
-pthread_cond_t db_cond;
-pthread_mutex_t db_lock;
-int* data_sensor_db;
+notifier_t datamgr_notify;
+notifier_t db_notify;
+notifier_t stream_notify;
 
 pthread_rwlock_t connmgr_lock;
 bool* connmgr_working;
@@ -54,11 +61,12 @@ pthread_mutex_t log_mutex = PTHREAD_MUTEX_INITIALIZER;
 int* fifo_fd = 0;
 int log_sequence_number = 0;
 
-static atomic_bool stop_requested = false;
 // create the threads
 pthread_t threads[MAIN_PROCESS_THREAD_NR];
 
 sbuffer_t* buffer;
+// every accepted connection allocates a socket structure, they come from a slab
+slab_cache_t* sock_cache;
 
 int main(int argc, char* argv[]){
     // check if port_number arguments passed
@@ -66,19 +74,25 @@ int main(int argc, char* argv[]){
 
     //get the port number
     int port_number = atoi(argv[1]);
+    // the port of the live stream listener is optional
+    int stream_port = (argc > 2) ? atoi(argv[2]) : STREAM_PORT;
+    // the idle timeout of the connections is optional as well
+    if(argc > 3) connmgr_set_timeout(atoi(argv[3]));
+    // and so is the I/O backend of the connmgr
+    if(argc > 4 && connmgr_set_backend(argv[4]) != 0) return print_help();
+    // readings can also arrive as UDP datagrams
+    if(argc > 5) connmgr_set_udp_port(atoi(argv[5]));
  
 #ifdef DEBUG
     printf("INITIALIZING SENSOR GATEWAY\n");
 #endif
     
     // initialize all the variables
-    data_mgr = malloc(sizeof(int));
-    data_sensor_db = malloc(sizeof(int));
     connmgr_working = malloc(sizeof(bool));
 
-
-    *data_mgr = 0;
-	  *data_sensor_db = 0;
+    notifier_init(&datamgr_notify);
+    notifier_init(&db_notify);
+    notifier_init(&stream_notify);
 	  *connmgr_working = true;
  
       struct sigaction sa;
@@ -87,6 +101,7 @@ int main(int argc, char* argv[]){
       sa.sa_flags = SA_SIGINFO;
       sigaction(SIGINT, &sa, NULL);
       sigaction(SIGTERM, &sa, NULL);
+      sigaction(SIGHUP, &sa, NULL);
       
     if (sigaction(SIGINT, &sa, NULL) == -1) {
         printf("sigaction");
@@ -95,19 +110,35 @@ int main(int argc, char* argv[]){
     //init logger file
         logger_init("gateway.log");
         log_message(LOG_LEVEL_INFO, "GatewayMain", "Sensor Gateway started on port %d", port_number);
+    // the socket allocator is set before any thread opens a socket
+    sock_cache = slab_cache_create("tcpsock", tcp_sock_size());
+    if (sock_cache != NULL) tcp_set_allocator(main_sock_alloc, main_sock_release);
+
     // initialize the buffer
     if (sbuffer_init(&buffer) != SBUFFER_SUCCESS) {
         printf("[ERROR] Could not initialize shared buffer\n");
         exit(EXIT_FAILURE);
     }
 
-    // initialize the pthreads
-    pthread_cond_init(&data_cond, NULL);
-    pthread_mutex_init(&datamgr_lock, NULL);
-    
-    pthread_cond_init(&db_cond, NULL);
-    pthread_mutex_init(&db_lock, NULL);
+    // the sensor to room mapping and the sensor types are shared by all threads
+    FILE* fp_sensor_map = fopen(SENSOR_MAP_FILE, "r");
+    FILE* fp_type_map = fopen(TYPE_MAP_FILE, "r");
+    if (fp_type_map == NULL) {
+        printf("[WARNING] Could not read %s, room aggregates are disabled\n", TYPE_MAP_FILE);
+    }
+    if (sensor_map_init(fp_sensor_map, fp_type_map) != SENSOR_MAP_SUCCESS) {
+        printf("[ERROR] Could not read %s\n", SENSOR_MAP_FILE);
+        exit(EXIT_FAILURE);
+    }
+    fclose(fp_sensor_map);
+    if (fp_type_map != NULL) fclose(fp_type_map);
 
+    // the threads place themselves when they start, the file is optional
+    FILE* fp_placement = fopen(PLACEMENT_MAP_FILE, "r");
+    placement_load(fp_placement);
+    if (fp_placement != NULL) fclose(fp_placement);
+
+    // initialize the pthreads
     pthread_rwlock_init(&connmgr_lock, NULL);    
     pthread_mutex_init(&fifo_mutex, NULL);
 
@@ -117,12 +148,31 @@ int main(int argc, char* argv[]){
 
     // connmgr thread
     pthread_create(&threads[0], NULL, &connmgr_th, &port_number);
+    // after a takeover the old gateway saved its snapshot and stopped writing the shared memory, the readers continue from there
+    bool took_over = connmgr_wait_started();
+
+    // initialize the shared memory table with the latest state of every sensor
+    if (latest_table_init(took_over) != LATEST_SUCCESS) {
+        printf("[ERROR] Could not initialize latest value table\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // initialize the in-memory history of recent readings
+    if (history_init(HISTORY_DEPTH, HISTORY_SENSORS, took_over) != HISTORY_SUCCESS) {
+        printf("[ERROR] Could not initialize sensor history\n");
+        exit(EXIT_FAILURE);
+    }
+
     // database thread
     READ_TH_ENUM DBT = DB_THREAD;
     pthread_create(&threads[1], NULL, &sensor_db_th, &DBT);
     // datamgr thread
     READ_TH_ENUM DMT = DATAMGR_THREAD;
     pthread_create(&threads[2], NULL, &datamgr_th, &DMT);
+    // streammgr thread
+    pthread_create(&threads[3], NULL, &streammgr_th, &stream_port);
+    // reloads the sensor map when it changes
+    pthread_create(&threads[4], NULL, &mapwatch_th, NULL);
 
     // join all the threads after they are done
     for(int i = 0; i < MAIN_PROCESS_THREAD_NR; i++)
@@ -133,15 +183,31 @@ int main(int argc, char* argv[]){
 #endif
 
     // destroy the threads
-    pthread_cond_destroy(&data_cond);
-    pthread_mutex_destroy(&datamgr_lock);
-    
-    pthread_cond_destroy(&db_cond);
-    pthread_mutex_destroy(&db_lock);
-
     pthread_rwlock_destroy(&connmgr_lock);    
     pthread_mutex_destroy(&fifo_mutex);
 
+    // allocation counters of the hot path objects, the same as slab_dump_stats but in every build
+    slab_stats_t slab_stats;
+    for(int i = 0; i < SLAB_CACHES_MAX; i++){
+        if(slab_get_stats(i, &slab_stats) != SLAB_SUCCESS) continue;
+        log_message(LOG_LEVEL_INFO, "GatewayMain", "SLAB %s (%zu BYTES): ALLOCS %llu FREES %llu IN USE %llu BLOCKS %llu DEPOT TRIPS %llu",
+                    slab_stats.name, slab_stats.object_size, (unsigned long long) slab_stats.allocs,
+                    (unsigned long long) slab_stats.frees, (unsigned long long) (slab_stats.allocs - slab_stats.frees),
+                    (unsigned long long) slab_stats.blocks, (unsigned long long) slab_stats.depot_trips);
+    }
+
+    // a wakeup is a system call of the connmgr, it is only made when a reader thread was parked
+    log_message(LOG_LEVEL_INFO, "GatewayMain", "WAKEUPS DATAMGR %llu DB %llu STREAM %llu",
+                (unsigned long long) datamgr_notify.wakeups, (unsigned long long) db_notify.wakeups,
+                (unsigned long long) stream_notify.wakeups);
+
+    // readings that were still pending when a reader reached the drain deadline are lost
+    log_message(LOG_LEVEL_INFO, "GatewayMain", "DRAINED DATAMGR %d DB %d STREAM %d, DROPPED DATAMGR %d DB %d STREAM %d",
+                atomic_load(&datamgr_notify.drained), atomic_load(&db_notify.drained), atomic_load(&stream_notify.drained),
+                notifier_pending(&datamgr_notify) > 0 ? notifier_pending(&datamgr_notify) : 0,
+                notifier_pending(&db_notify) > 0 ? notifier_pending(&db_notify) : 0,
+                notifier_pending(&stream_notify) > 0 ? notifier_pending(&stream_notify) : 0);
+
     log_message(LOG_LEVEL_INFO, "GatewayMain", "CLOSING SENSOR GATEWAY");
     cleanup_and_exit();
 
@@ -153,13 +219,9 @@ int main(int argc, char* argv[]){
 }
 
 void main_init_thread(config_thread_t* config_thread){
-    config_thread->data_cond = &data_cond;
-    config_thread->datamgr_lock = &datamgr_lock;
-    config_thread->data_mgr = data_mgr;
-    
-    config_thread->db_cond = &db_cond;
-    config_thread->db_lock = &db_lock;
-    config_thread->data_sensor_db = data_sensor_db;
+    config_thread->datamgr_notify = &datamgr_notify;
+    config_thread->db_notify = &db_notify;
+    config_thread->stream_notify = &stream_notify;
 
     config_thread->connmgr_lock = &connmgr_lock;
     config_thread->connmgr_working = connmgr_working;
@@ -170,12 +232,14 @@ void main_init_thread(config_thread_t* config_thread){
 }
 
 void* connmgr_th(void* arg){
+    placement_apply("connmgr");
     int port_number = *((int*) arg);
     config_thread_t connmgr_config_thread;
     main_init_thread(&connmgr_config_thread);
 
     connmgr_init(&connmgr_config_thread);
     connmgr_listen(port_number, &buffer);
+    slab_thread_flush();
 
 #ifdef DEBUG
     printf(RED_CLR"CLOSING CONNMGR_THR\n"OFF_CLR);
@@ -184,15 +248,15 @@ void* connmgr_th(void* arg){
 }
 
 void* datamgr_th(void* arg){
-    FILE* fp_sensor_map = fopen("room_sensor.map", "r");
+    placement_apply("datamgr");
     config_thread_t datamgr_config_thread;
     main_init_thread(&datamgr_config_thread);
 
     datamgr_init(&datamgr_config_thread);
-    datamgr_parse_sensor_files(fp_sensor_map, &buffer);
+    datamgr_parse_sensor_files(&buffer);
     datamgr_free();
-    fclose(fp_sensor_map);
-    
+    slab_thread_flush();
+
 #ifdef DEBUG
     printf(RED_CLR"CLOSING DATAMGR_THR\n"OFF_CLR);
 #endif
@@ -200,6 +264,7 @@ void* datamgr_th(void* arg){
 }
 
 void* sensor_db_th(void* arg){
+    placement_apply("db");
     // initialize the variables for the sensor_db thread
     config_thread_t sensor_db_config_thread;
     main_init_thread(&sensor_db_config_thread);
@@ -208,25 +273,70 @@ void* sensor_db_th(void* arg){
     DBCONN* conn = init_connection(DB_FLAG);
     sensor_db_listen(conn, &buffer);
     disconnect(conn);
+    slab_thread_flush();
 #ifdef DEBUG
     printf(RED_CLR"CLOSING DB_THR\n"OFF_CLR);
 #endif
     return NULL;
 }
 
+void* streammgr_th(void* arg){
+    placement_apply("streammgr");
+    int port_number = *((int*) arg);
+    config_thread_t streammgr_config_thread;
+    main_init_thread(&streammgr_config_thread);
+
+    streammgr_init(&streammgr_config_thread);
+    streammgr_listen(port_number, &buffer);
+    slab_thread_flush();
+
+#ifdef DEBUG
+    printf(RED_CLR"CLOSING STREAMMGR_THR\n"OFF_CLR);
+#endif
+    return NULL;
+}
+
+void* mapwatch_th(void* arg){
+    placement_apply("mapwatch");
+    sensor_map_watch(connmgr_working);
+
+#ifdef DEBUG
+    printf(RED_CLR"CLOSING MAPWATCH_THR\n"OFF_CLR);
+#endif
+    return NULL;
+}
+
+void* main_sock_alloc(size_t size){
+    return (size <= tcp_sock_size()) ? slab_alloc(sock_cache) : NULL;
+}
+
+void main_sock_release(void* socket){
+    slab_free(sock_cache, socket);
+}
+
 int print_help(){
     printf("USE THIS PROGRAMME WITH A COMMAND LINE OPTION: \n");
     printf("\t%-15s : TCP SERVER PORT NUMBER\n", "\'SERVER PORT\'");
+    printf("\t%-15s : LIVE STREAM HTTP PORT NUMBER (OPTIONAL, DEFAULT %d)\n", "\'STREAM PORT\'", STREAM_PORT);
+    printf("\t%-15s : IDLE TIMEOUT IN SECONDS (OPTIONAL, DEFAULT %d)\n", "\'TIMEOUT\'", TIMEOUT);
+    printf("\t%-15s : auto, uring OR poll (OPTIONAL, DEFAULT auto)\n", "\'IO BACKEND\'");
+    printf("\t%-15s : UDP PORT FOR DATAGRAM SENSORS (OPTIONAL, DEFAULT 0: NO UDP)\n", "\'UDP PORT\'");
     return -1;
 }
 
 void cleanup_and_exit() {
     printf(RED_CLR"[INFO] Cleaning up resources...\n"OFF_CLR);
         // free the threads
-    free(data_mgr);
-    free(data_sensor_db);
     free(connmgr_working);
     logger_close();
+    // the new gateway writes the shared memory now, it is only unmapped here
+    if (connmgr_handed_over()) {
+        latest_table_disown();
+        history_disown();
+    }
+    latest_table_free();
+    sensor_map_free();
+    history_free();
     if (buffer != NULL) {
         sbuffer_free(&buffer);
     }
@@ -236,13 +346,15 @@ void cleanup_and_exit() {
 void handle_signal(int sig, siginfo_t *siginfo, void *context) {
     (void)siginfo;
     (void)context;
+    if (sig == SIGHUP) {
+        // the watcher thread reloads the sensor map and the datamgr the alert rules, nothing else may happen in the handler
+        sensor_map_request_reload();
+        alert_rules_request_reload();
+        return;
+    }
     if (sig == SIGINT || sig == SIGTERM) {
-        stop_requested = true;
-        log_message(LOG_LEVEL_INFO, "GatewayMain","Signal %d received. Stopping gracefully...\n", sig);
-        printf("\n[INFO] Signal %d received. Stopping gracefully...\n", sig);
-        for (int i = 0; i < MAIN_PROCESS_THREAD_NR; i++) {
-          pthread_cancel(threads[i]);  
-        }
+        // the connmgr stops at its next tick, the readers drain the buffer and every thread returns on its own
+        connmgr_request_stop();
     }
     
 }
\ No newline at end of file
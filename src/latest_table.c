@@ -0,0 +1,196 @@
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "config.h"
+#include "latest_table.h"
+#include "logger.h"
+
+#define LATEST_ROOM_OFFSET (sizeof(latest_header_t) + sizeof(latest_entry_t) * LATEST_CAPACITY)
+#define LATEST_SHM_SIZE (LATEST_ROOM_OFFSET + sizeof(latest_room_t) * LATEST_ROOM_CAPACITY)
+
+// the layout is read by other processes, it must not depend on the compiler or the platform
+_Static_assert(sizeof(latest_header_t) == 64, "latest_header_t must be 64 bytes");
+_Static_assert(sizeof(latest_entry_t) == 32, "latest_entry_t must be 32 bytes");
+_Static_assert(sizeof(latest_room_t) == 112, "latest_room_t must be 112 bytes");
+
+// global variables
+static latest_header_t* header = NULL;
+static latest_entry_t* entries = NULL;
+static latest_room_t* rooms = NULL;
+static bool owner = false;
+
+// helper methods
+static int latest_table_map(int fd, int prot);
+
+int latest_table_init(bool keep){
+    int fd = shm_open(LATEST_SHM_NAME, O_CREAT | O_RDWR, 0644);
+    if(fd == -1){
+        log_message(LOG_ERROR, "LatestTable", "CANNOT CREATE SHARED MEMORY %s", LATEST_SHM_NAME);
+        return LATEST_FAILURE;
+    }
+    struct stat st;
+    if(fstat(fd, &st) == -1 || (st.st_size != LATEST_SHM_SIZE && ftruncate(fd, LATEST_SHM_SIZE) == -1) ||
+       latest_table_map(fd, PROT_READ | PROT_WRITE) != LATEST_SUCCESS){
+        close(fd);
+        shm_unlink(LATEST_SHM_NAME);
+        return LATEST_FAILURE;
+    }
+    close(fd);
+    owner = true;
+
+    // the segment of the gateway this one took over from is written on, readers keep their mapping
+    if(keep && st.st_size == LATEST_SHM_SIZE && header->magic == LATEST_MAGIC && header->version == LATEST_VERSION &&
+       header->entry_size == sizeof(latest_entry_t) && header->room_entry_size == sizeof(latest_room_t)){
+        log_message(LOG_LEVEL_INFO, "LatestTable", "KEPT SHARED MEMORY %s OF THE PREVIOUS GATEWAY", LATEST_SHM_NAME);
+        return LATEST_SUCCESS;
+    }
+
+    // a segment left behind by a previous gateway is reset, the sequence numbers start over
+    header->magic = 0;
+    atomic_thread_fence(memory_order_release);
+    memset(entries, 0, LATEST_SHM_SIZE - sizeof(latest_header_t));
+    header->header_size = sizeof(latest_header_t);
+    header->entry_size = sizeof(latest_entry_t);
+    header->capacity = LATEST_CAPACITY;
+    header->room_offset = LATEST_ROOM_OFFSET;
+    header->room_entry_size = sizeof(latest_room_t);
+    header->room_capacity = LATEST_ROOM_CAPACITY;
+    header->version = LATEST_VERSION;
+    atomic_thread_fence(memory_order_release);
+    header->magic = LATEST_MAGIC;
+
+#ifdef DEBUG
+    printf(CYAN_CLR "LATEST: SHARED MEMORY %s CREATED.\n" OFF_CLR, LATEST_SHM_NAME);
+#endif
+    return LATEST_SUCCESS;
+}
+
+int latest_table_attach(){
+    int fd = shm_open(LATEST_SHM_NAME, O_RDONLY, 0);
+    if(fd == -1) return LATEST_FAILURE;
+    struct stat st;
+    if(fstat(fd, &st) == -1 || st.st_size != LATEST_SHM_SIZE){
+        close(fd);
+        return LATEST_FAILURE;
+    }
+    int res = latest_table_map(fd, PROT_READ);
+    close(fd);
+    if(res != LATEST_SUCCESS) return LATEST_FAILURE;
+
+    if(header->magic != LATEST_MAGIC || header->version != LATEST_VERSION ||
+       header->entry_size != sizeof(latest_entry_t) || header->room_entry_size != sizeof(latest_room_t)){
+        latest_table_free();
+        return LATEST_FAILURE;
+    }
+    return LATEST_SUCCESS;
+}
+
+void latest_table_publish(sensor_id_t sensor_id, room_id_t room_id, sensor_value_t value,
+                          sensor_value_t running_avg, sensor_ts_t ts){
+    if(entries == NULL || !owner) return;
+    latest_entry_t* entry = &entries[sensor_id];
+
+    // make the sequence odd before touching the data, readers will retry
+    uint32_t seq = atomic_load_explicit(&entry->seq, memory_order_relaxed);
+    atomic_store_explicit(&entry->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    entry->sensor_id = sensor_id;
+    entry->room_id = room_id;
+    entry->value = value;
+    entry->running_avg = running_avg;
+    entry->ts = (int64_t) ts;
+
+    // even again: the entry is consistent
+    atomic_store_explicit(&entry->seq, seq + 2, memory_order_release);
+}
+
+void latest_table_publish_room(room_id_t room_id, const latest_room_stat_t stats[SENSOR_TYPE_NR], sensor_ts_t ts){
+    if(rooms == NULL || !owner || room_id >= LATEST_ROOM_CAPACITY) return;
+    latest_room_t* room = &rooms[room_id];
+
+    uint32_t seq = atomic_load_explicit(&room->seq, memory_order_relaxed);
+    atomic_store_explicit(&room->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    room->room_id = room_id;
+    room->ts = (int64_t) ts;
+    memcpy(room->types, stats, sizeof(room->types));
+
+    atomic_store_explicit(&room->seq, seq + 2, memory_order_release);
+}
+
+int latest_table_read(sensor_id_t sensor_id, latest_entry_t* entry){
+    if(entries == NULL) return LATEST_FAILURE;
+    latest_entry_t* src = &entries[sensor_id];
+
+    uint32_t before, after = 0;
+    do{
+        before = atomic_load_explicit(&src->seq, memory_order_acquire);
+        if(before & 1) continue;
+
+        entry->sensor_id = src->sensor_id;
+        entry->room_id = src->room_id;
+        entry->value = src->value;
+        entry->running_avg = src->running_avg;
+        entry->ts = src->ts;
+
+        atomic_thread_fence(memory_order_acquire);
+        after = atomic_load_explicit(&src->seq, memory_order_relaxed);
+    }while((before & 1) || before != after);
+
+    atomic_store_explicit(&entry->seq, before, memory_order_relaxed);
+    return (before == 0) ? LATEST_NO_DATA : LATEST_SUCCESS;
+}
+
+int latest_table_read_room(room_id_t room_id, latest_room_t* room){
+    if(rooms == NULL) return LATEST_FAILURE;
+    if(room_id >= LATEST_ROOM_CAPACITY) return LATEST_NO_DATA;
+    latest_room_t* src = &rooms[room_id];
+
+    uint32_t before, after = 0;
+    do{
+        before = atomic_load_explicit(&src->seq, memory_order_acquire);
+        if(before & 1) continue;
+
+        room->room_id = src->room_id;
+        room->ts = src->ts;
+        memcpy(room->types, src->types, sizeof(room->types));
+
+        atomic_thread_fence(memory_order_acquire);
+        after = atomic_load_explicit(&src->seq, memory_order_relaxed);
+    }while((before & 1) || before != after);
+
+    atomic_store_explicit(&room->seq, before, memory_order_relaxed);
+    return (before == 0) ? LATEST_NO_DATA : LATEST_SUCCESS;
+}
+
+void latest_table_disown(){
+    owner = false;
+}
+
+void latest_table_free(){
+    // readers that still have the segment mapped see the magic disappear and detach
+    if(owner && header != NULL) header->magic = 0;
+    if(header != NULL) munmap(header, LATEST_SHM_SIZE);
+    if(owner) shm_unlink(LATEST_SHM_NAME);
+    header = NULL;
+    entries = NULL;
+    rooms = NULL;
+    owner = false;
+}
+
+static int latest_table_map(int fd, int prot){
+    void* addr = mmap(NULL, LATEST_SHM_SIZE, prot, MAP_SHARED, fd, 0);
+    if(addr == MAP_FAILED) return LATEST_FAILURE;
+    header = (latest_header_t*) addr;
+    entries = (latest_entry_t*) ((char*) addr + sizeof(latest_header_t));
+    rooms = (latest_room_t*) ((char*) addr + LATEST_ROOM_OFFSET);
+    return LATEST_SUCCESS;
+}
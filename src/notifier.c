@@ -0,0 +1,94 @@
+#define _GNU_SOURCE
+
+#include <stdint.h>
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include "notifier.h"
+
+// helper methods
+static void notifier_wake(notifier_t* notifier);
+static inline void notifier_relax();
+static uint64_t notifier_clock();
+
+void notifier_init(notifier_t* notifier){
+    atomic_init(&(notifier->pending), 0);
+    atomic_init(&(notifier->sleepers), 0);
+    atomic_init(&(notifier->futex), 0);
+    atomic_init(&(notifier->closed), false);
+    atomic_init(&(notifier->closed_at), 0);
+    atomic_init(&(notifier->drained), 0);
+    atomic_init(&(notifier->wakeups), 0);
+}
+
+void notifier_post(notifier_t* notifier, int count){
+    atomic_fetch_add(&(notifier->pending), count);
+    // a consumer that parks after this load sees the new items before it sleeps
+    if(atomic_load(&(notifier->sleepers)) > 0) notifier_wake(notifier);
+}
+
+int notifier_wait(notifier_t* notifier){
+    int pending;
+    // a busy consumer usually finds new items while spinning
+    for(int spin = 0; spin < NOTIFIER_SPIN; spin++){
+        if((pending = notifier_pending(notifier)) != 0) return pending;
+        notifier_relax();
+    }
+
+    struct timespec park = {NOTIFIER_PARK_MS / 1000, (NOTIFIER_PARK_MS % 1000) * 1000000L};
+    atomic_fetch_add(&(notifier->sleepers), 1);
+    for(;;){
+        // read the futex word before the last check, a post in between changes it and the wait returns at once
+        unsigned int word = atomic_load(&(notifier->futex));
+        if((pending = notifier_pending(notifier)) != 0) break;
+        syscall(SYS_futex, &(notifier->futex), FUTEX_WAIT_PRIVATE, word, &park, NULL, 0);
+    }
+    atomic_fetch_sub(&(notifier->sleepers), 1);
+    return pending;
+}
+
+int notifier_pending(notifier_t* notifier){
+    int pending = atomic_load(&(notifier->pending));
+    if(pending > 0) return pending;
+    return atomic_load(&(notifier->closed)) ? NOTIFIER_CLOSED : 0;
+}
+
+void notifier_take(notifier_t* notifier, int count){
+    atomic_fetch_sub(&(notifier->pending), count);
+    if(atomic_load(&(notifier->closed))) atomic_fetch_add(&(notifier->drained), count);
+}
+
+void notifier_close(notifier_t* notifier){
+    // closing twice does not move the deadline
+    if(!atomic_exchange(&(notifier->closed), true)) atomic_store(&(notifier->closed_at), notifier_clock());
+    notifier_wake(notifier);
+}
+
+bool notifier_expired(notifier_t* notifier){
+    if(!atomic_load(&(notifier->closed))) return false;
+    // the closing thread may not have stored the time yet
+    uint64_t closed_at = atomic_load(&(notifier->closed_at));
+    return closed_at != 0 && notifier_clock() - closed_at > NOTIFIER_DRAIN_MS;
+}
+
+static void notifier_wake(notifier_t* notifier){
+    atomic_fetch_add(&(notifier->futex), 1);
+    atomic_fetch_add_explicit(&(notifier->wakeups), 1, memory_order_relaxed);
+    syscall(SYS_futex, &(notifier->futex), FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+}
+
+static uint64_t notifier_clock(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static inline void notifier_relax(){
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    __asm__ __volatile__("yield");
+#endif
+}
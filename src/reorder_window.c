@@ -0,0 +1,219 @@
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "config.h"
+#include "logger.h"
+#include "timer_wheel.h"
+#include "reorder_window.h"
+
+// records in the arrival queue at the start (a power of 2)
+#define REORDER_QUEUE_CAPACITY 1024
+
+// the readings of one sensor that wait, sorted by time with the oldest first; the caller owns their memory
+typedef struct {
+    sensor_data_t* held[REORDER_WINDOW_SIZE];
+    int count;
+    int early;                          /** < arrivals in the queue whose reading left early because the window was full */
+    sensor_time_t released;             /** < the time of the last released reading */
+    bool skewed;                        /** < the last timestamp was replaced, logged when it changes */
+} reorder_sensor_t;
+
+// a reading that arrived, in the order of arrival
+typedef struct {
+    uint64_t due;                       /** < timer_wheel_clock at which a reading of the sensor is released */
+    sensor_id_t sensor_id;
+} reorder_arrival_t;
+
+struct reorder_window {
+    int delay_ms;
+    reorder_sensor_t** sensors;         /** < indexed by sensor id, allocated when the sensor sends its first reading */
+    reorder_arrival_t* queue;           /** < circular */
+    int queue_head;
+    int queue_count;
+    int queue_capacity;
+    reorder_stats_t stats;
+};
+
+// helper methods
+static reorder_sensor_t* reorder_sensor(reorder_window_t* window, sensor_id_t sensor_id);
+static bool reorder_validate(reorder_window_t* window, sensor_data_t* data);
+static int reorder_push(reorder_window_t* window, sensor_id_t sensor_id);
+static int reorder_pop(reorder_window_t* window, uint64_t now, bool all, reorder_release_fn release, void* arg);
+static void reorder_release_oldest(reorder_sensor_t* sensor, reorder_release_fn release, void* arg);
+static sensor_time_t reorder_clock();
+
+int reorder_init(reorder_window_t** window, int delay_ms){
+    *window = calloc(1, sizeof(reorder_window_t));
+    if(*window == NULL) return REORDER_FAILURE;
+
+    (*window)->delay_ms = delay_ms;
+    (*window)->sensors = calloc(65536, sizeof(reorder_sensor_t*));
+    (*window)->queue = malloc(REORDER_QUEUE_CAPACITY * sizeof(reorder_arrival_t));
+    (*window)->queue_capacity = REORDER_QUEUE_CAPACITY;
+    if((*window)->sensors == NULL || (*window)->queue == NULL){
+        reorder_free(window);
+        return REORDER_FAILURE;
+    }
+    return REORDER_SUCCESS;
+}
+
+void reorder_add(reorder_window_t* window, sensor_data_t* data, reorder_release_fn release, void* arg){
+    bool trusted = reorder_validate(window, data);
+    reorder_sensor_t* sensor = reorder_sensor(window, data->id);
+
+    if(sensor != NULL && sensor->skewed == trusted){
+        sensor->skewed = !trusted;
+        if(trusted) log_message(LOG_LEVEL_INFO, "ReorderWindow", "Sensor %d sends valid timestamps again", data->id);
+        else log_message(LOG_WARNING, "ReorderWindow", "Sensor %d sends timestamps the local clock does not trust, the time of arrival is used", data->id);
+    }
+
+    // without memory for the window a reading goes on unordered
+    if(window->delay_ms == 0 || sensor == NULL){
+        release(data, arg);
+        return;
+    }
+
+    // a later reading of the sensor was released already, this one can not be put in order any more
+    if(data->time < sensor->released){
+        window->stats.late++;
+        release(data, arg);
+        return;
+    }
+
+    if(sensor->count == REORDER_WINDOW_SIZE){
+        // older than everything that waits, so it is next in order anyway
+        if(data->time < sensor->held[0]->time){
+            sensor->released = data->time;
+            release(data, arg);
+            return;
+        }
+        // the oldest reading leaves early, its record in the queue is skipped later
+        reorder_release_oldest(sensor, release, arg);
+        sensor->early++;
+    }
+
+    if(reorder_push(window, data->id) != REORDER_SUCCESS){
+        release(data, arg);
+        return;
+    }
+
+    // readings with the same time keep the order of arrival
+    int position = sensor->count;
+    while(position > 0 && sensor->held[position - 1]->time > data->time){
+        sensor->held[position] = sensor->held[position - 1];
+        position--;
+    }
+    sensor->held[position] = data;
+    if(position != sensor->count) window->stats.reordered++;
+    sensor->count++;
+}
+
+int reorder_release(reorder_window_t* window, reorder_release_fn release, void* arg){
+    if(window->queue_count == 0) return 0;
+    return reorder_pop(window, timer_wheel_clock(), false, release, arg);
+}
+
+int reorder_flush(reorder_window_t* window, reorder_release_fn release, void* arg){
+    return reorder_pop(window, 0, true, release, arg);
+}
+
+int reorder_next_ms(reorder_window_t* window){
+    if(window->queue_count == 0) return -1;
+    uint64_t now = timer_wheel_clock();
+    uint64_t due = window->queue[window->queue_head].due;
+    return due > now ? (int) (due - now) : 0;
+}
+
+reorder_stats_t reorder_get_stats(reorder_window_t* window){
+    return window->stats;
+}
+
+void reorder_free(reorder_window_t** window){
+    if(*window == NULL) return;
+    if((*window)->sensors != NULL){
+        for(int id = 0; id < 65536; id++) free((*window)->sensors[id]);
+        free((*window)->sensors);
+    }
+    free((*window)->queue);
+    free(*window);
+    *window = NULL;
+}
+
+static reorder_sensor_t* reorder_sensor(reorder_window_t* window, sensor_id_t sensor_id){
+    if(window->sensors[sensor_id] == NULL) window->sensors[sensor_id] = calloc(1, sizeof(reorder_sensor_t));
+    return window->sensors[sensor_id];
+}
+
+// replaces a timestamp that is too far from the local clock, returns false if it did
+static bool reorder_validate(reorder_window_t* window, sensor_data_t* data){
+    // the wire format only carries whole seconds
+    if(data->time == 0) data->time = (sensor_time_t) data->ts * SENSOR_TIME_SECOND;
+
+    sensor_time_t now = reorder_clock();
+    bool trusted = data->time <= now + REORDER_MAX_AHEAD_MS * 1000LL
+                   && data->time >= now - REORDER_MAX_AGE_S * SENSOR_TIME_SECOND;
+    if(!trusted){
+        data->time = now;
+        window->stats.corrected++;
+    }
+    data->ts = (sensor_ts_t) (data->time / SENSOR_TIME_SECOND);
+    return trusted;
+}
+
+static int reorder_push(reorder_window_t* window, sensor_id_t sensor_id){
+    if(window->queue_count == window->queue_capacity){
+        reorder_arrival_t* queue = malloc(2 * window->queue_capacity * sizeof(reorder_arrival_t));
+        if(queue == NULL) return REORDER_FAILURE;
+        // unwrap the circle at the start of the new queue
+        int first = window->queue_capacity - window->queue_head;
+        memcpy(queue, &(window->queue[window->queue_head]), first * sizeof(reorder_arrival_t));
+        memcpy(&(queue[first]), window->queue, window->queue_head * sizeof(reorder_arrival_t));
+        free(window->queue);
+        window->queue = queue;
+        window->queue_head = 0;
+        window->queue_capacity *= 2;
+    }
+
+    int tail = (window->queue_head + window->queue_count) & (window->queue_capacity - 1);
+    window->queue[tail].due = timer_wheel_clock() + window->delay_ms;
+    window->queue[tail].sensor_id = sensor_id;
+    window->queue_count++;
+    return REORDER_SUCCESS;
+}
+
+// every arrival that is due releases the oldest reading of its sensor, unless that one left early
+static int reorder_pop(reorder_window_t* window, uint64_t now, bool all, reorder_release_fn release, void* arg){
+    int released = 0;
+    while(window->queue_count > 0){
+        reorder_arrival_t* arrival = &(window->queue[window->queue_head]);
+        if(!all && arrival->due > now) break;
+
+        reorder_sensor_t* sensor = window->sensors[arrival->sensor_id];
+        window->queue_head = (window->queue_head + 1) & (window->queue_capacity - 1);
+        window->queue_count--;
+
+        if(sensor->early > 0){
+            sensor->early--;
+            continue;
+        }
+        reorder_release_oldest(sensor, release, arg);
+        released++;
+    }
+    return released;
+}
+
+static void reorder_release_oldest(reorder_sensor_t* sensor, reorder_release_fn release, void* arg){
+    sensor_data_t* data = sensor->held[0];
+    sensor->count--;
+    memmove(&(sensor->held[0]), &(sensor->held[1]), sensor->count * sizeof(sensor_data_t*));
+    sensor->released = data->time;
+    release(data, arg);
+}
+
+static sensor_time_t reorder_clock(){
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (sensor_time_t) ts.tv_sec * SENSOR_TIME_SECOND + ts.tv_nsec / 1000;
+}
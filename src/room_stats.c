@@ -0,0 +1,183 @@
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <stdio.h>
+#include "config.h"
+#include "sensor_map.h"
+#include "latest_table.h"
+#include "room_stats.h"
+
+typedef struct {
+    uint32_t count;             // members that reported at least once
+    sensor_value_t sum;         // sum of the latest value of the reporting members
+    sensor_value_t min;
+    sensor_value_t max;
+    sensor_id_t* members;       // all sensors of this type in the room
+    int member_count;
+} room_type_agg_t;
+
+typedef struct {
+    room_type_agg_t types[SENSOR_TYPE_NR];
+} room_agg_t;
+
+// helper methods
+static int room_stats_build();
+static void room_stats_free_rooms();
+static void room_stats_rescan(room_type_agg_t* agg);
+static void room_stats_publish(room_id_t room_id, room_agg_t* room, sensor_ts_t ts);
+
+// global variables
+static room_agg_t** rooms = NULL;              // indexed by room id, NULL if the room has no sensors
+static sensor_value_t* last_value = NULL;      // latest value of every sensor, indexed by sensor id
+static bool* reported = NULL;
+
+int room_stats_init(){
+    rooms = calloc(65536, sizeof(room_agg_t*));
+    last_value = calloc(65536, sizeof(sensor_value_t));
+    reported = calloc(65536, sizeof(bool));
+    if(rooms == NULL || last_value == NULL || reported == NULL){
+        room_stats_free();
+        return ROOM_STATS_FAILURE;
+    }
+    return room_stats_build();
+}
+
+int room_stats_reload(sensor_ts_t ts){
+    if(rooms == NULL) return ROOM_STATS_FAILURE;
+
+    // rooms that lost all their sensors publish empty aggregates
+    bool* published = calloc(65536, sizeof(bool));
+    if(published == NULL) return ROOM_STATS_FAILURE;
+    for(int id = 0; id < 65536; id++) published[id] = (rooms[id] != NULL);
+
+    room_stats_free_rooms();
+    int res = room_stats_build();
+
+    for(int id = 0; id < 65536; id++){
+        if(rooms[id] != NULL){
+            for(int type = 0; type < SENSOR_TYPE_NR; type++){
+                room_type_agg_t* agg = &(rooms[id]->types[type]);
+                agg->count = 0;
+                for(int i = 0; i < agg->member_count; i++) if(reported[agg->members[i]]) agg->count++;
+                if(agg->count > 0) room_stats_rescan(agg);
+            }
+            room_stats_publish(id, rooms[id], ts);
+        }
+        else if(published[id]){
+            latest_room_stat_t empty[SENSOR_TYPE_NR] = {0};
+            latest_table_publish_room(id, empty, ts);
+        }
+    }
+    free(published);
+    return res;
+}
+
+static int room_stats_build(){
+    for(int id = 0; id < 65536; id++){
+        room_id_t room_id = sensor_map_get_room(id);
+        sensor_type_t type = sensor_map_get_type(id);
+        if(room_id == 0 || type == SENSOR_UNKNOWN) continue;
+
+        if(rooms[room_id] == NULL) rooms[room_id] = calloc(1, sizeof(room_agg_t));
+        if(rooms[room_id] == NULL) return ROOM_STATS_FAILURE;
+
+        room_type_agg_t* agg = &(rooms[room_id]->types[type]);
+        sensor_id_t* members = realloc(agg->members, (agg->member_count + 1) * sizeof(sensor_id_t));
+        if(members == NULL) return ROOM_STATS_FAILURE;
+        members[agg->member_count++] = id;
+        agg->members = members;
+    }
+    return ROOM_STATS_SUCCESS;
+}
+
+void room_stats_update(sensor_id_t sensor_id, sensor_value_t value, sensor_ts_t ts){
+    if(rooms == NULL) return;
+    room_id_t room_id = sensor_map_get_room(sensor_id);
+    sensor_type_t type = sensor_map_get_type(sensor_id);
+    if(rooms[room_id] == NULL || type == SENSOR_UNKNOWN) return;
+    room_type_agg_t* agg = &(rooms[room_id]->types[type]);
+
+    sensor_value_t old = last_value[sensor_id];
+    last_value[sensor_id] = value;
+
+    if(!reported[sensor_id]){
+        // first reading of this sensor: one more reporting member
+        reported[sensor_id] = true;
+        agg->sum += value;
+        if(agg->count == 0 || value < agg->min) agg->min = value;
+        if(agg->count == 0 || value > agg->max) agg->max = value;
+        agg->count++;
+    }
+    else{
+        agg->sum += value - old;
+        bool rescan = false;
+
+        // only when the sensor holding the extreme moved inwards the new extreme is unknown
+        if(value <= agg->min) agg->min = value;
+        else if(old == agg->min) rescan = true;
+        if(value >= agg->max) agg->max = value;
+        else if(old == agg->max) rescan = true;
+
+        if(rescan) room_stats_rescan(agg);
+    }
+    room_stats_publish(room_id, rooms[room_id], ts);
+}
+
+int room_stats_get(room_id_t room_id, sensor_type_t type, latest_room_stat_t* stat){
+    if(rooms == NULL || rooms[room_id] == NULL || type == SENSOR_UNKNOWN) return ROOM_STATS_NO_DATA;
+    room_type_agg_t* agg = &(rooms[room_id]->types[type]);
+    if(agg->count == 0) return ROOM_STATS_NO_DATA;
+
+    stat->count = agg->count;
+    stat->mean = agg->sum / agg->count;
+    stat->min = agg->min;
+    stat->max = agg->max;
+    return ROOM_STATS_SUCCESS;
+}
+
+void room_stats_free(){
+    if(rooms != NULL) room_stats_free_rooms();
+    free(rooms);
+    free(last_value);
+    free(reported);
+    rooms = NULL;
+    last_value = NULL;
+    reported = NULL;
+}
+
+static void room_stats_free_rooms(){
+    for(int id = 0; id < 65536; id++){
+        if(rooms[id] == NULL) continue;
+        for(int type = 0; type < SENSOR_TYPE_NR; type++) free(rooms[id]->types[type].members);
+        free(rooms[id]);
+        rooms[id] = NULL;
+    }
+}
+
+static void room_stats_rescan(room_type_agg_t* agg){
+    // recompute the sum as well, this also drops the rounding errors of the incremental updates
+    bool first = true;
+    agg->sum = 0;
+    for(int i = 0; i < agg->member_count; i++){
+        sensor_id_t id = agg->members[i];
+        if(!reported[id]) continue;
+        sensor_value_t value = last_value[id];
+        agg->sum += value;
+        if(first || value < agg->min) agg->min = value;
+        if(first || value > agg->max) agg->max = value;
+        first = false;
+    }
+}
+
+static void room_stats_publish(room_id_t room_id, room_agg_t* room, sensor_ts_t ts){
+    latest_room_stat_t stats[SENSOR_TYPE_NR] = {0};
+    for(int type = 0; type < SENSOR_TYPE_NR; type++){
+        room_type_agg_t* agg = &(room->types[type]);
+        if(agg->count == 0) continue;
+        stats[type].count = agg->count;
+        stats[type].mean = agg->sum / agg->count;
+        stats[type].min = agg->min;
+        stats[type].max = agg->max;
+    }
+    latest_table_publish_room(room_id, stats, ts);
+}
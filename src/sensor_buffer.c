@@ -3,34 +3,40 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <stddef.h>
 #include <pthread.h>
 #include "sensor_buffer.h"
 #include "config.h"
+#include "slab.h"
 
-#define READ true
-#define UNREAD false
  // basic node for the buffer, these nodes are linked together to create the buffer
 typedef struct sbuffer_node {
     struct sbuffer_node* next;      // a pointer to the next node
-    sensor_data_t data;             // a structure containing the data
-    bool reader_threads[THREAD_NR]; // check which threads have read the data
+    sensor_data_t data;             // a structure containing the data, it is written in place between reserve and commit
+    int unreleased;                 // the number of reader threads that have not released the data yet
 } sbuffer_node_t;
 
 // a structure to keep track of the buffer
 struct sbuffer {
     sbuffer_node_t* head;       // a pointer to the first node in the buffer
     sbuffer_node_t* tail;       // a pointer to the last node in the buffer 
+    sbuffer_node_t* cursor[THREAD_NR];  // the first node every reader thread has not released, NULL if it released all
     pthread_rwlock_t* rwlock;   
 };
 
-// helper methods
-int sbuffer_read(sbuffer_node_t* buffer_node, sensor_data_t* data,READ_TH_ENUM thread);
+// global variables
+// the nodes are allocated by the connmgr and freed by the reader threads, a slab keeps that off malloc
+static slab_cache_t* node_cache = NULL;
 
 int sbuffer_init(sbuffer_t** buffer){
+    if(node_cache == NULL) node_cache = slab_cache_create("sbuffer_node", sizeof(sbuffer_node_t));
+    if(node_cache == NULL) return SBUFFER_FAILURE;
+
     *buffer = malloc(sizeof(sbuffer_t));
     if(*buffer == NULL) return SBUFFER_FAILURE;
     (*buffer)->head = NULL;
     (*buffer)->tail = NULL;
+    for(int i = 0; i < THREAD_NR; i++) (*buffer)->cursor[i] = NULL;
     (*buffer)->rwlock = malloc(sizeof(pthread_rwlock_t));
     pthread_rwlock_init((*buffer)->rwlock, NULL);
     return SBUFFER_SUCCESS;
@@ -48,7 +54,7 @@ int sbuffer_free(sbuffer_t** buffer){
         sbuffer_node_t* dummy;
         dummy = (*buffer)->head;
         (*buffer)->head = (*buffer)->head->next;
-        free(dummy);
+        slab_free(node_cache, dummy);
     }
     rwlock = (*buffer)->rwlock;
     free(*buffer);
@@ -62,63 +68,74 @@ int sbuffer_free(sbuffer_t** buffer){
 }
 
 int sbuffer_remove(sbuffer_t* buffer, sensor_data_t* data, READ_TH_ENUM thread){
+    const sensor_data_t* first;
+    int count;
+    int res = sbuffer_peek(buffer, &first, 1, thread, &count);
+    if(res != SBUFFER_SUCCESS) return res;
+
+    *data = *first;
+    return sbuffer_release(buffer, 1, thread);
+}
+
+int sbuffer_peek(sbuffer_t* buffer, const sensor_data_t** data, int max, READ_TH_ENUM thread, int* count){
+    *count = 0;
     if(buffer == NULL) return SBUFFER_FAILURE;
-    if(buffer->head == NULL) return SBUFFER_NO_DATA;
 
+    // the nodes from the cursor on are only freed after this thread released them, they can be read outside the lock
     pthread_rwlock_rdlock(buffer->rwlock);
-    sbuffer_read(buffer->head, data, thread);
+    for(sbuffer_node_t* node = buffer->cursor[thread]; node != NULL && *count < max; node = node->next)
+        data[(*count)++] = &(node->data);
     pthread_rwlock_unlock(buffer->rwlock);
 
-    
-    // if all reader threads have not read it do not go further
-    for(int i = 0; i < THREAD_NR; i++)
-        if((buffer->head)->reader_threads[i] == UNREAD)
-            return SBUFFER_SUCCESS;
+    return (*count == 0) ? SBUFFER_NO_DATA : SBUFFER_SUCCESS;
+}
 
-    // lock to write/remove
-    pthread_rwlock_wrlock(buffer->rwlock);
+int sbuffer_release(sbuffer_t* buffer, int count, READ_TH_ENUM thread){
+    if(buffer == NULL) return SBUFFER_FAILURE;
 
-    // if both read it, remove the file
-    sbuffer_node_t* dummy = buffer->head;
+    // one write lock for the whole batch, the counters are written and nodes may be freed
+    pthread_rwlock_wrlock(buffer->rwlock);
+    sbuffer_node_t* node = buffer->cursor[thread];
+    for(int i = 0; i < count && node != NULL; i++, node = node->next) node->unreleased--;
+    buffer->cursor[thread] = node;
 
-    // if buffer has only one node
-    if(buffer->head == buffer->tail)
-        buffer->head = buffer->tail = NULL;
-    else
+    // every thread releases in order, so the nodes every reader thread released are at the head
+    while(buffer->head != NULL && buffer->head->unreleased == 0){
+        sbuffer_node_t* dummy = buffer->head;
         buffer->head = buffer->head->next;
-    free(dummy);
-
-    // unlock sbuffer
+        if(buffer->head == NULL) buffer->tail = NULL;
+        slab_free(node_cache, dummy);
+    }
     pthread_rwlock_unlock(buffer->rwlock);
 
 #ifdef DEBUG
-    printf(YELLOW_CLR "REMOVED FROM BUFFER\n" OFF_CLR);
+    printf(YELLOW_CLR "RELEASED FROM BUFFER\n" OFF_CLR);
 #endif
-
     return SBUFFER_SUCCESS;
 }
 
-int sbuffer_read(sbuffer_node_t* buffer_node, sensor_data_t* data,READ_TH_ENUM thread){
-    // recursive function to read the buffer based on the thread type
-    if(buffer_node == NULL) return SBUFFER_NO_DATA;
-    if(buffer_node->reader_threads[thread] == READ) 
-        return sbuffer_read(buffer_node->next, data, thread);
-    
-    *data = buffer_node->data;
-    buffer_node->reader_threads[thread] = READ;
-    return SBUFFER_SUCCESS;
+int sbuffer_insert(sbuffer_t* buffer, sensor_data_t* data){
+    sensor_data_t* slot = sbuffer_reserve(buffer);
+    if(slot == NULL) return SBUFFER_FAILURE;
+
+    *slot = *data;
+    return sbuffer_commit(buffer, slot);
 }
 
-int sbuffer_insert(sbuffer_t* buffer, sensor_data_t* data){
-    if(buffer == NULL) return SBUFFER_FAILURE;
+sensor_data_t* sbuffer_reserve(sbuffer_t* buffer){
+    if(buffer == NULL) return NULL;
+
+    sbuffer_node_t* dummy = slab_alloc(node_cache);
+    if(dummy == NULL) return NULL;
+    return &(dummy->data);
+}
 
-    sbuffer_node_t* dummy = malloc(sizeof(sbuffer_node_t));
-    if(dummy == NULL) return SBUFFER_FAILURE;
+int sbuffer_commit(sbuffer_t* buffer, sensor_data_t* data){
+    if(buffer == NULL || data == NULL) return SBUFFER_FAILURE;
 
-    dummy->data = *data;
+    sbuffer_node_t* dummy = (sbuffer_node_t*) ((char*) data - offsetof(sbuffer_node_t, data));
     dummy->next = NULL;
-    dummy->reader_threads[0] = UNREAD;
-    dummy->reader_threads[1] = UNREAD;
+    dummy->unreleased = THREAD_NR;
 
     // lock the buffer
     pthread_rwlock_wrlock(buffer->rwlock);
@@ -132,6 +149,10 @@ int sbuffer_insert(sbuffer_t* buffer, sensor_data_t* data){
         buffer->tail = dummy;
     }
 
+    // a reader thread that released everything continues with the new node
+    for(int i = 0; i < THREAD_NR; i++)
+        if(buffer->cursor[i] == NULL) buffer->cursor[i] = dummy;
+
     // after inserting the data, unlock the buffer
     pthread_rwlock_unlock(buffer->rwlock);
 
@@ -143,3 +164,7 @@ int sbuffer_insert(sbuffer_t* buffer, sensor_data_t* data){
     return SBUFFER_SUCCESS;
 }
 
+void sbuffer_cancel(sbuffer_t* buffer, sensor_data_t* data){
+    if(buffer == NULL || data == NULL) return;
+    slab_free(node_cache, (char*) data - offsetof(sbuffer_node_t, data));
+}
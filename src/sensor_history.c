@@ -0,0 +1,211 @@
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "config.h"
+#include "sensor_history.h"
+#include "logger.h"
+
+#define HISTORY_INDEX_SIZE (sizeof(uint32_t) * 65536)
+
+// the layout is read by other processes, it must not depend on the compiler or the platform
+_Static_assert(sizeof(history_header_t) == 64, "history_header_t must be 64 bytes");
+_Static_assert(sizeof(history_ring_t) == 16, "history_ring_t must be 16 bytes");
+_Static_assert(sizeof(history_entry_t) == 16, "history_entry_t must be 16 bytes");
+
+// global variables
+static history_header_t* header = NULL;
+static _Atomic uint32_t* slab_index = NULL;
+static char* arena = NULL;
+static size_t shm_size = 0;
+static bool owner = false;
+static bool arena_full = false;
+
+// helper methods
+static int history_map(int fd, size_t size, int prot);
+static history_ring_t* history_get_ring(sensor_id_t sensor_id);
+static history_ring_t* history_new_ring(sensor_id_t sensor_id);
+
+int history_init(uint32_t depth, uint32_t sensors, bool keep){
+    if(depth == 0 || sensors == 0) return HISTORY_FAILURE;
+    uint32_t slab_size = sizeof(history_ring_t) + sizeof(history_entry_t) * depth;
+    size_t size = sizeof(history_header_t) + HISTORY_INDEX_SIZE + (size_t) slab_size * sensors;
+
+    int fd = shm_open(HISTORY_SHM_NAME, O_CREAT | O_RDWR, 0644);
+    if(fd == -1){
+        log_message(LOG_ERROR, "SensorHistory", "CANNOT CREATE SHARED MEMORY %s", HISTORY_SHM_NAME);
+        return HISTORY_FAILURE;
+    }
+    struct stat st;
+    if(fstat(fd, &st) == -1 || ((size_t) st.st_size != size && ftruncate(fd, size) == -1) ||
+       history_map(fd, size, PROT_READ | PROT_WRITE) != HISTORY_SUCCESS){
+        close(fd);
+        shm_unlink(HISTORY_SHM_NAME);
+        return HISTORY_FAILURE;
+    }
+    close(fd);
+    owner = true;
+
+    // the rings of the gateway this one took over from are continued when the arena has the same layout
+    if(keep && (size_t) st.st_size == size && header->magic == HISTORY_MAGIC && header->version == HISTORY_VERSION &&
+       header->depth == depth && header->slab_size == slab_size && header->slab_count == sensors &&
+       atomic_load_explicit(&header->slabs_used, memory_order_relaxed) <= sensors){
+        log_message(LOG_LEVEL_INFO, "SensorHistory", "KEPT SHARED MEMORY %s OF THE PREVIOUS GATEWAY", HISTORY_SHM_NAME);
+        return HISTORY_SUCCESS;
+    }
+
+    // a segment left behind by a previous gateway is reset, clearing the index drops all its rings
+    header->magic = 0;
+    atomic_thread_fence(memory_order_release);
+    memset(slab_index, 0, HISTORY_INDEX_SIZE);
+
+    header->header_size = sizeof(history_header_t);
+    header->depth = depth;
+    header->slab_size = slab_size;
+    header->slab_count = sensors;
+    header->index_offset = sizeof(history_header_t);
+    header->arena_offset = sizeof(history_header_t) + HISTORY_INDEX_SIZE;
+    atomic_store_explicit(&header->slabs_used, 0, memory_order_relaxed);
+    header->version = HISTORY_VERSION;
+    atomic_thread_fence(memory_order_release);
+    header->magic = HISTORY_MAGIC;
+
+#ifdef DEBUG
+    printf(CYAN_CLR "HISTORY: SHARED MEMORY %s CREATED, %u RINGS OF %u READINGS.\n" OFF_CLR,
+        HISTORY_SHM_NAME, sensors, depth);
+#endif
+    return HISTORY_SUCCESS;
+}
+
+int history_attach(){
+    int fd = shm_open(HISTORY_SHM_NAME, O_RDONLY, 0);
+    if(fd == -1) return HISTORY_FAILURE;
+
+    struct stat st;
+    if(fstat(fd, &st) == -1 || (size_t) st.st_size < sizeof(history_header_t) + HISTORY_INDEX_SIZE ||
+       history_map(fd, st.st_size, PROT_READ) != HISTORY_SUCCESS){
+        close(fd);
+        return HISTORY_FAILURE;
+    }
+    close(fd);
+
+    if(header->magic != HISTORY_MAGIC || header->version != HISTORY_VERSION ||
+       (size_t) header->arena_offset + (size_t) header->slab_size * header->slab_count > shm_size){
+        history_free();
+        return HISTORY_FAILURE;
+    }
+    return HISTORY_SUCCESS;
+}
+
+void history_append(sensor_id_t sensor_id, sensor_value_t value, sensor_ts_t ts){
+    if(header == NULL || !owner) return;
+
+    history_ring_t* ring = history_get_ring(sensor_id);
+    if(ring == NULL) ring = history_new_ring(sensor_id);
+    if(ring == NULL) return;
+    history_entry_t* entries = (history_entry_t*) (ring + 1);
+
+    // make the sequence odd before touching the data, readers will retry
+    uint32_t seq = atomic_load_explicit(&ring->seq, memory_order_relaxed);
+    atomic_store_explicit(&ring->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    history_entry_t* entry = &entries[ring->count % header->depth];
+    entry->value = value;
+    entry->ts = (int64_t) ts;
+    ring->count++;
+
+    atomic_store_explicit(&ring->seq, seq + 2, memory_order_release);
+}
+
+int history_query(sensor_id_t sensor_id, sensor_ts_t from, sensor_ts_t to, history_entry_t* out, int max, sensor_ts_t* oldest){
+    if(header == NULL) return HISTORY_FAILURE;
+    *oldest = 0;
+
+    history_ring_t* ring = history_get_ring(sensor_id);
+    if(ring == NULL) return 0;
+    history_entry_t* entries = (history_entry_t*) (ring + 1);
+    uint32_t depth = header->depth;
+
+    uint32_t before, after = 0;
+    int found;
+    do{
+        found = 0;
+        before = atomic_load_explicit(&ring->seq, memory_order_acquire);
+        if(before & 1) continue;
+
+        // walk from the oldest reading still in the ring to the newest one
+        uint64_t count = ring->count;
+        uint64_t first = (count > depth) ? count - depth : 0;
+        *oldest = (count > 0) ? (sensor_ts_t) entries[first % depth].ts : 0;
+        for(uint64_t i = first; i < count && found < max; i++){
+            history_entry_t entry = entries[i % depth];
+            if(entry.ts < from || entry.ts > to) continue;
+            out[found++] = entry;
+        }
+
+        atomic_thread_fence(memory_order_acquire);
+        after = atomic_load_explicit(&ring->seq, memory_order_relaxed);
+    }while((before & 1) || before != after);
+
+    return found;
+}
+
+void history_disown(){
+    owner = false;
+}
+
+void history_free(){
+    // readers that still have the segment mapped see the magic disappear and detach
+    if(owner && header != NULL) header->magic = 0;
+    if(header != NULL) munmap(header, shm_size);
+    if(owner) shm_unlink(HISTORY_SHM_NAME);
+    header = NULL;
+    slab_index = NULL;
+    arena = NULL;
+    shm_size = 0;
+    owner = false;
+    arena_full = false;
+}
+
+static int history_map(int fd, size_t size, int prot){
+    void* addr = mmap(NULL, size, prot, MAP_SHARED, fd, 0);
+    if(addr == MAP_FAILED) return HISTORY_FAILURE;
+    header = (history_header_t*) addr;
+    slab_index = (_Atomic uint32_t*) ((char*) addr + sizeof(history_header_t));
+    arena = (char*) addr + sizeof(history_header_t) + HISTORY_INDEX_SIZE;
+    shm_size = size;
+    return HISTORY_SUCCESS;
+}
+
+static history_ring_t* history_get_ring(sensor_id_t sensor_id){
+    uint32_t slab = atomic_load_explicit(&slab_index[sensor_id], memory_order_acquire);
+    if(slab == 0) return NULL;
+    return (history_ring_t*) (arena + (size_t) (slab - 1) * header->slab_size);
+}
+
+static history_ring_t* history_new_ring(sensor_id_t sensor_id){
+    uint32_t slab = atomic_load_explicit(&header->slabs_used, memory_order_relaxed);
+    if(slab == header->slab_count){
+        if(!arena_full){
+            log_message(LOG_WARNING, "SensorHistory", "HISTORY ARENA FULL, NO RING FOR SENSOR ID: %d", sensor_id);
+            arena_full = true;
+        }
+        return NULL;
+    }
+
+    history_ring_t* ring = (history_ring_t*) (arena + (size_t) slab * header->slab_size);
+    atomic_store_explicit(&ring->seq, 0, memory_order_relaxed);
+    ring->sensor_id = sensor_id;
+    ring->count = 0;
+
+    // the ring must be initialised before readers can find it through the index
+    atomic_store_explicit(&header->slabs_used, slab + 1, memory_order_relaxed);
+    atomic_store_explicit(&slab_index[sensor_id], slab + 1, memory_order_release);
+    return ring;
+}
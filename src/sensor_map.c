@@ -0,0 +1,208 @@
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <signal.h>
+#include <sched.h>
+#include <unistd.h>
+#include <poll.h>
+#include <stdatomic.h>
+#include <sys/inotify.h>
+#include "config.h"
+#include "logger.h"
+#include "sensor_map.h"
+
+// room and type of every sensor id, indexed by the sensor id
+typedef struct {
+    room_id_t room_of[65536];
+    uint8_t type_of[65536];
+    uint32_t generation;
+} sensor_map_table_t;
+
+static const char* type_names[SENSOR_TYPE_NR + 1] = {
+    "temperature",
+    "humidity",
+    "light",
+    "unknown"
+};
+
+// helper methods
+static sensor_map_table_t* sensor_map_parse(FILE* fp_sensor_map, FILE* fp_type_map);
+static sensor_map_table_t* sensor_map_enter(unsigned* slot);
+static void sensor_map_exit(unsigned slot);
+static void sensor_map_synchronize();
+
+// global variables
+static _Atomic(sensor_map_table_t*) current = NULL;
+static _Atomic uint32_t generation = 0;
+
+// readers announce themselves in the counter of the current epoch parity before loading 'current',
+// a writer that flipped the epoch only has to wait for the readers of the old parity to leave
+static _Atomic unsigned epoch = 0;
+static _Atomic long readers[2] = {0, 0};
+
+static pthread_mutex_t reload_lock = PTHREAD_MUTEX_INITIALIZER;
+static volatile sig_atomic_t reload_requested = 0;
+
+int sensor_map_init(FILE* fp_sensor_map, FILE* fp_type_map){
+    if(fp_sensor_map == NULL) return SENSOR_MAP_FAILURE;
+
+    sensor_map_table_t* table = sensor_map_parse(fp_sensor_map, fp_type_map);
+    if(table == NULL) return SENSOR_MAP_FAILURE;
+    table->generation = atomic_fetch_add(&generation, 1) + 1;
+    atomic_store(&current, table);
+    return SENSOR_MAP_SUCCESS;
+}
+
+int sensor_map_reload(const char* sensor_map_file, const char* type_map_file){
+    FILE* fp_sensor_map = fopen(sensor_map_file, "r");
+    if(fp_sensor_map == NULL){
+        log_message(LOG_WARNING, "SensorMap", "Could not read %s, keeping the current mapping\n", sensor_map_file);
+        return SENSOR_MAP_FAILURE;
+    }
+    FILE* fp_type_map = fopen(type_map_file, "r");
+
+    // parse outside the lock and outside the readers, ingest keeps using the old table meanwhile
+    sensor_map_table_t* table = sensor_map_parse(fp_sensor_map, fp_type_map);
+    fclose(fp_sensor_map);
+    if(fp_type_map != NULL) fclose(fp_type_map);
+    if(table == NULL) return SENSOR_MAP_FAILURE;
+
+    pthread_mutex_lock(&reload_lock);
+    table->generation = atomic_load(&generation) + 1;
+    sensor_map_table_t* old = atomic_exchange(&current, table);
+    atomic_store(&generation, table->generation);
+
+    // the old table is freed once no reader can still hold it
+    sensor_map_synchronize();
+    free(old);
+    pthread_mutex_unlock(&reload_lock);
+
+    int sensors = 0;
+    for(int id = 0; id < 65536; id++) if(table->room_of[id] != 0) sensors++;
+    log_message(LOG_LEVEL_INFO, "SensorMap", "RELOADED SENSOR MAP: %d SENSORS (GENERATION %u)", sensors, table->generation);
+    return SENSOR_MAP_SUCCESS;
+}
+
+void sensor_map_request_reload(){
+    reload_requested = 1;
+}
+
+void sensor_map_watch(bool* running){
+    // watch the directory, editors usually replace the file instead of writing it in place
+    int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if(fd == -1 || inotify_add_watch(fd, ".", IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) == -1){
+        log_message(LOG_WARNING, "SensorMap", "inotify is not available, the sensor map only reloads on SIGHUP\n");
+        if(fd != -1) close(fd);
+        fd = -1;
+    }
+
+    bool changed = false;
+    while(*running){
+        pollfd_t pfd = {.fd = fd, .events = POLLIN};
+        // a change is applied once the files were quiet for one interval, so half written files are skipped
+        int ready = poll(&pfd, (fd == -1) ? 0 : 1, SENSOR_MAP_WATCH_INTERVAL);
+
+        if(ready > 0 && (pfd.revents & POLLIN)){
+            char events[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+            ssize_t len;
+            while((len = read(fd, events, sizeof(events))) > 0){
+                for(char* ptr = events; ptr < events + len; ptr += sizeof(struct inotify_event) + ((struct inotify_event*) ptr)->len){
+                    struct inotify_event* event = (struct inotify_event*) ptr;
+                    if(event->len == 0) continue;
+                    if(strcmp(event->name, SENSOR_MAP_FILE) == 0 || strcmp(event->name, TYPE_MAP_FILE) == 0) changed = true;
+                }
+            }
+            continue;
+        }
+
+        if(changed || reload_requested){
+            changed = false;
+            reload_requested = 0;
+            sensor_map_reload(SENSOR_MAP_FILE, TYPE_MAP_FILE);
+        }
+    }
+    if(fd != -1) close(fd);
+}
+
+room_id_t sensor_map_get_room(sensor_id_t sensor_id){
+    unsigned slot;
+    sensor_map_table_t* table = sensor_map_enter(&slot);
+    room_id_t room_id = (table == NULL) ? 0 : table->room_of[sensor_id];
+    sensor_map_exit(slot);
+    return room_id;
+}
+
+sensor_type_t sensor_map_get_type(sensor_id_t sensor_id){
+    unsigned slot;
+    sensor_map_table_t* table = sensor_map_enter(&slot);
+    sensor_type_t type = (table == NULL) ? SENSOR_UNKNOWN : (sensor_type_t) table->type_of[sensor_id];
+    sensor_map_exit(slot);
+    return type;
+}
+
+uint32_t sensor_map_generation(){
+    return atomic_load_explicit(&generation, memory_order_acquire);
+}
+
+const char* sensor_type_name(sensor_type_t type){
+    if(type > SENSOR_UNKNOWN) type = SENSOR_UNKNOWN;
+    return type_names[type];
+}
+
+sensor_type_t sensor_type_from_name(const char* name){
+    for(int type = 0; type < SENSOR_TYPE_NR; type++)
+        if(strcmp(name, type_names[type]) == 0) return type;
+    return SENSOR_UNKNOWN;
+}
+
+void sensor_map_free(){
+    pthread_mutex_lock(&reload_lock);
+    sensor_map_table_t* old = atomic_exchange(&current, NULL);
+    sensor_map_synchronize();
+    free(old);
+    pthread_mutex_unlock(&reload_lock);
+}
+
+static sensor_map_table_t* sensor_map_parse(FILE* fp_sensor_map, FILE* fp_type_map){
+    sensor_map_table_t* table = calloc(1, sizeof(sensor_map_table_t));
+    if(table == NULL) return NULL;
+    memset(table->type_of, SENSOR_UNKNOWN, sizeof(table->type_of));
+
+    // lines are '<room_id> <sensor_id>' and '<sensor_id> <type>', anything that does not parse is skipped
+    char line[128];
+    while(fgets(line, sizeof(line), fp_sensor_map) != NULL){
+        sensor_id_t s_id;
+        room_id_t r_id;
+        if(sscanf(line, "%hu %hu", &r_id, &s_id) != 2) continue;
+        table->room_of[s_id] = r_id;
+    }
+
+    while(fp_type_map != NULL && fgets(line, sizeof(line), fp_type_map) != NULL){
+        sensor_id_t s_id;
+        char name[32];
+        if(sscanf(line, "%hu %31s", &s_id, name) != 2) continue;
+        table->type_of[s_id] = sensor_type_from_name(name);
+    }
+    return table;
+}
+
+static sensor_map_table_t* sensor_map_enter(unsigned* slot){
+    *slot = atomic_load(&epoch) & 1;
+    atomic_fetch_add(&readers[*slot], 1);
+    return atomic_load(&current);
+}
+
+static void sensor_map_exit(unsigned slot){
+    atomic_fetch_sub_explicit(&readers[slot], 1, memory_order_release);
+}
+
+static void sensor_map_synchronize(){
+    // flip twice: a reader may have counted itself in the old parity while already holding the new table,
+    // after two flips both counters drained once since the swap
+    for(int i = 0; i < 2; i++){
+        unsigned old = atomic_fetch_add(&epoch, 1) & 1;
+        while(atomic_load(&readers[old]) != 0) sched_yield();
+    }
+}
@@ -0,0 +1,236 @@
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "config.h"
+#include "sensor_table.h"
+
+#define SENSOR_TABLE_MAGIC "SNSRTAB1"
+// the fields that are saved, slot_of is rebuilt from the ids
+#define SENSOR_TABLE_FIELDS 10
+// every array of a snapshot starts on a multiple of 8 bytes
+#define SENSOR_TABLE_ALIGN(size) (((size) + 7) & ~(size_t) 7)
+
+// the start of a snapshot, followed by the arrays in the order of sensor_table_fields
+typedef struct {
+    char magic[8];
+    uint32_t count;
+    uint32_t run_avg_length;
+    uint8_t sizes[4];                   /** < of sensor_id_t, room_id_t, sensor_value_t and sensor_ts_t */
+    uint32_t reserved;
+} sensor_table_header_t;
+
+typedef struct {
+    void** array;
+    size_t size;                        /** < bytes per slot */
+} sensor_table_field_t;
+
+// helper methods
+static int sensor_table_grow(sensor_table_t* table, int capacity);
+static void* sensor_table_resize(void* array, size_t size, int capacity, bool* failed);
+static void sensor_table_fields(sensor_table_t* table, sensor_table_field_t* fields);
+static void sensor_table_header(sensor_table_header_t* header, uint32_t count);
+
+int sensor_table_init(sensor_table_t** table){
+    *table = calloc(1, sizeof(sensor_table_t));
+    if(*table == NULL) return SENSOR_TABLE_FAILURE;
+
+    (*table)->slot_of = calloc(65536, sizeof(uint32_t));
+    if((*table)->slot_of == NULL || sensor_table_grow(*table, SENSOR_TABLE_CAPACITY) != SENSOR_TABLE_SUCCESS){
+        sensor_table_free(table);
+        return SENSOR_TABLE_FAILURE;
+    }
+    return SENSOR_TABLE_SUCCESS;
+}
+
+int sensor_table_add(sensor_table_t* table, sensor_id_t sensor_id, room_id_t room_id){
+    if(table->count == table->capacity && sensor_table_grow(table, table->capacity * 2) != SENSOR_TABLE_SUCCESS) return -1;
+
+    int slot = table->count++;
+    table->ids[slot] = sensor_id;
+    table->rooms[slot] = room_id;
+    table->running_avg[slot] = 0.0;
+    table->last_modified[slot] = 0;
+    table->buffer_position[slot] = 0;
+    table->take_avg[slot] = false;
+    table->stale[slot] = false;
+    table->alert_state[slot] = 0;
+    table->alert_last[slot] = 0;
+    memset(&(table->windows[slot * RUN_AVG_LENGTH]), 0, RUN_AVG_LENGTH * sizeof(sensor_value_t));
+    table->slot_of[sensor_id] = slot + 1;
+    return slot;
+}
+
+bool sensor_table_store(sensor_table_t* table, int slot, sensor_value_t value, sensor_ts_t ts){
+    sensor_value_t* window = &(table->windows[slot * RUN_AVG_LENGTH]);
+
+    //add the new data point in the circular buffer
+    window[table->buffer_position[slot]] = value;
+
+    //act as a circular buffer
+    if(++table->buffer_position[slot] == RUN_AVG_LENGTH){
+        table->buffer_position[slot] = 0;
+        table->take_avg[slot] = true; //if the buffer is full, start taking the average
+    }
+
+    //update the timestamp
+    table->last_modified[slot] = ts;
+    table->stale[slot] = false;
+    return table->take_avg[slot];
+}
+
+int sensor_table_save(sensor_table_t* table, const char* path){
+    char tmp_path[256];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    FILE* fp = fopen(tmp_path, "w");
+    if(fp == NULL) return SENSOR_TABLE_FAILURE;
+
+    sensor_table_header_t header;
+    sensor_table_header(&header, table->count);
+    sensor_table_field_t fields[SENSOR_TABLE_FIELDS];
+    sensor_table_fields(table, fields);
+    static const uint8_t padding[8] = {0};
+
+    bool failed = (fwrite(&header, sizeof(header), 1, fp) != 1);
+    for(int i = 0; i < SENSOR_TABLE_FIELDS && !failed; i++){
+        size_t size = fields[i].size * table->count;
+        failed = (size > 0 && fwrite(*(fields[i].array), size, 1, fp) != 1)
+              || (SENSOR_TABLE_ALIGN(size) > size && fwrite(padding, SENSOR_TABLE_ALIGN(size) - size, 1, fp) != 1);
+    }
+    // the data is on disk before the rename makes it the snapshot
+    failed = failed || fflush(fp) != 0 || fsync(fileno(fp)) != 0;
+    failed = (fclose(fp) != 0) || failed;
+    if(failed || rename(tmp_path, path) != 0){
+        unlink(tmp_path);
+        return SENSOR_TABLE_FAILURE;
+    }
+    return SENSOR_TABLE_SUCCESS;
+}
+
+int sensor_table_load(sensor_table_t* table, const char* path){
+    if(table->count != 0) return SENSOR_TABLE_FAILURE;
+    int fd = open(path, O_RDONLY);
+    if(fd == -1) return SENSOR_TABLE_FAILURE;
+    struct stat st;
+    if(fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(sensor_table_header_t)){
+        close(fd);
+        return SENSOR_TABLE_FAILURE;
+    }
+    const uint8_t* snapshot = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(snapshot == MAP_FAILED) return SENSOR_TABLE_FAILURE;
+
+    // the header must match this build, and the arrays must fill the rest of the file exactly
+    sensor_table_header_t header, expected;
+    memcpy(&header, snapshot, sizeof(header));
+    sensor_table_header(&expected, header.count);
+    sensor_table_field_t fields[SENSOR_TABLE_FIELDS];
+    sensor_table_fields(table, fields);
+    size_t total = sizeof(header);
+    for(int i = 0; i < SENSOR_TABLE_FIELDS; i++) total += SENSOR_TABLE_ALIGN(fields[i].size * header.count);
+
+    if(memcmp(&header, &expected, sizeof(header)) != 0 || header.count > 65536 || total != (size_t) st.st_size){
+        munmap((void*) snapshot, st.st_size);
+        return SENSOR_TABLE_FAILURE;
+    }
+
+    // the count is valid now, so the capacity stays within 65536
+    int capacity = table->capacity;
+    while(capacity < (int) header.count) capacity *= 2;
+    if(capacity > table->capacity && sensor_table_grow(table, capacity) != SENSOR_TABLE_SUCCESS){
+        munmap((void*) snapshot, st.st_size);
+        return SENSOR_TABLE_FAILURE;
+    }
+
+    // the arrays may have moved while growing
+    sensor_table_fields(table, fields);
+    size_t offset = sizeof(header);
+    for(int i = 0; i < SENSOR_TABLE_FIELDS; i++){
+        memcpy(*(fields[i].array), snapshot + offset, fields[i].size * header.count);
+        offset += SENSOR_TABLE_ALIGN(fields[i].size * header.count);
+    }
+    munmap((void*) snapshot, st.st_size);
+
+    // a sensor that appears twice invalidates the snapshot
+    for(int slot = 0; slot < (int) header.count; slot++){
+        if(table->slot_of[table->ids[slot]] != 0 || table->buffer_position[slot] >= RUN_AVG_LENGTH){
+            memset(table->slot_of, 0, 65536 * sizeof(uint32_t));
+            return SENSOR_TABLE_FAILURE;
+        }
+        table->slot_of[table->ids[slot]] = slot + 1;
+    }
+    table->count = header.count;
+    return SENSOR_TABLE_SUCCESS;
+}
+
+void sensor_table_free(sensor_table_t** table){
+    if(*table == NULL) return;
+    free((*table)->ids);
+    free((*table)->rooms);
+    free((*table)->running_avg);
+    free((*table)->last_modified);
+    free((*table)->buffer_position);
+    free((*table)->take_avg);
+    free((*table)->stale);
+    free((*table)->alert_state);
+    free((*table)->alert_last);
+    free((*table)->windows);
+    free((*table)->slot_of);
+    free(*table);
+    *table = NULL;
+}
+
+static int sensor_table_grow(sensor_table_t* table, int capacity){
+    // every array is resized on its own, after a failure all arrays are still valid for the old capacity
+    bool failed = false;
+    table->ids = sensor_table_resize(table->ids, sizeof(sensor_id_t), capacity, &failed);
+    table->rooms = sensor_table_resize(table->rooms, sizeof(room_id_t), capacity, &failed);
+    table->running_avg = sensor_table_resize(table->running_avg, sizeof(sensor_value_t), capacity, &failed);
+    table->last_modified = sensor_table_resize(table->last_modified, sizeof(sensor_ts_t), capacity, &failed);
+    table->buffer_position = sensor_table_resize(table->buffer_position, sizeof(uint16_t), capacity, &failed);
+    table->take_avg = sensor_table_resize(table->take_avg, sizeof(bool), capacity, &failed);
+    table->stale = sensor_table_resize(table->stale, sizeof(bool), capacity, &failed);
+    table->alert_state = sensor_table_resize(table->alert_state, sizeof(uint8_t), capacity, &failed);
+    table->alert_last = sensor_table_resize(table->alert_last, sizeof(sensor_ts_t), capacity, &failed);
+    table->windows = sensor_table_resize(table->windows, RUN_AVG_LENGTH * sizeof(sensor_value_t), capacity, &failed);
+    if(failed) return SENSOR_TABLE_FAILURE;
+    table->capacity = capacity;
+    return SENSOR_TABLE_SUCCESS;
+}
+
+static void* sensor_table_resize(void* array, size_t size, int capacity, bool* failed){
+    void* resized = realloc(array, size * capacity);
+    if(resized != NULL) return resized;
+    *failed = true;
+    return array;
+}
+
+static void sensor_table_fields(sensor_table_t* table, sensor_table_field_t* fields){
+    int i = 0;
+    fields[i++] = (sensor_table_field_t) {(void**) &(table->ids), sizeof(sensor_id_t)};
+    fields[i++] = (sensor_table_field_t) {(void**) &(table->rooms), sizeof(room_id_t)};
+    fields[i++] = (sensor_table_field_t) {(void**) &(table->running_avg), sizeof(sensor_value_t)};
+    fields[i++] = (sensor_table_field_t) {(void**) &(table->last_modified), sizeof(sensor_ts_t)};
+    fields[i++] = (sensor_table_field_t) {(void**) &(table->buffer_position), sizeof(uint16_t)};
+    fields[i++] = (sensor_table_field_t) {(void**) &(table->take_avg), sizeof(bool)};
+    fields[i++] = (sensor_table_field_t) {(void**) &(table->stale), sizeof(bool)};
+    fields[i++] = (sensor_table_field_t) {(void**) &(table->alert_state), sizeof(uint8_t)};
+    fields[i++] = (sensor_table_field_t) {(void**) &(table->alert_last), sizeof(sensor_ts_t)};
+    fields[i++] = (sensor_table_field_t) {(void**) &(table->windows), RUN_AVG_LENGTH * sizeof(sensor_value_t)};
+}
+
+static void sensor_table_header(sensor_table_header_t* header, uint32_t count){
+    memset(header, 0, sizeof(sensor_table_header_t));
+    memcpy(header->magic, SENSOR_TABLE_MAGIC, sizeof(header->magic));
+    header->count = count;
+    header->run_avg_length = RUN_AVG_LENGTH;
+    header->sizes[0] = sizeof(sensor_id_t);
+    header->sizes[1] = sizeof(room_id_t);
+    header->sizes[2] = sizeof(sensor_value_t);
+    header->sizes[3] = sizeof(sensor_ts_t);
+}
@@ -0,0 +1,214 @@
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "slab.h"
+
+// a free object holds the pointer to the next free object in its first bytes
+typedef struct slab_object {
+    struct slab_object* next;
+} slab_object_t;
+
+typedef struct slab_block {
+    struct slab_block* next;
+    alignas(max_align_t) char objects[];
+} slab_block_t;
+
+struct slab_cache {
+    const char* name;
+    int id;
+    size_t object_size;
+    int per_block;
+
+    // the depot: free objects shared by all threads and the blocks they live in
+    pthread_mutex_t depot_lock;
+    slab_object_t* depot;
+    slab_block_t* blocks;
+
+    // the counters are written by different threads, each on its own cache line
+    alignas(64) atomic_uint_fast64_t allocs;
+    alignas(64) atomic_uint_fast64_t frees;
+    alignas(64) atomic_uint_fast64_t block_count;
+    atomic_uint_fast64_t depot_trips;
+};
+
+// the free objects a thread keeps for every cache
+typedef struct {
+    slab_object_t* head;
+    int count;
+} slab_local_t;
+
+// helper methods
+static int slab_refill(slab_cache_t* cache, slab_local_t* local);
+static void slab_return(slab_cache_t* cache, slab_local_t* local, int count);
+
+// global variables
+static slab_cache_t* caches[SLAB_CACHES_MAX];
+static int cache_count = 0;
+static pthread_mutex_t caches_lock = PTHREAD_MUTEX_INITIALIZER;
+static _Thread_local slab_local_t local_caches[SLAB_CACHES_MAX];
+
+slab_cache_t* slab_cache_create(const char* name, size_t object_size){
+    slab_cache_t* cache = calloc(1, sizeof(slab_cache_t));
+    if(cache == NULL) return NULL;
+
+    // every object is big enough for the free list link and aligned like malloc
+    size_t align = alignof(max_align_t);
+    if(object_size < sizeof(slab_object_t)) object_size = sizeof(slab_object_t);
+    cache->object_size = (object_size + align - 1) / align * align;
+    cache->per_block = (int) ((SLAB_BLOCK_SIZE - sizeof(slab_block_t)) / cache->object_size);
+    if(cache->per_block < 1) cache->per_block = 1;
+    cache->name = name;
+    pthread_mutex_init(&(cache->depot_lock), NULL);
+
+    // ids are never reused, so a thread cache of a destroyed slab is never touched again
+    pthread_mutex_lock(&caches_lock);
+    if(cache_count == SLAB_CACHES_MAX){
+        pthread_mutex_unlock(&caches_lock);
+        pthread_mutex_destroy(&(cache->depot_lock));
+        free(cache);
+        return NULL;
+    }
+    cache->id = cache_count;
+    caches[cache_count++] = cache;
+    pthread_mutex_unlock(&caches_lock);
+    return cache;
+}
+
+void* slab_alloc(slab_cache_t* cache){
+    slab_local_t* local = &(local_caches[cache->id]);
+    if(local->head == NULL && slab_refill(cache, local) != SLAB_SUCCESS) return NULL;
+
+    slab_object_t* object = local->head;
+    local->head = object->next;
+    local->count--;
+    atomic_fetch_add_explicit(&(cache->allocs), 1, memory_order_relaxed);
+    return object;
+}
+
+void slab_free(slab_cache_t* cache, void* object){
+    if(object == NULL) return;
+    slab_local_t* local = &(local_caches[cache->id]);
+
+    slab_object_t* freed = object;
+    freed->next = local->head;
+    local->head = freed;
+    local->count++;
+    atomic_fetch_add_explicit(&(cache->frees), 1, memory_order_relaxed);
+
+    // a thread that only frees (e.g. a reader of the buffer) hands its objects back to the depot
+    if(local->count > SLAB_MAGAZINE) slab_return(cache, local, SLAB_MAGAZINE / 2);
+}
+
+void slab_thread_flush(){
+    pthread_mutex_lock(&caches_lock);
+    for(int id = 0; id < cache_count; id++){
+        if(caches[id] == NULL) local_caches[id] = (slab_local_t) {NULL, 0};
+        else if(local_caches[id].count > 0) slab_return(caches[id], &(local_caches[id]), local_caches[id].count);
+    }
+    pthread_mutex_unlock(&caches_lock);
+}
+
+int slab_get_stats(int index, slab_stats_t* stats){
+    pthread_mutex_lock(&caches_lock);
+    if(index < 0 || index >= cache_count || caches[index] == NULL){
+        pthread_mutex_unlock(&caches_lock);
+        return SLAB_FAILURE;
+    }
+    slab_cache_t* cache = caches[index];
+    *stats = (slab_stats_t) {
+        .name = cache->name,
+        .object_size = cache->object_size,
+        .allocs = atomic_load_explicit(&(cache->allocs), memory_order_relaxed),
+        .frees = atomic_load_explicit(&(cache->frees), memory_order_relaxed),
+        .blocks = atomic_load_explicit(&(cache->block_count), memory_order_relaxed),
+        .depot_trips = atomic_load_explicit(&(cache->depot_trips), memory_order_relaxed),
+    };
+    pthread_mutex_unlock(&caches_lock);
+    return SLAB_SUCCESS;
+}
+
+void slab_dump_stats(FILE* fp){
+    slab_stats_t stats;
+    for(int index = 0; index < SLAB_CACHES_MAX; index++){
+        if(slab_get_stats(index, &stats) != SLAB_SUCCESS) continue;
+        fprintf(fp, "SLAB %s (%zu BYTES): ALLOCS: %llu  FREES: %llu  IN USE: %llu  BLOCKS: %llu  DEPOT TRIPS: %llu\n",
+                stats.name, stats.object_size, (unsigned long long) stats.allocs, (unsigned long long) stats.frees,
+                (unsigned long long) (stats.allocs - stats.frees), (unsigned long long) stats.blocks,
+                (unsigned long long) stats.depot_trips);
+    }
+}
+
+void slab_cache_destroy(slab_cache_t** cache){
+    if(cache == NULL || *cache == NULL) return;
+
+    pthread_mutex_lock(&caches_lock);
+    caches[(*cache)->id] = NULL;
+    pthread_mutex_unlock(&caches_lock);
+    // the objects in the thread caches live in these blocks as well
+    local_caches[(*cache)->id] = (slab_local_t) {NULL, 0};
+
+    slab_block_t* block = (*cache)->blocks;
+    while(block != NULL){
+        slab_block_t* next = block->next;
+        free(block);
+        block = next;
+    }
+    pthread_mutex_destroy(&((*cache)->depot_lock));
+    free(*cache);
+    *cache = NULL;
+}
+
+static int slab_refill(slab_cache_t* cache, slab_local_t* local){
+    atomic_fetch_add_explicit(&(cache->depot_trips), 1, memory_order_relaxed);
+    pthread_mutex_lock(&(cache->depot_lock));
+
+    // cut a new block into objects when the depot is empty
+    if(cache->depot == NULL){
+        slab_block_t* block = malloc(sizeof(slab_block_t) + cache->per_block * cache->object_size);
+        if(block == NULL){
+            pthread_mutex_unlock(&(cache->depot_lock));
+            return SLAB_FAILURE;
+        }
+        block->next = cache->blocks;
+        cache->blocks = block;
+        atomic_fetch_add_explicit(&(cache->block_count), 1, memory_order_relaxed);
+
+        for(int i = cache->per_block - 1; i >= 0; i--){
+            slab_object_t* object = (slab_object_t*) (block->objects + i * cache->object_size);
+            object->next = cache->depot;
+            cache->depot = object;
+        }
+    }
+
+    // take half a magazine, so the next slab_free calls do not go straight back to the depot
+    while(cache->depot != NULL && local->count < SLAB_MAGAZINE / 2){
+        slab_object_t* object = cache->depot;
+        cache->depot = object->next;
+        object->next = local->head;
+        local->head = object;
+        local->count++;
+    }
+    pthread_mutex_unlock(&(cache->depot_lock));
+    return SLAB_SUCCESS;
+}
+
+static void slab_return(slab_cache_t* cache, slab_local_t* local, int count){
+    // detach the first 'count' objects of the thread cache before taking the lock
+    slab_object_t* first = local->head;
+    slab_object_t* last = first;
+    for(int i = 1; i < count; i++) last = last->next;
+    local->head = last->next;
+    local->count -= count;
+
+    atomic_fetch_add_explicit(&(cache->depot_trips), 1, memory_order_relaxed);
+    pthread_mutex_lock(&(cache->depot_lock));
+    last->next = cache->depot;
+    cache->depot = first;
+    pthread_mutex_unlock(&(cache->depot_lock));
+}
@@ -0,0 +1,306 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include "config.h"
+#include "sensor_buffer.h"
+#include "sensor_map.h"
+#include "stream_manager.h"
+#include "logger.h"
+
+#define STREAM_POLL_INTERVAL 50     // ms between two checks of the shared buffer
+#define STREAM_RETRY_POLLS 20       // checks between two attempts to open the listener
+#define STREAM_REQUEST_SIZE 1024
+#define STREAM_EVENT_SIZE 256
+
+#define STREAM_OK 0
+#define STREAM_CLOSE 1
+
+static const char stream_headers[] =
+    "HTTP/1.1 200 OK\r\n"
+    "Content-Type: text/event-stream\r\n"
+    "Cache-Control: no-cache\r\n"
+    "Connection: keep-alive\r\n"
+    "Access-Control-Allow-Origin: *\r\n\r\n";
+
+static const char stream_not_found[] =
+    "HTTP/1.1 404 Not Found\r\n"
+    "Content-Length: 0\r\n"
+    "Connection: close\r\n\r\n";
+
+typedef struct {
+    sensor_data_t data;
+    room_id_t room_id;
+} stream_event_t;
+
+typedef struct {
+    tcpsock_t* socket;
+    int fd;
+    bool streaming;                         // request parsed, readings are pushed
+    bool closing;                           // close after the pending output is written
+    char request[STREAM_REQUEST_SIZE];
+    int request_len;
+
+    int sensor_count;
+    sensor_id_t sensors[STREAM_MAX_FILTERS];
+    int room_count;
+    room_id_t rooms[STREAM_MAX_FILTERS];
+
+    stream_event_t queue[STREAM_QUEUE_LENGTH];  // bounded queue of readings not yet written
+    int queue_head;
+    int queue_count;
+    unsigned long dropped;                  // readings dropped because the queue was full
+    unsigned long dropped_reported;
+
+    char out[STREAM_EVENT_SIZE];            // event that is being written
+    int out_len;
+    int out_sent;
+} subscriber_t;
+
+// helper functions
+void streammgr_accept(tcpsock_t* server);
+void streammgr_remove(int index);
+int streammgr_read_request(subscriber_t* sub);
+void streammgr_parse_filters(subscriber_t* sub, char* query);
+void streammgr_consume(sbuffer_t* buffer);
+void streammgr_enqueue(const sensor_data_t* data, room_id_t room_id);
+int streammgr_flush(subscriber_t* sub);
+
+// global variables
+static subscriber_t* subscribers[STREAM_MAX_SUBSCRIBERS];
+static int subscriber_count = 0;
+static pollfd_t polls[STREAM_MAX_SUBSCRIBERS + 1];
+
+// multithreading variables
+static notifier_t* stream_notify;
+
+static bool* connmgr_working;
+
+void streammgr_init(config_thread_t* config_thread){
+    stream_notify = config_thread->stream_notify;
+
+    connmgr_working = config_thread->connmgr_working;
+}
+
+void streammgr_listen(int port_number, sbuffer_t** buffer){
+#ifdef DEBUG
+    printf(CYAN_CLR "STREAMMGR: NEW STREAMMGR.\n" OFF_CLR);
+#endif
+    tcpsock_t* server;
+    if(tcp_passive_open(&server, port_number) != TCP_NO_ERROR){
+        log_message(LOG_ERROR, "StreamMgr", "CANNOT OPEN STREAM LISTENER ON PORT %d", port_number);
+        server = NULL;
+    }
+    else log_message(LOG_LEVEL_INFO, "StreamMgr", "STREAM LISTENER STARTED ON PORT %d", port_number);
+
+    int retry_polls = 0;
+    while(*connmgr_working){
+        // the port can still be held by the gateway this one took the sensors over from
+        if(server == NULL && ++retry_polls == STREAM_RETRY_POLLS){
+            retry_polls = 0;
+            if(tcp_passive_open(&server, port_number) != TCP_NO_ERROR) server = NULL;
+            else log_message(LOG_LEVEL_INFO, "StreamMgr", "STREAM LISTENER STARTED ON PORT %d", port_number);
+        }
+
+        // the listener is always the first poll, followed by the subscribers
+        int polled = subscriber_count;
+        polls[0].fd = -1;
+        if(server != NULL) tcp_get_sd(server, &(polls[0].fd));
+        polls[0].events = POLLIN;
+        for(int i = 0; i < polled; i++){
+            polls[i + 1].fd = subscribers[i]->fd;
+            polls[i + 1].events = POLLIN;
+        }
+        poll(polls, polled + 1, STREAM_POLL_INTERVAL);
+
+        // walk backwards, removing a subscriber moves the last one in its place
+        for(int i = polled - 1; i >= 0; i--){
+            short events = polls[i + 1].revents;
+            if(events & (POLLERR | POLLNVAL)) streammgr_remove(i);
+            else if((events & (POLLIN | POLLHUP)) && streammgr_read_request(subscribers[i]) != STREAM_OK)
+                streammgr_remove(i);
+        }
+
+        if(polls[0].revents & POLLIN) streammgr_accept(server);
+
+        // read everything the connmgr added since the last check
+        streammgr_consume(*buffer);
+
+        for(int i = subscriber_count - 1; i >= 0; i--)
+            if(streammgr_flush(subscribers[i]) != STREAM_OK) streammgr_remove(i);
+    }
+
+    if(server != NULL) tcp_close(&server);
+    streammgr_free();
+#ifdef DEBUG
+    printf(CYAN_CLR "CLOSING STREAMMGR.\n" OFF_CLR);
+#endif
+}
+
+void streammgr_free(){
+    while(subscriber_count > 0) streammgr_remove(subscriber_count - 1);
+}
+
+void streammgr_accept(tcpsock_t* server){
+    tcpsock_t* client;
+    if(tcp_wait_for_connection(server, &client) != TCP_NO_ERROR) return;
+
+    if(subscriber_count == STREAM_MAX_SUBSCRIBERS){
+        log_message(LOG_WARNING, "StreamMgr", "TOO MANY SUBSCRIBERS, CONNECTION REFUSED");
+        tcp_close(&client);
+        return;
+    }
+    subscriber_t* sub = calloc(1, sizeof(subscriber_t));
+    if(sub == NULL){
+        tcp_close(&client);
+        return;
+    }
+    // the descriptor is read and written directly, without blocking
+    sub->socket = client;
+    tcp_get_sd(client, &(sub->fd));
+    subscribers[subscriber_count++] = sub;
+}
+
+void streammgr_remove(int index){
+    subscriber_t* sub = subscribers[index];
+    if(sub->streaming)
+        log_message(LOG_LEVEL_INFO, "StreamMgr", "SUBSCRIBER CLOSED, %lu READINGS DROPPED", sub->dropped);
+    tcp_close(&(sub->socket));
+    free(sub);
+    subscribers[index] = subscribers[--subscriber_count];
+}
+
+int streammgr_read_request(subscriber_t* sub){
+    char* dst = sub->request + sub->request_len;
+    int space = STREAM_REQUEST_SIZE - 1 - sub->request_len;
+
+    // once streaming, anything the client sends is ignored
+    char discard[256];
+    if(sub->streaming){
+        dst = discard;
+        space = sizeof(discard);
+    }
+    ssize_t received = recv(sub->fd, dst, space, MSG_DONTWAIT);
+    if(received == 0) return STREAM_CLOSE;
+    if(received < 0) return (errno == EAGAIN || errno == EWOULDBLOCK) ? STREAM_OK : STREAM_CLOSE;
+    if(sub->streaming || sub->closing) return STREAM_OK;
+
+    sub->request_len += received;
+    sub->request[sub->request_len] = '\0';
+    if(strstr(sub->request, "\r\n\r\n") == NULL && strstr(sub->request, "\n\n") == NULL){
+        // the request does not fit in the buffer
+        return (sub->request_len == STREAM_REQUEST_SIZE - 1) ? STREAM_CLOSE : STREAM_OK;
+    }
+
+    // request line: GET /stream?sensor=15,21&room=1 HTTP/1.1
+    char* path = NULL;
+    if(strncmp(sub->request, "GET ", 4) == 0){
+        path = sub->request + 4;
+        char* end = strpbrk(path, " \r\n");
+        if(end) *end = '\0';
+    }
+    if(path == NULL || (strcmp(path, "/stream") != 0 && strncmp(path, "/stream?", 8) != 0)){
+        sub->out_len = sizeof(stream_not_found) - 1;
+        memcpy(sub->out, stream_not_found, sub->out_len);
+        sub->closing = true;
+        return STREAM_OK;
+    }
+    if(path[7] == '?') streammgr_parse_filters(sub, path + 8);
+
+    sub->out_len = sizeof(stream_headers) - 1;
+    memcpy(sub->out, stream_headers, sub->out_len);
+    sub->streaming = true;
+    log_message(LOG_LEVEL_INFO, "StreamMgr", "NEW SUBSCRIBER: %d SENSORS, %d ROOMS", sub->sensor_count, sub->room_count);
+    return STREAM_OK;
+}
+
+void streammgr_parse_filters(subscriber_t* sub, char* query){
+    char* save_param;
+    for(char* param = strtok_r(query, "&", &save_param); param != NULL; param = strtok_r(NULL, "&", &save_param)){
+        char* value = strchr(param, '=');
+        if(value == NULL) continue;
+        *value++ = '\0';
+
+        bool sensor = (strcmp(param, "sensor") == 0);
+        bool room = (strcmp(param, "room") == 0);
+        if(!sensor && !room) continue;
+
+        char* save_id;
+        for(char* id = strtok_r(value, ",", &save_id); id != NULL; id = strtok_r(NULL, ",", &save_id)){
+            unsigned int parsed;
+            if(sscanf(id, "%u", &parsed) != 1 || parsed > UINT16_MAX) continue;
+            if(sensor && sub->sensor_count < STREAM_MAX_FILTERS) sub->sensors[sub->sensor_count++] = parsed;
+            if(room && sub->room_count < STREAM_MAX_FILTERS) sub->rooms[sub->room_count++] = parsed;
+        }
+    }
+}
+
+void streammgr_consume(sbuffer_t* buffer){
+    // the streammgr does not park on the notifier, it polls its subscribers and checks in between
+    int available = notifier_pending(stream_notify);
+
+    for(; available > 0; available--){
+        // the subscriber queues take their own copy, the reading is read in place
+        const sensor_data_t* data;
+        int count;
+        if(sbuffer_peek(buffer, &data, 1, STREAM_THREAD, &count) != SBUFFER_SUCCESS) break;
+        streammgr_enqueue(data, sensor_map_get_room(data->id));
+        sbuffer_release(buffer, 1, STREAM_THREAD);
+        notifier_take(stream_notify, 1);
+    }
+}
+
+void streammgr_enqueue(const sensor_data_t* data, room_id_t room_id){
+    for(int i = 0; i < subscriber_count; i++){
+        subscriber_t* sub = subscribers[i];
+        if(!sub->streaming) continue;
+
+        // without filters a subscriber receives every reading
+        bool match = (sub->sensor_count == 0 && sub->room_count == 0);
+        for(int j = 0; !match && j < sub->sensor_count; j++) match = (sub->sensors[j] == data->id);
+        for(int j = 0; !match && j < sub->room_count; j++) match = (sub->rooms[j] == room_id);
+        if(!match) continue;
+
+        // a slow subscriber loses readings instead of holding up the others
+        if(sub->queue_count == STREAM_QUEUE_LENGTH){
+            sub->dropped++;
+            continue;
+        }
+        stream_event_t* event = &sub->queue[(sub->queue_head + sub->queue_count) % STREAM_QUEUE_LENGTH];
+        event->data = *data;
+        event->room_id = room_id;
+        sub->queue_count++;
+    }
+}
+
+int streammgr_flush(subscriber_t* sub){
+    while(true){
+        // take the next event from the queue when the previous one is written
+        if(sub->out_sent == sub->out_len){
+            sub->out_len = sub->out_sent = 0;
+            if(sub->closing) return STREAM_CLOSE;
+            if(sub->dropped != sub->dropped_reported){
+                sub->out_len = snprintf(sub->out, STREAM_EVENT_SIZE, "event: dropped\ndata: %lu\n\n", sub->dropped);
+                sub->dropped_reported = sub->dropped;
+            }
+            else if(sub->queue_count > 0){
+                stream_event_t* event = &sub->queue[sub->queue_head];
+                sub->out_len = snprintf(sub->out, STREAM_EVENT_SIZE,
+                    "data: {\"sensor_id\":%u,\"room_id\":%u,\"value\":%f,\"timestamp\":%ld}\n\n",
+                    event->data.id, event->room_id, event->data.value, (long) event->data.ts);
+                sub->queue_head = (sub->queue_head + 1) % STREAM_QUEUE_LENGTH;
+                sub->queue_count--;
+            }
+            else return STREAM_OK;
+        }
+
+        ssize_t sent = send(sub->fd, sub->out + sub->out_sent, sub->out_len - sub->out_sent, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if(sent < 0) return (errno == EAGAIN || errno == EWOULDBLOCK) ? STREAM_OK : STREAM_CLOSE;
+        sub->out_sent += sent;
+    }
+}
@@ -0,0 +1,129 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <sched.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+#include "thread_placement.h"
+#include "logger.h"
+
+// NUMA nodes that fit in the node mask of set_mempolicy
+#define PLACEMENT_MAX_NODES (8 * (int) sizeof(unsigned long))
+
+typedef struct {
+    char role[16];
+    char cpu_list[64];          /** < the cpus as written in the file, for the log */
+    bool pinned;                /** < false if the cpus are '*' */
+    cpu_set_t cpus;
+    int fifo_priority;          /** < 0 keeps the default scheduler */
+    int node;                   /** < -1 keeps the default memory policy (first touch) */
+} placement_t;
+
+// helper methods
+static int placement_parse_cpus(const char* list, cpu_set_t* cpus);
+
+// global variables, written before the threads start and only read afterwards
+static placement_t placements[PLACEMENT_MAX_ROLES];
+static int placement_count = 0;
+
+int placement_load(FILE* fp_placement){
+    placement_count = 0;
+    if(fp_placement == NULL) return 0;
+
+    char line[128];
+    int line_nr = 0;
+    while(fgets(line, sizeof(line), fp_placement) != NULL){
+        line_nr++;
+        char* start = line + strspn(line, " \t");
+        if(*start == '#' || *start == '\n' || *start == '\0') continue;
+
+        placement_t placement = {.fifo_priority = 0, .node = -1};
+        char option[2][16];
+        int value[2];
+        int fields = sscanf(start, "%15s %63s %15s %d %15s %d", placement.role, placement.cpu_list, option[0], &value[0], option[1], &value[1]);
+        bool valid = (fields == 2 || fields == 4 || fields == 6) && placement_count < PLACEMENT_MAX_ROLES;
+
+        placement.pinned = (strcmp(placement.cpu_list, "*") != 0);
+        if(valid && placement.pinned) valid = (placement_parse_cpus(placement.cpu_list, &(placement.cpus)) == PLACEMENT_SUCCESS);
+        for(int i = 0; valid && i < (fields - 2) / 2; i++){
+            if(strcmp(option[i], "fifo") == 0 && value[i] >= sched_get_priority_min(SCHED_FIFO)
+               && value[i] <= sched_get_priority_max(SCHED_FIFO)) placement.fifo_priority = value[i];
+            else if(strcmp(option[i], "node") == 0 && value[i] >= 0 && value[i] < PLACEMENT_MAX_NODES) placement.node = value[i];
+            else valid = false;
+        }
+        if(!valid){
+            log_message(LOG_WARNING, "Placement", "%s:%d: invalid placement skipped", PLACEMENT_MAP_FILE, line_nr);
+            continue;
+        }
+        placements[placement_count++] = placement;
+    }
+    log_message(LOG_LEVEL_INFO, "Placement", "LOADED %d THREAD PLACEMENTS", placement_count);
+    return placement_count;
+}
+
+int placement_apply(const char* role){
+    placement_t* placement = NULL;
+    for(int i = 0; i < placement_count && placement == NULL; i++)
+        if(strcmp(placements[i].role, role) == 0) placement = &placements[i];
+    if(placement == NULL) return PLACEMENT_SUCCESS;
+
+    int result = PLACEMENT_SUCCESS;
+    int err;
+    if(placement->pinned && (err = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &(placement->cpus))) != 0){
+        log_message(LOG_WARNING, "Placement", "CANNOT PIN %s: %s", role, strerror(err));
+        result = PLACEMENT_FAILURE;
+    }
+
+    // real time scheduling needs CAP_SYS_NICE (or an RLIMIT_RTPRIO), the thread keeps running without it
+    if(placement->fifo_priority > 0){
+        struct sched_param param = {.sched_priority = placement->fifo_priority};
+        if((err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param)) != 0){
+            log_message(LOG_WARNING, "Placement", "CANNOT RUN %s WITH SCHED_FIFO: %s", role, strerror(err));
+            result = PLACEMENT_FAILURE;
+        }
+    }
+
+    // the node is preferred, not bound: an allocation falls back to another node instead of failing
+    if(placement->node >= 0){
+        unsigned long nodes = 1UL << placement->node;
+        if(syscall(SYS_set_mempolicy, MPOL_PREFERRED, &nodes, PLACEMENT_MAX_NODES) != 0){
+            log_message(LOG_WARNING, "Placement", "CANNOT PREFER NUMA NODE %d FOR %s: %s", placement->node, role, strerror(errno));
+            result = PLACEMENT_FAILURE;
+        }
+    }
+
+    if(result == PLACEMENT_SUCCESS)
+        log_message(LOG_LEVEL_INFO, "Placement", "%s PLACED ON CPUS %s, FIFO PRIORITY %d, NUMA NODE %d", role,
+                    placement->cpu_list, placement->fifo_priority, placement->node);
+    return result;
+}
+
+static int placement_parse_cpus(const char* list, cpu_set_t* cpus){
+    CPU_ZERO(cpus);
+    // a comma separated list of cpus and ranges: 0,2,4-7
+    const char* next = list;
+    while(*next != '\0'){
+        char* end;
+        long first = strtol(next, &end, 10);
+        if(end == next) return PLACEMENT_FAILURE;
+        long last = first;
+        if(*end == '-'){
+            next = end + 1;
+            last = strtol(next, &end, 10);
+            if(end == next) return PLACEMENT_FAILURE;
+        }
+        if(first < 0 || last < first || last >= CPU_SETSIZE) return PLACEMENT_FAILURE;
+        for(long cpu = first; cpu <= last; cpu++) CPU_SET(cpu, cpus);
+
+        if(*end == ',') end++;
+        else if(*end != '\0') return PLACEMENT_FAILURE;
+        next = end;
+    }
+    return CPU_COUNT(cpus) > 0 ? PLACEMENT_SUCCESS : PLACEMENT_FAILURE;
+}
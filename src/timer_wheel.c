@@ -0,0 +1,134 @@
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include "timer_wheel.h"
+
+#define TIMER_WHEEL_MASK (TIMER_WHEEL_SLOTS - 1)
+#define TIMER_WHEEL_RANGE ((uint64_t) 1 << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS))
+
+// helper methods
+static void timer_wheel_insert(timer_wheel_t* wheel, timer_entry_t* timer);
+static void timer_wheel_unlink(timer_entry_t* timer);
+static void timer_wheel_take(timer_entry_t* slot, timer_entry_t* list);
+
+uint64_t timer_wheel_clock(){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000 + (uint64_t) now.tv_nsec / 1000000;
+}
+
+int timer_wheel_init(timer_wheel_t** wheel, uint64_t now_ms){
+    *wheel = malloc(sizeof(timer_wheel_t));
+    if(*wheel == NULL) return TIMER_WHEEL_FAILURE;
+
+    (*wheel)->now = now_ms / TIMER_WHEEL_TICK;
+    for(int level = 0; level < TIMER_WHEEL_LEVELS; level++){
+        for(int slot = 0; slot < TIMER_WHEEL_SLOTS; slot++){
+            timer_entry_t* head = &((*wheel)->slots[level][slot]);
+            head->next = head;
+            head->prev = head;
+            head->pending = false;
+        }
+    }
+    return TIMER_WHEEL_SUCCESS;
+}
+
+void timer_wheel_schedule(timer_wheel_t* wheel, timer_entry_t* timer, uint64_t expires_ms){
+    timer_wheel_cancel(timer);
+
+    // round up, a timer never fires early
+    uint64_t expires = (expires_ms + TIMER_WHEEL_TICK - 1) / TIMER_WHEEL_TICK;
+    if(expires <= wheel->now) expires = wheel->now + 1;
+    if(expires - wheel->now >= TIMER_WHEEL_RANGE) expires = wheel->now + TIMER_WHEEL_RANGE - 1;
+
+    timer->expires = expires;
+    timer_wheel_insert(wheel, timer);
+}
+
+void timer_wheel_cancel(timer_entry_t* timer){
+    if(!timer->pending) return;
+    timer_wheel_unlink(timer);
+    timer->pending = false;
+}
+
+int timer_wheel_advance(timer_wheel_t* wheel, uint64_t now_ms, timer_expire_fn expire, void* arg){
+    uint64_t target = now_ms / TIMER_WHEEL_TICK;
+    int fired = 0;
+    timer_entry_t list;
+
+    while(wheel->now < target){
+        uint64_t tick = ++(wheel->now);
+
+        // a slot of a higher level is spread over the lower levels when the lower levels wrap around
+        for(int level = 1; level < TIMER_WHEEL_LEVELS; level++){
+            if((tick & (((uint64_t) 1 << (TIMER_WHEEL_BITS * level)) - 1)) != 0) break;
+            timer_wheel_take(&(wheel->slots[level][(tick >> (TIMER_WHEEL_BITS * level)) & TIMER_WHEEL_MASK]), &list);
+            while(list.next != &list){
+                timer_entry_t* timer = list.next;
+                timer_wheel_unlink(timer);
+                timer_wheel_insert(wheel, timer);
+            }
+        }
+
+        // the callback may touch any timer, so the fired timers are detached one by one
+        timer_wheel_take(&(wheel->slots[0][tick & TIMER_WHEEL_MASK]), &list);
+        while(list.next != &list){
+            timer_entry_t* timer = list.next;
+            timer_wheel_unlink(timer);
+            timer->pending = false;
+            fired++;
+            expire(timer, arg);
+        }
+    }
+    return fired;
+}
+
+void timer_wheel_free(timer_wheel_t** wheel){
+    if(*wheel == NULL) return;
+    for(int level = 0; level < TIMER_WHEEL_LEVELS; level++){
+        for(int slot = 0; slot < TIMER_WHEEL_SLOTS; slot++){
+            timer_entry_t* head = &((*wheel)->slots[level][slot]);
+            while(head->next != head) timer_wheel_cancel(head->next);
+        }
+    }
+    free(*wheel);
+    *wheel = NULL;
+}
+
+static void timer_wheel_insert(timer_wheel_t* wheel, timer_entry_t* timer){
+    // the lowest level whose range still covers the distance to the expiry
+    uint64_t delta = timer->expires - wheel->now;
+    int level = 0;
+    while(level < TIMER_WHEEL_LEVELS - 1 && delta >= ((uint64_t) 1 << (TIMER_WHEEL_BITS * (level + 1)))) level++;
+
+    timer_entry_t* head = &(wheel->slots[level][(timer->expires >> (TIMER_WHEEL_BITS * level)) & TIMER_WHEEL_MASK]);
+    timer->prev = head->prev;
+    timer->next = head;
+    head->prev->next = timer;
+    head->prev = timer;
+    timer->pending = true;
+}
+
+static void timer_wheel_unlink(timer_entry_t* timer){
+    timer->prev->next = timer->next;
+    timer->next->prev = timer->prev;
+    timer->next = timer;
+    timer->prev = timer;
+}
+
+static void timer_wheel_take(timer_entry_t* slot, timer_entry_t* list){
+    // move the whole slot to 'list' in O(1)
+    if(slot->next == slot){
+        list->next = list;
+        list->prev = list;
+        return;
+    }
+    list->next = slot->next;
+    list->prev = slot->prev;
+    list->next->prev = list;
+    list->prev->next = list;
+    slot->next = slot;
+    slot->prev = slot;
+}
@@ -0,0 +1,112 @@
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <stdint.h>
+#include "config.h"
+#include "window_kernel.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define WINDOW_KERNEL_X86
+#endif
+
+typedef void (*window_kernel_fn)(window_batch_t windows, int count, const sensor_value_t* min, const sensor_value_t* max,
+                                 sensor_value_t* avg, uint64_t* hot, uint64_t* cold);
+
+// helper methods
+static void window_kernel_scalar(window_batch_t windows, int count, const sensor_value_t* min, const sensor_value_t* max,
+                                 sensor_value_t* avg, uint64_t* hot, uint64_t* cold);
+static void window_kernel_tail(window_batch_t windows, int from, int count, const sensor_value_t* min, const sensor_value_t* max,
+                               sensor_value_t* avg, uint64_t* hot, uint64_t* cold);
+
+// global variables
+static window_kernel_fn kernel = window_kernel_scalar;
+static const char* kernel_name = "scalar";
+
+#ifdef WINDOW_KERNEL_X86
+__attribute__((target("avx2")))
+static void window_kernel_avx2(window_batch_t windows, int count, const sensor_value_t* min, const sensor_value_t* max,
+                               sensor_value_t* avg, uint64_t* hot, uint64_t* cold){
+    const __m256d length = _mm256_set1_pd(RUN_AVG_LENGTH);
+    uint64_t hot_mask = 0, cold_mask = 0;
+
+    int i = 0;
+    for(; i + 4 <= count; i += 4){
+        __m256d sum = _mm256_loadu_pd(&windows[0][i]);
+        for(int k = 1; k < RUN_AVG_LENGTH; k++) sum = _mm256_add_pd(sum, _mm256_loadu_pd(&windows[k][i]));
+        __m256d average = _mm256_div_pd(sum, length);
+        _mm256_storeu_pd(&avg[i], average);
+        hot_mask |= (uint64_t) _mm256_movemask_pd(_mm256_cmp_pd(average, _mm256_loadu_pd(&max[i]), _CMP_GT_OQ)) << i;
+        cold_mask |= (uint64_t) _mm256_movemask_pd(_mm256_cmp_pd(average, _mm256_loadu_pd(&min[i]), _CMP_LT_OQ)) << i;
+    }
+    window_kernel_tail(windows, i, count, min, max, avg, &hot_mask, &cold_mask);
+    *hot = hot_mask;
+    *cold = cold_mask;
+}
+
+__attribute__((target("sse2")))
+static void window_kernel_sse2(window_batch_t windows, int count, const sensor_value_t* min, const sensor_value_t* max,
+                               sensor_value_t* avg, uint64_t* hot, uint64_t* cold){
+    const __m128d length = _mm_set1_pd(RUN_AVG_LENGTH);
+    uint64_t hot_mask = 0, cold_mask = 0;
+
+    int i = 0;
+    for(; i + 2 <= count; i += 2){
+        __m128d sum = _mm_loadu_pd(&windows[0][i]);
+        for(int k = 1; k < RUN_AVG_LENGTH; k++) sum = _mm_add_pd(sum, _mm_loadu_pd(&windows[k][i]));
+        __m128d average = _mm_div_pd(sum, length);
+        _mm_storeu_pd(&avg[i], average);
+        hot_mask |= (uint64_t) _mm_movemask_pd(_mm_cmpgt_pd(average, _mm_loadu_pd(&max[i]))) << i;
+        cold_mask |= (uint64_t) _mm_movemask_pd(_mm_cmplt_pd(average, _mm_loadu_pd(&min[i]))) << i;
+    }
+    window_kernel_tail(windows, i, count, min, max, avg, &hot_mask, &cold_mask);
+    *hot = hot_mask;
+    *cold = cold_mask;
+}
+#endif
+
+void window_kernel_init(){
+#ifdef WINDOW_KERNEL_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2")){
+        kernel = window_kernel_avx2;
+        kernel_name = "avx2";
+        return;
+    }
+    if(__builtin_cpu_supports("sse2")){
+        kernel = window_kernel_sse2;
+        kernel_name = "sse2";
+        return;
+    }
+#endif
+    kernel = window_kernel_scalar;
+    kernel_name = "scalar";
+}
+
+const char* window_kernel_name(){
+    return kernel_name;
+}
+
+void window_kernel_eval(window_batch_t windows, int count, const sensor_value_t* min, const sensor_value_t* max,
+                        sensor_value_t* avg, uint64_t* hot, uint64_t* cold){
+    if(count > WINDOW_KERNEL_BATCH) count = WINDOW_KERNEL_BATCH;
+    kernel(windows, count, min, max, avg, hot, cold);
+}
+
+static void window_kernel_scalar(window_batch_t windows, int count, const sensor_value_t* min, const sensor_value_t* max,
+                                 sensor_value_t* avg, uint64_t* hot, uint64_t* cold){
+    *hot = 0;
+    *cold = 0;
+    window_kernel_tail(windows, 0, count, min, max, avg, hot, cold);
+}
+
+static void window_kernel_tail(window_batch_t windows, int from, int count, const sensor_value_t* min, const sensor_value_t* max,
+                               sensor_value_t* avg, uint64_t* hot, uint64_t* cold){
+    for(int i = from; i < count; i++){
+        sensor_value_t sum = windows[0][i];
+        for(int k = 1; k < RUN_AVG_LENGTH; k++) sum = sum + windows[k][i];
+        avg[i] = sum / RUN_AVG_LENGTH;
+        if(avg[i] > max[i]) *hot |= (uint64_t) 1 << i;
+        if(avg[i] < min[i]) *cold |= (uint64_t) 1 << i;
+    }
+}
@@ -4,7 +4,10 @@
 let sensorMapping = {};
 let roomToSensors = {};
 const apiBase = `${location.protocol}//${location.hostname}:5000`;
+// Live readings pushed by the gateway stream manager (Server-Sent Events)
+const streamBase = `${location.protocol}//${location.hostname}:8081`;
 let autoUpdateInterval;
+let liveStream = null;
 let currentRoomId = null;
 let activeCharts = {};
 let currentViewMode = 'realtime';
@@ -88,6 +91,7 @@ function viewDailyChart() {
     document.getElementById('daily-filter').style.display = 'block';
     document.getElementById('monthly-filter').style.display = 'none';
     clearInterval(autoUpdateInterval);
+    closeLiveStream();
     renderContentForCurrentState();
 }
 
@@ -96,6 +100,7 @@ function viewMonthlyChart() {
     document.getElementById('daily-filter').style.display = 'none';
     document.getElementById('monthly-filter').style.display = 'block';
     clearInterval(autoUpdateInterval);
+    closeLiveStream();
     renderContentForCurrentState();
 }
 
@@ -417,59 +422,87 @@ async function updateAllCharts() {
             const res = await fetch(`${apiBase}/sensor/${sensor_id}/latest`);
             const data = await res.json();
             
-            if (data.timestamp) {
-                const newPoint = {
-                    x: data.timestamp * 1000,
-                    y: data.sensor_value
-                };
-
-                const dataset = chart.data.datasets[0].data;
-                const lastPoint = dataset.length > 0 ? dataset[dataset.length - 1] : null;
-
-                // Chỉ thêm nếu điểm dữ liệu thực sự mới
-                if (!lastPoint || newPoint.x > lastPoint.x) {
-                    dataset.push(newPoint);
-                    
-                    // CẬP NHẬT CỬA SỔ THỜI GIAN 1 GIỜ (HIỆU ỨNG TRƯỢT)
-                    const oneHourAgo = new Date().getTime() - (60 * 60 * 1000);
-                    chart.options.scales.x.min = oneHourAgo;
-                    chart.options.scales.x.max = new Date().getTime(); 
-                    
-                    // Xóa các điểm dữ liệu cũ hơn 1 giờ
-                    while (dataset.length > 0 && dataset[0].x < oneHourAgo) {
-                        dataset.shift();
-                    }
-
-                    // Cập nhật các chỉ số KPI
-                    const latestValue = newPoint.y;
-                    if (type === 'temperature') document.getElementById("latestTemp").textContent = `${latestValue.toFixed(2)} C`;
-                    if (type === 'humidity') document.getElementById("latestHumidity").textContent = `${latestValue.toFixed(2)} %`;
-                    if (type === 'light') document.getElementById("latestLight").textContent = `${latestValue.toFixed(2)} lux`;
-                    
-                    // Cập nhật biểu đồ mà không có animation giật cục
-                    chart.update('quiet');
-                }
-            }
+            if (data.timestamp) addRealtimePoint(sensor_id, type, data.timestamp, data.sensor_value);
         } catch (err) {
             console.error(`Update failed for ${sensor_id}:`, err);
         }
     }
 }
 
+function addRealtimePoint(sensor_id, type, timestamp, value) {
+    const chart = activeCharts[sensor_id];
+    if (!chart) return;
+
+    const newPoint = { x: timestamp * 1000, y: value };
+    const dataset = chart.data.datasets[0].data;
+    const lastPoint = dataset.length > 0 ? dataset[dataset.length - 1] : null;
+
+    // Chỉ thêm nếu điểm dữ liệu thực sự mới
+    if (lastPoint && newPoint.x <= lastPoint.x) return;
+    dataset.push(newPoint);
+
+    // CẬP NHẬT CỬA SỔ THỜI GIAN 1 GIỜ (HIỆU ỨNG TRƯỢT)
+    const oneHourAgo = new Date().getTime() - (60 * 60 * 1000);
+    chart.options.scales.x.min = oneHourAgo;
+    chart.options.scales.x.max = new Date().getTime();
+
+    // Xóa các điểm dữ liệu cũ hơn 1 giờ
+    while (dataset.length > 0 && dataset[0].x < oneHourAgo) {
+        dataset.shift();
+    }
+
+    // Cập nhật các chỉ số KPI
+    if (type === 'temperature') document.getElementById("latestTemp").textContent = `${value.toFixed(2)} C`;
+    if (type === 'humidity') document.getElementById("latestHumidity").textContent = `${value.toFixed(2)} %`;
+    if (type === 'light') document.getElementById("latestLight").textContent = `${value.toFixed(2)} lux`;
+
+    // Cập nhật biểu đồ mà không có animation giật cục
+    chart.update('quiet');
+}
+
 function toggleAutoUpdate(isChecked) {
     if (isChecked) {
         setupAutoUpdate();
     } else {
         clearInterval(autoUpdateInterval);
+        closeLiveStream();
+    }
+}
+
+function startPolling() {
+    const intervalSeconds = parseInt(document.getElementById('intervalInput').value) || 5;
+    autoUpdateInterval = setInterval(() => updateAllCharts(false), intervalSeconds * 1000);
+}
+
+function openLiveStream() {
+    // Readings of the current room are pushed as they arrive, no polling needed
+    liveStream = new EventSource(`${streamBase}/stream?room=${currentRoomId}`);
+    liveStream.onmessage = (event) => {
+        const reading = JSON.parse(event.data);
+        const info = sensorMapping[reading.sensor_id];
+        if (info) addRealtimePoint(reading.sensor_id, info.type, reading.timestamp, reading.value);
+    };
+    liveStream.onerror = () => {
+        // The gateway stream is not reachable: fall back to polling the API
+        closeLiveStream();
+        startPolling();
+    };
+}
+
+function closeLiveStream() {
+    if (liveStream) {
+        liveStream.close();
+        liveStream = null;
     }
 }
 
 function setupAutoUpdate() {
     clearInterval(autoUpdateInterval);
+    closeLiveStream();
     const toggle = document.getElementById('autoUpdateToggle');
     if (toggle.checked && currentViewMode === 'realtime') {
-        const intervalSeconds = parseInt(document.getElementById('intervalInput').value) || 5;
-        autoUpdateInterval = setInterval(() => updateAllCharts(false), intervalSeconds * 1000);
+        if (window.EventSource) openLiveStream();
+        else startPolling();
     }
 }
 